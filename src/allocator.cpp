@@ -0,0 +1,412 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/allocator.h>
+#include <zbase/atomic.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+#include <new>
+
+#ifndef ZBASE_WINDOWS
+#	include <pthread.h>
+#endif
+
+namespace zbase
+{
+	//
+	// Allocator
+	//
+
+	Allocator *Allocator::s_default = NULL;
+	ZBASE_THREAD_LOCAL Allocator *Allocator::s_current = NULL;
+
+	Allocator::Allocator() : m_stats_enabled(false)
+	{
+		ResetStats();
+	}
+
+	void Allocator::ResetStats()
+	{
+		memset(&m_stats, 0, sizeof(m_stats));
+	}
+
+	Allocator* Allocator::GetDefault()
+	{
+		return NULL != s_default ? s_default : MallocAllocator::Instance();
+	}
+
+	void Allocator::SetDefault(Allocator *allocator)
+	{
+		s_default = allocator;
+	}
+
+	Allocator* Allocator::GetCurrent()
+	{
+		return NULL != s_current ? s_current : GetDefault();
+	}
+
+	void Allocator::CountAllocate(size_t size, bool from_system)
+	{
+		if (m_stats_enabled) {
+			atomic::IncAndFetch(&m_stats.allocations);
+			atomic::AddAndFetch(&m_stats.bytes_in_use, size);
+			if (from_system) {
+				atomic::IncAndFetch(&m_stats.system_allocations);
+			}
+		}
+	}
+
+	void Allocator::CountReallocate(size_t old_size, size_t new_size, bool from_system)
+	{
+		if (m_stats_enabled) {
+			atomic::IncAndFetch(&m_stats.reallocations);
+			atomic::AddAndFetch(&m_stats.bytes_in_use, new_size);
+			atomic::SubAndFetch(&m_stats.bytes_in_use, old_size);
+			if (from_system) {
+				atomic::IncAndFetch(&m_stats.system_allocations);
+			}
+		}
+	}
+
+	void Allocator::CountDeallocate(size_t size)
+	{
+		if (m_stats_enabled) {
+			atomic::IncAndFetch(&m_stats.deallocations);
+			atomic::SubAndFetch(&m_stats.bytes_in_use, size);
+		}
+	}
+
+	//
+	// MallocAllocator
+	//
+
+	MallocAllocator* MallocAllocator::Instance()
+	{
+		static MallocAllocator s_instance;
+		return &s_instance;
+	}
+
+	void* MallocAllocator::Allocate(size_t size)
+	{
+		void *ptr = malloc(size);
+		if (NULL == ptr) {
+			throw std::bad_alloc();
+		}
+		CountAllocate(size, true);
+		return ptr;
+	}
+
+	void* MallocAllocator::Reallocate(void *ptr, size_t old_size, size_t new_size)
+	{
+		void *p = realloc(ptr, new_size);
+		if (NULL == p) {
+			throw std::bad_alloc();
+		}
+		CountReallocate(old_size, new_size, true);
+		return p;
+	}
+
+	void MallocAllocator::Deallocate(void *ptr, size_t size)
+	{
+		if (NULL != ptr) {
+			free(ptr);
+			CountDeallocate(size);
+		}
+	}
+
+	//
+	// PoolAllocator
+	//
+
+	const size_t PoolAllocator::MIN_BLOCK_SIZE = 32;
+	const size_t PoolAllocator::MAX_BLOCK_SIZE = 32768;
+	const size_t PoolAllocator::MAX_CACHED_BYTES = 256 * 1024;
+
+	namespace
+	{
+		const int MIN_BLOCK_SHIFT = 5;
+		const int NUM_SIZE_CLASSES = 11; // 32 B .. 32 KB
+
+		struct FreeBlock
+		{
+			FreeBlock *next;
+		};
+
+		struct ThreadCache
+		{
+			FreeBlock *free_lists[NUM_SIZE_CLASSES];
+			size_t counts[NUM_SIZE_CLASSES];
+		};
+
+		ZBASE_THREAD_LOCAL ThreadCache *s_thread_cache = NULL;
+
+		// index of the smallest size class holding size bytes, size <= MAX_BLOCK_SIZE
+		inline int GetSizeClass(size_t size)
+		{
+			if (size <= PoolAllocator::MIN_BLOCK_SIZE) {
+				return 0;
+			}
+#ifdef __GNUC__
+			return static_cast<int>(sizeof(unsigned long) * 8) - __builtin_clzl(static_cast<unsigned long>(size - 1)) - MIN_BLOCK_SHIFT;
+#else
+			int index = 0;
+			for (size_t block_size = PoolAllocator::MIN_BLOCK_SIZE; block_size < size; block_size <<= 1) {
+				++index;
+			}
+			return index;
+#endif
+		}
+
+		inline size_t GetBlockSize(int size_class)
+		{
+			return static_cast<size_t>(1) << (size_class + MIN_BLOCK_SHIFT);
+		}
+
+		void FreeThreadCache(void *ptr)
+		{
+			ThreadCache *cache = static_cast<ThreadCache*>(ptr);
+			for (int i = 0; i < NUM_SIZE_CLASSES; ++i) {
+				while (NULL != cache->free_lists[i]) {
+					FreeBlock *block = cache->free_lists[i];
+					cache->free_lists[i] = block->next;
+					free(block);
+				}
+				cache->counts[i] = 0;
+			}
+		}
+
+#ifndef ZBASE_WINDOWS
+		pthread_key_t s_thread_cache_key;
+		pthread_once_t s_thread_cache_once = PTHREAD_ONCE_INIT;
+
+		void DestroyThreadCache(void *ptr)
+		{
+			FreeThreadCache(ptr);
+			free(ptr);
+			s_thread_cache = NULL;
+		}
+
+		void CreateThreadCacheKey()
+		{
+			pthread_key_create(&s_thread_cache_key, DestroyThreadCache);
+		}
+#endif
+
+		ThreadCache* GetThreadCache()
+		{
+			ThreadCache *cache = s_thread_cache;
+			if (NULL == cache) {
+				cache = static_cast<ThreadCache*>(calloc(1, sizeof(ThreadCache)));
+				if (NULL == cache) {
+					throw std::bad_alloc();
+				}
+#ifndef ZBASE_WINDOWS
+				// the key destructor returns the cache to the system at thread exit
+				pthread_once(&s_thread_cache_once, CreateThreadCacheKey);
+				pthread_setspecific(s_thread_cache_key, cache);
+#endif
+				s_thread_cache = cache;
+			}
+			return cache;
+		}
+	} // anonymous namespace
+
+	PoolAllocator* PoolAllocator::Instance()
+	{
+		static PoolAllocator s_instance;
+		return &s_instance;
+	}
+
+	void* PoolAllocator::Allocate(size_t size)
+	{
+		if (size > MAX_BLOCK_SIZE) {
+			void *ptr = malloc(size);
+			if (NULL == ptr) {
+				throw std::bad_alloc();
+			}
+			CountAllocate(size, true);
+			return ptr;
+		}
+
+		int size_class = GetSizeClass(size);
+		ThreadCache *cache = GetThreadCache();
+		FreeBlock *block = cache->free_lists[size_class];
+		if (NULL != block) {
+			cache->free_lists[size_class] = block->next;
+			--cache->counts[size_class];
+			CountAllocate(size, false);
+			return block;
+		}
+		void *ptr = malloc(GetBlockSize(size_class));
+		if (NULL == ptr) {
+			throw std::bad_alloc();
+		}
+		CountAllocate(size, true);
+		return ptr;
+	}
+
+	void* PoolAllocator::Reallocate(void *ptr, size_t old_size, size_t new_size)
+	{
+		if (NULL == ptr) {
+			return Allocate(new_size);
+		}
+		if (old_size > MAX_BLOCK_SIZE && new_size > MAX_BLOCK_SIZE) {
+			void *p = realloc(ptr, new_size);
+			if (NULL == p) {
+				throw std::bad_alloc();
+			}
+			CountReallocate(old_size, new_size, true);
+			return p;
+		}
+		if (old_size <= MAX_BLOCK_SIZE && new_size <= MAX_BLOCK_SIZE && GetSizeClass(old_size) == GetSizeClass(new_size)) {
+			// the block is large enough already
+			CountReallocate(old_size, new_size, false);
+			return ptr;
+		}
+		void *p = Allocate(new_size);
+		memcpy(p, ptr, std::min(old_size, new_size));
+		Deallocate(ptr, old_size);
+		return p;
+	}
+
+	void PoolAllocator::Deallocate(void *ptr, size_t size)
+	{
+		if (NULL == ptr) {
+			return;
+		}
+		CountDeallocate(size);
+		if (size > MAX_BLOCK_SIZE) {
+			free(ptr);
+			return;
+		}
+
+		int size_class = GetSizeClass(size);
+		ThreadCache *cache = GetThreadCache();
+		if (cache->counts[size_class] * GetBlockSize(size_class) >= MAX_CACHED_BYTES) {
+			free(ptr);
+			return;
+		}
+		FreeBlock *block = static_cast<FreeBlock*>(ptr);
+		block->next = cache->free_lists[size_class];
+		cache->free_lists[size_class] = block;
+		++cache->counts[size_class];
+	}
+
+	void PoolAllocator::Trim()
+	{
+		if (NULL != s_thread_cache) {
+			FreeThreadCache(s_thread_cache);
+		}
+	}
+
+	//
+	// ArenaAllocator
+	//
+
+	const size_t ArenaAllocator::DEFAULT_CHUNK_SIZE = 64 * 1024;
+
+	ArenaAllocator::ArenaAllocator(size_t chunk_size)
+		: m_chunk_size(Align(std::max(chunk_size, static_cast<size_t>(256)))), m_reserved_size(0),
+		  m_chunks(NULL), m_large_chunks(NULL), m_pos(NULL), m_end(NULL), m_last(NULL)
+	{
+	}
+
+	ArenaAllocator::~ArenaAllocator()
+	{
+		FreeChunks(m_chunks);
+		FreeChunks(m_large_chunks);
+	}
+
+	char* ArenaAllocator::NewChunk(Chunk **list, size_t size)
+	{
+		Chunk *chunk = static_cast<Chunk*>(malloc(Align(sizeof(Chunk)) + size));
+		if (NULL == chunk) {
+			throw std::bad_alloc();
+		}
+		chunk->next = *list;
+		chunk->size = size;
+		*list = chunk;
+		m_reserved_size += size;
+		return reinterpret_cast<char*>(chunk) + Align(sizeof(Chunk));
+	}
+
+	void ArenaAllocator::FreeChunks(Chunk *chunk)
+	{
+		while (NULL != chunk) {
+			Chunk *next = chunk->next;
+			m_reserved_size -= chunk->size;
+			free(chunk);
+			chunk = next;
+		}
+	}
+
+	void* ArenaAllocator::Allocate(size_t size)
+	{
+		size_t n = Align(std::max(size, static_cast<size_t>(1)));
+		if (n > m_chunk_size / 4) {
+			// large blocks get a chunk of their own, leaving the free space of the current chunk
+			CountAllocate(size, true);
+			m_last = NULL;
+			return NewChunk(&m_large_chunks, n);
+		}
+		bool from_system = false;
+		if (static_cast<size_t>(m_end - m_pos) < n) {
+			m_pos = NewChunk(&m_chunks, m_chunk_size);
+			m_end = m_pos + m_chunk_size;
+			from_system = true;
+		}
+		m_last = m_pos;
+		m_pos += n;
+		CountAllocate(size, from_system);
+		return m_last;
+	}
+
+	void* ArenaAllocator::Reallocate(void *ptr, size_t old_size, size_t new_size)
+	{
+		if (NULL == ptr) {
+			return Allocate(new_size);
+		}
+		if (ptr == m_last && static_cast<size_t>(m_end - m_last) >= Align(new_size)) {
+			// the latest block can grow or shrink in place
+			m_pos = m_last + Align(std::max(new_size, static_cast<size_t>(1)));
+			CountReallocate(old_size, new_size, false);
+			return ptr;
+		}
+		if (new_size <= old_size) {
+			CountReallocate(old_size, new_size, false);
+			return ptr;
+		}
+		void *p = Allocate(new_size);
+		memcpy(p, ptr, old_size);
+		// the old block stays in the arena until Reset()
+		CountDeallocate(old_size);
+		return p;
+	}
+
+	void ArenaAllocator::Deallocate(void *ptr, size_t size)
+	{
+		if (NULL == ptr) {
+			return;
+		}
+		if (ptr == m_last) {
+			m_pos = m_last;
+			m_last = NULL;
+		}
+		CountDeallocate(size);
+	}
+
+	void ArenaAllocator::Reset()
+	{
+		FreeChunks(m_large_chunks);
+		m_large_chunks = NULL;
+		if (NULL != m_chunks) {
+			// keep the newest chunk
+			FreeChunks(m_chunks->next);
+			m_chunks->next = NULL;
+			m_pos = reinterpret_cast<char*>(m_chunks) + Align(sizeof(Chunk));
+			m_end = m_pos + m_chunk_size;
+		}
+		m_last = NULL;
+	}
+} // namespace zbase
@@ -1,50 +1,107 @@
 // Copyright (c) 2012 Junheng Zang. All Rights Reserved.
 //
 #include <zbase/byteorder.h>
-#include <zbase/inttypes.h>
-
-#if defined __GNUC__ && __GNUC__ >= 3
-//#  include <endian.h>
-#  include <byteswap.h>
-#  define BYTE_SWAP_16(x) bswap_16(x)
-#  define BYTE_SWAP_32(x) bswap_32(x)
-#  define BYTE_SWAP_64(x) bswap_64(x)
-#else // Portable implementation
-#  define BYTE_SWAP_16(x) \
-	(((*((uint8_t*)&(x))) << 8) | (*((uint8_t*)&(x)+1)))
-#  define BYTE_SWAP_32(x) \
-	(((*((uint8_t*)&(x))) << 24) | ((*((uint8_t*)&(x)+1)) << 16) | ((*((uint8_t*)&(x)+2)) << 8) | (*((uint8_t*)&(x)+3)))
-#  define BYTE_SWAP_64(x) \
-	(((*((uint8_t*)&(x))) << 56) | ((*((uint8_t*)&(x)+1)) << 48) | ((*((uint8_t*)&(x)+2)) << 40) | ((*((uint8_t*)&(x)+3)) << 32) | \
-	 ((*((uint8_t*)&(x)+4)) << 24) | ((*((uint8_t*)&(x)+5)) << 16) | ((*((uint8_t*)&(x)+6)) << 8) | (*((uint8_t*)&(x)+7)))
-#endif
 
-#define BYTE_SWAP_NBITS(x, n) BYTE_SWAP_##n(x)
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && (defined(__x86_64__) || defined(__i386__))
+#	define ZBASE_HAS_X86_SIMD
+#	include <immintrin.h>
+#endif
 
 namespace zbase
 {
 	namespace byteorder
 	{
-		// Check host byte order
-		static const uint16_t kByteOrderDetector = 0x1234;
-		const bool kIsHostLE = (0x34 == (*(uint8_t*)&kByteOrderDetector));
-
-#define BYTE_ORDER_IMPLEMENTATION(T, N) \
-		template <> T ByteSwap(T value) { return BYTE_SWAP_NBITS(value, N); } \
-		template <> T HToLE(T value) { return kIsHostLE ? value : BYTE_SWAP_NBITS(value, N); } \
-		template <> T HToBE(T value) { return kIsHostLE ? BYTE_SWAP_NBITS(value, N) : value; } \
-		template <> T LEToH(T value) { return kIsHostLE ? value : BYTE_SWAP_NBITS(value, N); } \
-		template <> T BEToH(T value) { return kIsHostLE ? BYTE_SWAP_NBITS(value, N) : value; }
-
-		BYTE_ORDER_IMPLEMENTATION(short, SHORT_BIT)
-		BYTE_ORDER_IMPLEMENTATION(unsigned short, SHORT_BIT)
-		BYTE_ORDER_IMPLEMENTATION(int, INT_BIT)
-		BYTE_ORDER_IMPLEMENTATION(unsigned int, INT_BIT)
-		BYTE_ORDER_IMPLEMENTATION(long, LONG_BIT)
-		BYTE_ORDER_IMPLEMENTATION(unsigned long, LONG_BIT)
-		BYTE_ORDER_IMPLEMENTATION(long long, LLONG_BIT)
-		BYTE_ORDER_IMPLEMENTATION(unsigned long long, LLONG_BIT)
-#undef BYTE_ORDER_IMPLEMENTATION
-	}
-}
+		namespace
+		{
+			typedef void (*SwapArrayFunc)(void *dst, const void *src, size_t n);
+
+			// Portable implementation, also used for the tails of the vectorized ones
+			template <typename U>
+			void SwapArrayScalar(void *dst, const void *src, size_t n)
+			{
+				char *d = static_cast<char*>(dst);
+				const char *s = static_cast<const char*>(src);
+				for (size_t i = 0; i < n; ++i) {
+					U value;
+					memcpy(&value, s + i * sizeof(U), sizeof(U));
+					value = ByteSwap(value);
+					memcpy(d + i * sizeof(U), &value, sizeof(U));
+				}
+			}
+
+#ifdef ZBASE_HAS_X86_SIMD
+			// pshufb masks reversing the bytes of each 2/4/8-byte element in a 128-bit lane
+			template <size_t N> __m128i ShuffleMask128();
+			template <> __m128i ShuffleMask128<2>() { return _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14); }
+			template <> __m128i ShuffleMask128<4>() { return _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12); }
+			template <> __m128i ShuffleMask128<8>() { return _mm_setr_epi8(7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8); }
+
+			template <typename U>
+			__attribute__((target("ssse3")))
+			void SwapArraySSSE3(void *dst, const void *src, size_t n)
+			{
+				char *d = static_cast<char*>(dst);
+				const char *s = static_cast<const char*>(src);
+				const __m128i mask = ShuffleMask128<sizeof(U)>();
+				const size_t step = sizeof(__m128i) / sizeof(U);
+				size_t i = 0;
+				for (; i + step <= n; i += step) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + i * sizeof(U)));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(d + i * sizeof(U)), _mm_shuffle_epi8(v, mask));
+				}
+				SwapArrayScalar<U>(d + i * sizeof(U), s + i * sizeof(U), n - i);
+			}
+
+			template <typename U>
+			__attribute__((target("avx2")))
+			void SwapArrayAVX2(void *dst, const void *src, size_t n)
+			{
+				char *d = static_cast<char*>(dst);
+				const char *s = static_cast<const char*>(src);
+				// vpshufb shuffles within each 128-bit lane, so the same mask is used for both lanes
+				const __m256i mask = _mm256_broadcastsi128_si256(ShuffleMask128<sizeof(U)>());
+				const size_t step = sizeof(__m256i) / sizeof(U);
+				size_t i = 0;
+				for (; i + step <= n; i += step) {
+					__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i * sizeof(U)));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(d + i * sizeof(U)), _mm256_shuffle_epi8(v, mask));
+				}
+				SwapArrayScalar<U>(d + i * sizeof(U), s + i * sizeof(U), n - i);
+			}
+#endif // ZBASE_HAS_X86_SIMD
+
+			template <typename U>
+			SwapArrayFunc SelectSwapArray()
+			{
+#ifdef ZBASE_HAS_X86_SIMD
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2")) {
+					return SwapArrayAVX2<U>;
+				}
+				if (__builtin_cpu_supports("ssse3")) {
+					return SwapArraySSSE3<U>;
+				}
+#endif
+				return SwapArrayScalar<U>;
+			}
+		} // namespace
+
+		void SwapArray16(void *dst, const void *src, size_t n)
+		{
+			static const SwapArrayFunc func = SelectSwapArray<uint16_t>();
+			func(dst, src, n);
+		}
+
+		void SwapArray32(void *dst, const void *src, size_t n)
+		{
+			static const SwapArrayFunc func = SelectSwapArray<uint32_t>();
+			func(dst, src, n);
+		}
 
+		void SwapArray64(void *dst, const void *src, size_t n)
+		{
+			static const SwapArrayFunc func = SelectSwapArray<uint64_t>();
+			func(dst, src, n);
+		}
+	} // namespace byteorder
+} // namespace zbase
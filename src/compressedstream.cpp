@@ -0,0 +1,189 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/compressedstream.h>
+#include <zbase/byteorder.h>
+#include <zbase/lz4.h>
+
+#include <cstring>
+#include <algorithm>
+
+namespace zbase
+{
+	const size_t CompressedBlock::HEADER_SIZE;
+	const uint32_t CompressedBlock::SIZE_MASK;
+	const uint32_t CompressedBlock::FLAG_STORED;
+	const uint32_t CompressedBlock::FLAG_END;
+
+	const size_t CompressedWriter::DEFAULT_BLOCK_SIZE = 64 * 1024; // 64 KB
+	// the compressed size of a block must fit in the size field
+	const size_t CompressedWriter::MAX_BLOCK_SIZE = 256 * 1024 * 1024; // 256 MB
+
+	CompressedWriter::CompressedWriter(OctetStream *output, size_t block_size)
+		: m_output(output), m_block_size(std::min(std::max(block_size, static_cast<size_t>(1)), MAX_BLOCK_SIZE)),
+		  m_raw_size(0), m_compressed_size(0), m_is_open(false)
+	{
+	}
+
+	CompressedWriter::~CompressedWriter()
+	{
+		if (m_is_open) {
+			try {
+				End();
+			} catch (...) {
+			}
+		}
+	}
+
+	CompressedWriter& CompressedWriter::Write(const void *data, size_t n)
+	{
+		m_is_open = true;
+		const char *p = static_cast<const char*>(data);
+		// the pending block is always shorter than a block, see FlushBlocks()
+		if (!m_block.IsEmpty()) {
+			size_t take = std::min(n, m_block_size - m_block.GetSize());
+			m_block.Write(p, take);
+			p += take;
+			n -= take;
+			if (m_block.GetSize() >= m_block_size) {
+				FlushBlocks();
+			}
+		}
+		// the pending block is empty unless all data went into it
+		for (; n >= m_block_size; p += m_block_size, n -= m_block_size) {
+			WriteBlock(p, m_block_size, false);
+		}
+		if (n > 0) {
+			m_block.Write(p, n);
+		}
+		return *this;
+	}
+
+	void CompressedWriter::End()
+	{
+		FlushBlocks();
+		WriteBlock(m_block.GetData(), m_block.GetSize(), true);
+		if (m_block.GetCapacity() > 0) {
+			m_block.Ignore(m_block.GetSize());
+			m_block.Compact();
+		}
+		m_is_open = false;
+	}
+
+	void CompressedWriter::FlushBlocks()
+	{
+		if (m_block.GetSize() < m_block_size) {
+			return;
+		}
+		while (m_block.GetSize() >= m_block_size) {
+			WriteBlock(m_block.GetData(), m_block_size, false);
+			m_block.Ignore(m_block_size);
+		}
+		// keep the buffer at about one block
+		m_block.Compact();
+	}
+
+	void CompressedWriter::WriteBlock(const void *data, size_t n, bool is_end)
+	{
+		char *header = static_cast<char*>(m_output->PrepareWrite(CompressedBlock::HEADER_SIZE + lz4::GetMaxCompressedSize(n)));
+		char *payload = header + CompressedBlock::HEADER_SIZE;
+		// a block which does not shrink is stored
+		size_t size = n > 0 ? lz4::Compress(payload, n - 1, data, n) : 0;
+		uint32_t flags = is_end ? CompressedBlock::FLAG_END : 0;
+		if (0 == size) {
+			if (n > 0) {
+				memcpy(payload, data, n);
+			}
+			size = n;
+			flags |= CompressedBlock::FLAG_STORED;
+		}
+		uint32_t fields[2] = { byteorder::HToLE(static_cast<uint32_t>(size) | flags), byteorder::HToLE(static_cast<uint32_t>(n)) };
+		memcpy(header, fields, sizeof(fields));
+		m_output->CommitWrite(CompressedBlock::HEADER_SIZE + size);
+		m_raw_size += n;
+		m_compressed_size += CompressedBlock::HEADER_SIZE + size;
+	}
+
+	const size_t CompressedReader::DEFAULT_MAX_MESSAGE_SIZE = 16 * 1024 * 1024; // 16 MB
+
+	CompressedReader::CompressedReader(size_t max_message_size)
+		: m_message_size(0), m_max_message_size(max_message_size), m_integer_encoding(OctetStream::ENCODING_FIXED)
+	{
+	}
+
+	void CompressedReader::Feed(const void *data, size_t n)
+	{
+		memcpy(PrepareFeed(n), data, n);
+		CommitFeed(n);
+	}
+
+	void* CompressedReader::PrepareFeed(size_t n)
+	{
+		// compact once the consumed bytes outweigh the pending ones, see FrameDecoder::PrepareFeed()
+		size_t consumed = static_cast<const char*>(m_input.GetData()) - static_cast<const char*>(m_input.begin());
+		if (consumed > 0 && consumed >= m_input.GetSize()) {
+			m_input.Compact();
+		}
+		return m_input.PrepareWrite(n);
+	}
+
+	bool CompressedReader::NextMessage(OctetsView &message)
+		throw (std::length_error, std::invalid_argument)
+	{
+		if (m_message_size > 0) {
+			m_output.Ignore(m_message_size);
+			m_message_size = 0;
+			m_output.Compact();
+		}
+
+		for (;;) {
+			OctetStream::Transaction transaction(m_input);
+			uint32_t header = 0;
+			uint32_t raw_size = 0;
+			if (!m_input.TryPopInteger(header) || !m_input.TryPopInteger(raw_size)) {
+				return false;
+			}
+			if (raw_size > m_max_message_size - std::min(m_output.GetSize(), m_max_message_size)) {
+				throw std::length_error("CompressedReader::NextMessage");
+			}
+			// check the payload size before waiting for the payload, so that buffering stays bounded
+			size_t size = header & CompressedBlock::SIZE_MASK;
+			if ((header & CompressedBlock::FLAG_STORED) ? size != raw_size : size > lz4::GetMaxCompressedSize(raw_size)) {
+				throw std::invalid_argument("CompressedReader::NextMessage");
+			}
+			if (m_input.GetSize() < size) {
+				return false;
+			}
+			if (header & CompressedBlock::FLAG_STORED) {
+				if (size > 0) {
+					m_output.Write(m_input.GetData(), size);
+				}
+			} else {
+				void *dst = m_output.PrepareWrite(raw_size);
+				if (lz4::Decompress(dst, raw_size, m_input.GetData(), size) != raw_size) {
+					throw std::invalid_argument("CompressedReader::NextMessage");
+				}
+				m_output.CommitWrite(raw_size);
+			}
+			m_input.Ignore(size);
+			transaction.Commit();
+
+			if (header & CompressedBlock::FLAG_END) {
+				m_message_size = m_output.GetSize();
+				message = OctetsView(m_output.GetData(), m_message_size);
+				return true;
+			}
+		}
+	}
+
+	void CompressedReader::Clear()
+	{
+		if (m_input.GetCapacity() > 0) {
+			m_input.Clear();
+		}
+		if (m_output.GetCapacity() > 0) {
+			m_output.Clear();
+		}
+		m_message_size = 0;
+	}
+
+} // namespace zbase
@@ -0,0 +1,58 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/framedecoder.h>
+
+namespace zbase
+{
+	const size_t FrameDecoder::DEFAULT_MAX_FRAME_SIZE = 16 * 1024 * 1024; // 16 MB
+
+	FrameDecoder::FrameDecoder(size_t max_frame_size)
+		: m_max_frame_size(max_frame_size)
+	{
+	}
+
+	void FrameDecoder::Feed(const void *data, size_t n)
+	{
+		memcpy(PrepareFeed(n), data, n);
+		CommitFeed(n);
+	}
+
+	void* FrameDecoder::PrepareFeed(size_t n)
+	{
+		// compact once the consumed bytes outweigh the pending ones, so that the memmove
+		// cost stays proportional to the data consumed
+		size_t consumed = static_cast<const char*>(m_buffer.GetData()) - static_cast<const char*>(m_buffer.begin());
+		if (consumed > 0 && consumed >= m_buffer.GetSize()) {
+			m_buffer.Compact();
+		}
+		return m_buffer.PrepareWrite(n);
+	}
+
+	bool FrameDecoder::NextFrame(OctetsView &frame)
+		throw (std::length_error)
+	{
+		OctetStream::Transaction transaction(m_buffer);
+		uint32_t len = 0;
+		if (!m_buffer.TryPopInteger(len)) {
+			return false;
+		}
+		if (len > m_max_frame_size) {
+			throw std::length_error("FrameDecoder::NextFrame");
+		}
+		if (m_buffer.GetSize() < len) {
+			return false;
+		}
+		frame = OctetsView(m_buffer.GetData(), len);
+		m_buffer.Ignore(len);
+		transaction.Commit();
+		return true;
+	}
+
+	void FrameDecoder::Clear()
+	{
+		if (m_buffer.GetCapacity() > 0) {
+			m_buffer.Clear();
+		}
+	}
+
+} // namespace zbase
@@ -0,0 +1,109 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/hash.h>
+#include <zbase/byteorder.h>
+
+#include <cstring>
+
+namespace zbase
+{
+	namespace hash
+	{
+		namespace
+		{
+			const uint64_t kSecret[4] = {
+				0x2d358dccaa6c78a5ULL, 0x8bb84b93962eacc9ULL, 0x4b33a62ed433d4a3ULL, 0x4d5a2da51de1aa47ULL
+			};
+
+			// 128-bit product of a and b, the low half in a and the high half in b
+			inline void Multiply(uint64_t *a, uint64_t *b)
+			{
+#if defined(__SIZEOF_INT128__)
+				unsigned __int128 r = static_cast<unsigned __int128>(*a) * *b;
+				*a = static_cast<uint64_t>(r);
+				*b = static_cast<uint64_t>(r >> 64);
+#else
+				uint64_t ha = *a >> 32, hb = *b >> 32, la = static_cast<uint32_t>(*a), lb = static_cast<uint32_t>(*b);
+				uint64_t rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb;
+				uint64_t t = rl + (rm0 << 32);
+				uint64_t carry = t < rl;
+				uint64_t lo = t + (rm1 << 32);
+				carry += lo < t;
+				*a = lo;
+				*b = rh + (rm0 >> 32) + (rm1 >> 32) + carry;
+#endif
+			}
+
+			inline uint64_t Mix(uint64_t a, uint64_t b)
+			{
+				Multiply(&a, &b);
+				return a ^ b;
+			}
+
+			inline uint64_t Read64(const unsigned char *p)
+			{
+				uint64_t v;
+				memcpy(&v, p, sizeof(v));
+				return byteorder::LEToH(v);
+			}
+
+			inline uint64_t Read32(const unsigned char *p)
+			{
+				uint32_t v;
+				memcpy(&v, p, sizeof(v));
+				return byteorder::LEToH(v);
+			}
+
+			// 1 to 3 bytes
+			inline uint64_t Read3(const unsigned char *p, size_t n)
+			{
+				return (static_cast<uint64_t>(p[0]) << 16) | (static_cast<uint64_t>(p[n >> 1]) << 8) | p[n - 1];
+			}
+		} // namespace
+
+		uint64_t Hash64(const void *data, size_t n, uint64_t seed)
+		{
+			const unsigned char *p = static_cast<const unsigned char*>(data);
+			seed ^= Mix(seed ^ kSecret[0], kSecret[1]);
+			uint64_t a, b;
+			if (n <= 16) {
+				if (n >= 4) {
+					// two overlapping reads from each end cover 4 to 16 bytes
+					size_t offset = (n >> 3) << 2;
+					a = (Read32(p) << 32) | Read32(p + offset);
+					b = (Read32(p + n - 4) << 32) | Read32(p + n - 4 - offset);
+				} else if (n > 0) {
+					a = Read3(p, n);
+					b = 0;
+				} else {
+					a = b = 0;
+				}
+			} else {
+				size_t i = n;
+				if (i > 48) {
+					uint64_t seed1 = seed, seed2 = seed;
+					do {
+						seed = Mix(Read64(p) ^ kSecret[1], Read64(p + 8) ^ seed);
+						seed1 = Mix(Read64(p + 16) ^ kSecret[2], Read64(p + 24) ^ seed1);
+						seed2 = Mix(Read64(p + 32) ^ kSecret[3], Read64(p + 40) ^ seed2);
+						p += 48;
+						i -= 48;
+					} while (i > 48);
+					seed ^= seed1 ^ seed2;
+				}
+				while (i > 16) {
+					seed = Mix(Read64(p) ^ kSecret[1], Read64(p + 8) ^ seed);
+					p += 16;
+					i -= 16;
+				}
+				// the last 16 bytes, overlapping the previous round if needed
+				a = Read64(p + i - 16);
+				b = Read64(p + i - 8);
+			}
+			a ^= kSecret[1];
+			b ^= seed;
+			Multiply(&a, &b);
+			return Mix(a ^ kSecret[0] ^ n, b ^ kSecret[1]);
+		}
+	} // namespace hash
+} // namespace zbase
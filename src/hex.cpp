@@ -0,0 +1,289 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/hex.h>
+
+#include <cstring>
+#include <algorithm>
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && (defined(__x86_64__) || defined(__i386__))
+#	define ZBASE_HAS_X86_SIMD
+#	include <immintrin.h>
+#endif
+
+namespace zbase
+{
+	namespace hex
+	{
+		namespace
+		{
+			typedef void (*EncodeFunc)(char *dst, const unsigned char *src, size_t n);
+
+			const char kDigits[] = "0123456789ABCDEF";
+
+			inline void EncodeByte(char *dst, unsigned char b)
+			{
+				dst[0] = kDigits[b >> 4];
+				dst[1] = kDigits[b & 0x0F];
+			}
+
+			// value of a hex digit, -1 if c is not one
+			inline int DigitValue(unsigned char c)
+			{
+				if (static_cast<unsigned int>(c - '0') < 10u) {
+					return c - '0';
+				}
+				c |= 0x20;
+				if (static_cast<unsigned int>(c - 'a') < 6u) {
+					return c - 'a' + 10;
+				}
+				return -1;
+			}
+
+			inline bool IsSkippable(char c)
+			{
+				return ' ' == c || '\t' == c || '\n' == c || '\r' == c || ':' == c || '-' == c;
+			}
+
+			// Portable implementation, also used for the tails of the vectorized ones
+			void EncodeScalar(char *dst, const unsigned char *src, size_t n)
+			{
+				for (size_t i = 0; i < n; ++i) {
+					EncodeByte(dst + 2 * i, src[i]);
+				}
+			}
+
+#ifdef ZBASE_HAS_X86_SIMD
+			__attribute__((target("ssse3")))
+			void EncodeSSSE3(char *dst, const unsigned char *src, size_t n)
+			{
+				// pshufb looks the digit of each nibble up in a 16-entry table
+				const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits));
+				const __m128i mask = _mm_set1_epi8(0x0F);
+				size_t i = 0;
+				for (; i + 16 <= n; i += 16) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+					__m128i hi = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+					__m128i lo = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i), _mm_unpacklo_epi8(hi, lo));
+					_mm_storeu_si128(reinterpret_cast<__m128i*>(dst + 2 * i + 16), _mm_unpackhi_epi8(hi, lo));
+				}
+				EncodeScalar(dst + 2 * i, src + i, n - i);
+			}
+
+			__attribute__((target("avx2")))
+			void EncodeAVX2(char *dst, const unsigned char *src, size_t n)
+			{
+				const __m256i digits = _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits)));
+				const __m256i mask = _mm256_set1_epi8(0x0F);
+				size_t i = 0;
+				for (; i + 32 <= n; i += 32) {
+					__m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+					__m256i hi = _mm256_shuffle_epi8(digits, _mm256_and_si256(_mm256_srli_epi16(v, 4), mask));
+					__m256i lo = _mm256_shuffle_epi8(digits, _mm256_and_si256(v, mask));
+					// unpack works within 128-bit lanes: a = bytes 0-7 | 16-23, b = bytes 8-15 | 24-31
+					__m256i a = _mm256_unpacklo_epi8(hi, lo);
+					__m256i b = _mm256_unpackhi_epi8(hi, lo);
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i), _mm256_permute2x128_si256(a, b, 0x20));
+					_mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + 2 * i + 32), _mm256_permute2x128_si256(a, b, 0x31));
+				}
+				EncodeSSSE3(dst + 2 * i, src + i, n - i);
+			}
+
+			// Encode chunks of 16 bytes, each followed by the separator, 48 characters per chunk
+			__attribute__((target("ssse3")))
+			void EncodeSeparatedSSSE3(char *dst, const unsigned char *src, size_t chunks, char separator)
+			{
+				const __m128i digits = _mm_loadu_si128(reinterpret_cast<const __m128i*>(kDigits));
+				const __m128i mask = _mm_set1_epi8(0x0F);
+				// the output characters k * 3 and k * 3 + 1 are the digits of byte k, drawn from
+				// lo (digits of bytes 0-7) and hi (bytes 8-15); -128 leaves room for the separator
+				const __m128i shuffle_lo0 = _mm_setr_epi8(0, 1, -128, 2, 3, -128, 4, 5, -128, 6, 7, -128, 8, 9, -128, 10);
+				const __m128i shuffle_lo1 = _mm_setr_epi8(11, -128, 12, 13, -128, 14, 15, -128, -128, -128, -128, -128, -128, -128, -128, -128);
+				const __m128i shuffle_hi1 = _mm_setr_epi8(-128, -128, -128, -128, -128, -128, -128, -128, 0, 1, -128, 2, 3, -128, 4, 5);
+				const __m128i shuffle_hi2 = _mm_setr_epi8(-128, 6, 7, -128, 8, 9, -128, 10, 11, -128, 12, 13, -128, 14, 15, -128);
+				const __m128i sep = _mm_set1_epi8(separator);
+				const __m128i sep0 = _mm_and_si128(sep, _mm_setr_epi8(0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0));
+				const __m128i sep1 = _mm_and_si128(sep, _mm_setr_epi8(0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0));
+				const __m128i sep2 = _mm_and_si128(sep, _mm_setr_epi8(-1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1, 0, 0, -1));
+				for (size_t i = 0; i < chunks; ++i) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * i));
+					__m128i h = _mm_shuffle_epi8(digits, _mm_and_si128(_mm_srli_epi16(v, 4), mask));
+					__m128i l = _mm_shuffle_epi8(digits, _mm_and_si128(v, mask));
+					__m128i lo = _mm_unpacklo_epi8(h, l);
+					__m128i hi = _mm_unpackhi_epi8(h, l);
+					__m128i *d = reinterpret_cast<__m128i*>(dst + 48 * i);
+					_mm_storeu_si128(d, _mm_or_si128(_mm_shuffle_epi8(lo, shuffle_lo0), sep0));
+					_mm_storeu_si128(d + 1, _mm_or_si128(_mm_or_si128(_mm_shuffle_epi8(lo, shuffle_lo1), _mm_shuffle_epi8(hi, shuffle_hi1)), sep1));
+					_mm_storeu_si128(d + 2, _mm_or_si128(_mm_shuffle_epi8(hi, shuffle_hi2), sep2));
+				}
+			}
+
+			// Decode 32 hex digits into 16 bytes, return false without output if any is not a digit
+			__attribute__((target("ssse3")))
+			bool DecodeBlockSSSE3(unsigned char *dst, const char *src)
+			{
+				const __m128i zero = _mm_set1_epi8('0');
+				const __m128i lower_a = _mm_set1_epi8('a');
+				const __m128i case_bit = _mm_set1_epi8(0x20);
+				const __m128i nine = _mm_set1_epi8(9);
+				const __m128i five = _mm_set1_epi8(5);
+				const __m128i ten = _mm_set1_epi8(10);
+				// weights of the high and the low digit of each byte
+				const __m128i weights = _mm_set1_epi16(0x0110);
+				__m128i values[2];
+				for (int k = 0; k < 2; ++k) {
+					__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 16 * k));
+					__m128i d = _mm_sub_epi8(v, zero);
+					__m128i is_digit = _mm_cmpeq_epi8(_mm_min_epu8(d, nine), d);
+					__m128i l = _mm_sub_epi8(_mm_or_si128(v, case_bit), lower_a);
+					__m128i is_letter = _mm_cmpeq_epi8(_mm_min_epu8(l, five), l);
+					if (_mm_movemask_epi8(_mm_or_si128(is_digit, is_letter)) != 0xFFFF) {
+						return false;
+					}
+					__m128i nibbles = _mm_or_si128(_mm_and_si128(is_digit, d), _mm_and_si128(is_letter, _mm_add_epi8(l, ten)));
+					values[k] = _mm_maddubs_epi16(nibbles, weights);
+				}
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dst), _mm_packus_epi16(values[0], values[1]));
+				return true;
+			}
+#endif // ZBASE_HAS_X86_SIMD
+
+			EncodeFunc SelectEncode()
+			{
+#ifdef ZBASE_HAS_X86_SIMD
+				__builtin_cpu_init();
+				if (__builtin_cpu_supports("avx2")) {
+					return EncodeAVX2;
+				}
+				if (__builtin_cpu_supports("ssse3")) {
+					return EncodeSSSE3;
+				}
+#endif
+				return EncodeScalar;
+			}
+
+#ifdef ZBASE_HAS_X86_SIMD
+			bool HasSSSE3()
+			{
+				__builtin_cpu_init();
+				return __builtin_cpu_supports("ssse3");
+			}
+#endif
+		} // namespace
+
+		void Encode(char *dst, const void *src, size_t n)
+		{
+			static const EncodeFunc func = SelectEncode();
+			func(dst, static_cast<const unsigned char*>(src), n);
+		}
+
+		size_t GetFormattedSize(size_t n, size_t separator_size, size_t bytes_per_line)
+		{
+			if (0 == n) {
+				return 0;
+			}
+			if (0 == bytes_per_line || bytes_per_line > n) {
+				bytes_per_line = n;
+			}
+			size_t lines = (n + bytes_per_line - 1) / bytes_per_line;
+			// each line break replaces a separator
+			return 2 * n + (n - lines) * separator_size + (lines - 1);
+		}
+
+		std::string Format(const void *src, size_t n, const char *separator, size_t bytes_per_line)
+		{
+			const unsigned char *s = static_cast<const unsigned char*>(src);
+			size_t separator_size = (NULL != separator ? strlen(separator) : 0);
+			std::string result(GetFormattedSize(n, separator_size, bytes_per_line), '\0');
+			if (result.empty()) {
+				return result;
+			}
+			if (0 == bytes_per_line) {
+				bytes_per_line = n;
+			}
+
+			char *d = &result[0];
+			for (size_t line_begin = 0; line_begin < n; line_begin += bytes_per_line) {
+				size_t line_end = std::min(n, line_begin + bytes_per_line);
+				if (line_begin > 0) {
+					*d++ = '\n';
+				}
+				if (0 == separator_size) {
+					Encode(d, s + line_begin, line_end - line_begin);
+					d += 2 * (line_end - line_begin);
+				} else if (1 == separator_size) {
+					char c = *separator;
+					size_t i = line_begin;
+#ifdef ZBASE_HAS_X86_SIMD
+					// the vector kernel writes a separator after each byte, so it stops short of the end
+					// of the whole output; a separator after the last byte of a line is overwritten below
+					static const bool has_ssse3 = HasSSSE3();
+					size_t chunks = std::min((line_end - i) / 16, static_cast<size_t>(result.data() + result.size() - d) / 48);
+					if (has_ssse3 && chunks > 0) {
+						EncodeSeparatedSSSE3(d, s + i, chunks, c);
+						d += 48 * chunks;
+						i += 16 * chunks;
+						if (i == line_end) {
+							--d;
+							continue;
+						}
+					}
+#endif
+					for (; i + 1 < line_end; ++i) {
+						EncodeByte(d, s[i]);
+						d[2] = c;
+						d += 3;
+					}
+					EncodeByte(d, s[i]);
+					d += 2;
+				} else {
+					EncodeByte(d, s[line_begin]);
+					d += 2;
+					for (size_t i = line_begin + 1; i < line_end; ++i) {
+						memcpy(d, separator, separator_size);
+						EncodeByte(d + separator_size, s[i]);
+						d += separator_size + 2;
+					}
+				}
+			}
+			return result;
+		}
+
+		size_t Decode(void *dst, const char *src, size_t len)
+		{
+#ifdef ZBASE_HAS_X86_SIMD
+			static const bool has_ssse3 = HasSSSE3();
+#endif
+			unsigned char *d = static_cast<unsigned char*>(dst);
+			size_t i = 0;
+			while (i < len) {
+#ifdef ZBASE_HAS_X86_SIMD
+				// runs of plain digits are decoded 32 at a time, anything else byte by byte
+				if (has_ssse3 && i + 32 <= len && DecodeBlockSSSE3(d, src + i)) {
+					d += 16;
+					i += 32;
+					continue;
+				}
+#endif
+				size_t block_end = std::min(len, i + 32);
+				while (i < block_end) {
+					if (IsSkippable(src[i])) {
+						++i;
+						continue;
+					}
+					if (i + 1 >= len) {
+						return npos;
+					}
+					int hi = DigitValue(static_cast<unsigned char>(src[i]));
+					int lo = DigitValue(static_cast<unsigned char>(src[i + 1]));
+					if (hi < 0 || lo < 0) {
+						return npos;
+					}
+					*d++ = static_cast<unsigned char>((hi << 4) | lo);
+					i += 2;
+				}
+			}
+			return d - static_cast<unsigned char*>(dst);
+		}
+	} // namespace hex
+} // namespace zbase
@@ -0,0 +1,243 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/lz4.h>
+#include <zbase/inttypes.h>
+
+#include <cstring>
+
+namespace zbase
+{
+	namespace lz4
+	{
+		namespace
+		{
+			const size_t MIN_MATCH = 4;
+			// the last 5 bytes are always literals and the last match starts 12 bytes before the end
+			const size_t LAST_LITERALS = 5;
+			const size_t MATCH_FIND_LIMIT = 12;
+			const size_t MAX_DISTANCE = 65535;
+			const int HASH_LOG = 12;
+			// misses before the scan step grows by one byte
+			const int SKIP_TRIGGER = 6;
+			// slack of the 8-byte copies, which may write past the end of a literal run or match
+			const size_t WILD_COPY = 8;
+
+			typedef unsigned char byte_t;
+
+			inline uint32_t Read32(const byte_t *p)
+			{
+				uint32_t v;
+				memcpy(&v, p, sizeof(v));
+				return v;
+			}
+
+			inline uint64_t Read64(const byte_t *p)
+			{
+				uint64_t v;
+				memcpy(&v, p, sizeof(v));
+				return v;
+			}
+
+			inline size_t HashSequence(uint32_t sequence)
+			{
+				return (sequence * 2654435761U) >> (32 - HASH_LOG);
+			}
+
+			// copy n bytes in 8-byte steps, writing up to WILD_COPY - 1 bytes beyond dst + n
+			inline void WildCopy(byte_t *dst, const byte_t *src, size_t n)
+			{
+				byte_t *end = dst + n;
+				do {
+					memcpy(dst, src, 8);
+					dst += 8;
+					src += 8;
+				} while (dst < end);
+			}
+
+			inline byte_t* WriteLength(byte_t *op, size_t length)
+			{
+				for (; length >= 255; length -= 255) {
+					*op++ = 255;
+				}
+				*op++ = static_cast<byte_t>(length);
+				return op;
+			}
+
+			// read the extension bytes of a length whose token field is 15; false if the input ends
+			inline bool ReadLength(const byte_t *&ip, const byte_t *iend, size_t &length)
+			{
+				byte_t s;
+				do {
+					if (ip >= iend) {
+						return false;
+					}
+					s = *ip++;
+					length += s;
+				} while (255 == s);
+				return true;
+			}
+
+			// bytes following the token for a length of the literal run or match
+			inline size_t GetLengthSize(size_t length)
+			{
+				return length >= 15 ? (length - 15) / 255 + 1 : 0;
+			}
+		} // namespace
+
+		size_t Compress(void *dst, size_t capacity, const void *src, size_t n)
+		{
+			const byte_t *base = static_cast<const byte_t*>(src);
+			const byte_t *ip = base;
+			const byte_t *anchor = base;
+			const byte_t *end = base + n;
+			byte_t *op = static_cast<byte_t*>(dst);
+			byte_t *oend = op + capacity;
+
+			if (n >= MATCH_FIND_LIMIT + 1) {
+				uint32_t table[1 << HASH_LOG];
+				memset(table, 0, sizeof(table));
+				const byte_t *match_find_limit = end - MATCH_FIND_LIMIT;
+				const byte_t *match_limit = end - LAST_LITERALS;
+				unsigned int misses = 1 << SKIP_TRIGGER;
+
+				++ip;
+				while (ip <= match_find_limit) {
+					uint32_t sequence = Read32(ip);
+					size_t h = HashSequence(sequence);
+					const byte_t *ref = base + table[h];
+					table[h] = static_cast<uint32_t>(ip - base);
+					if (static_cast<size_t>(ip - ref) > MAX_DISTANCE || Read32(ref) != sequence) {
+						ip += misses++ >> SKIP_TRIGGER;
+						continue;
+					}
+					misses = 1 << SKIP_TRIGGER;
+
+					// extend the match backwards over pending literals, then forwards
+					while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+						--ip;
+						--ref;
+					}
+					const byte_t *mp = ip + MIN_MATCH;
+					const byte_t *rp = ref + MIN_MATCH;
+					while (mp + 8 <= match_limit && Read64(mp) == Read64(rp)) {
+						mp += 8;
+						rp += 8;
+					}
+					while (mp < match_limit && *mp == *rp) {
+						++mp;
+						++rp;
+					}
+
+					size_t literal_length = ip - anchor;
+					size_t match_length = mp - ip - MIN_MATCH;
+					if (static_cast<size_t>(oend - op) < 1 + GetLengthSize(literal_length) + literal_length + 2 + GetLengthSize(match_length)) {
+						return 0;
+					}
+					byte_t *token = op++;
+					if (literal_length >= 15) {
+						*token = 15 << 4;
+						op = WriteLength(op, literal_length - 15);
+					} else {
+						*token = static_cast<byte_t>(literal_length << 4);
+					}
+					memcpy(op, anchor, literal_length);
+					op += literal_length;
+					size_t offset = ip - ref;
+					*op++ = static_cast<byte_t>(offset);
+					*op++ = static_cast<byte_t>(offset >> 8);
+					if (match_length >= 15) {
+						*token |= 15;
+						op = WriteLength(op, match_length - 15);
+					} else {
+						*token |= static_cast<byte_t>(match_length);
+					}
+
+					ip = anchor = mp;
+					// index a position inside the match, which helps on repetitive data
+					if (ip <= match_find_limit) {
+						table[HashSequence(Read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+					}
+				}
+			}
+
+			// the last sequence has literals only
+			size_t literal_length = end - anchor;
+			if (static_cast<size_t>(oend - op) < 1 + GetLengthSize(literal_length) + literal_length) {
+				return 0;
+			}
+			if (literal_length >= 15) {
+				*op++ = 15 << 4;
+				op = WriteLength(op, literal_length - 15);
+			} else {
+				*op++ = static_cast<byte_t>(literal_length << 4);
+			}
+			if (literal_length > 0) {
+				memcpy(op, anchor, literal_length);
+				op += literal_length;
+			}
+			return op - static_cast<byte_t*>(dst);
+		}
+
+		size_t Decompress(void *dst, size_t capacity, const void *src, size_t n)
+		{
+			const byte_t *ip = static_cast<const byte_t*>(src);
+			const byte_t *iend = ip + n;
+			byte_t *obase = static_cast<byte_t*>(dst);
+			byte_t *op = obase;
+			byte_t *oend = obase + capacity;
+
+			for (;;) {
+				if (ip >= iend) {
+					return npos;
+				}
+				unsigned int token = *ip++;
+
+				size_t length = token >> 4;
+				if (15 == length && !ReadLength(ip, iend, length)) {
+					return npos;
+				}
+				if (static_cast<size_t>(iend - ip) < length || static_cast<size_t>(oend - op) < length) {
+					return npos;
+				}
+				if (static_cast<size_t>(iend - ip) >= length + WILD_COPY && static_cast<size_t>(oend - op) >= length + WILD_COPY) {
+					WildCopy(op, ip, length);
+				} else if (length > 0) {
+					memcpy(op, ip, length);
+				}
+				op += length;
+				ip += length;
+				if (ip == iend) {
+					break;
+				}
+
+				if (iend - ip < 2) {
+					return npos;
+				}
+				size_t offset = ip[0] | (static_cast<size_t>(ip[1]) << 8);
+				ip += 2;
+				if (0 == offset || offset > static_cast<size_t>(op - obase)) {
+					return npos;
+				}
+				length = token & 15;
+				if (15 == length && !ReadLength(ip, iend, length)) {
+					return npos;
+				}
+				length += MIN_MATCH;
+				if (static_cast<size_t>(oend - op) < length) {
+					return npos;
+				}
+				const byte_t *match = op - offset;
+				if (offset >= WILD_COPY && static_cast<size_t>(oend - op) >= length + WILD_COPY) {
+					WildCopy(op, match, length);
+					op += length;
+				} else {
+					// overlapping copy: the pattern repeats every offset bytes
+					for (byte_t *mend = op + length; op < mend; ) {
+						*op++ = *match++;
+					}
+				}
+			}
+			return op - obase;
+		}
+	} // namespace lz4
+} // namespace zbase
@@ -0,0 +1,95 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/octetchain.h>
+
+namespace zbase
+{
+	const size_t OctetChain::DEFAULT_REFERENCE_THRESHOLD = 4096; // 4 KB
+
+	OctetChain::OctetChain(size_t reference_threshold)
+		: m_stream_flushed(0), m_referenced_size(0), m_reference_threshold(reference_threshold)
+	{
+	}
+
+	size_t OctetChain::GetSegmentCount() const
+	{
+		return m_segments.size() + (m_stream.GetSize() > m_stream_flushed ? 1 : 0);
+	}
+
+	OctetChain& OctetChain::operator << (const Octets& value)
+	{
+		// an empty payload has nothing to reference
+		if (value.GetSize() < m_reference_threshold || value.IsEmpty()) {
+			m_stream << value;
+			return *this;
+		}
+
+		m_stream.PushLength(value.GetSize());
+		Segment segment;
+		if (m_stream.GetSize() > m_stream_flushed) {
+			segment.offset = m_stream_flushed;
+			segment.size = m_stream.GetSize() - m_stream_flushed;
+			m_segments.push_back(segment);
+			m_stream_flushed = m_stream.GetSize();
+		}
+
+		// no copy, only a reference of the shared Rep
+		segment.offset = 0;
+		segment.size = value.GetSize();
+		segment.data = value;
+		m_segments.push_back(segment);
+		m_referenced_size += value.GetSize();
+		return *this;
+	}
+
+	void OctetChain::Clear()
+	{
+		if (m_stream.GetCapacity() > 0) {
+			m_stream.Clear();
+		}
+		m_segments.clear();
+		m_stream_flushed = 0;
+		m_referenced_size = 0;
+	}
+
+	const char* OctetChain::GetSegmentData(const Segment &segment) const
+	{
+		if (segment.data.IsEmpty()) {
+			return static_cast<const char*>(m_stream.GetData()) + segment.offset;
+		}
+		return static_cast<const char*>(segment.data.GetData());
+	}
+
+	void OctetChain::CopyTo(OctetStream *stream) const
+	{
+		stream->ReserveForWrite(GetSize());
+		for (std::vector<Segment>::const_iterator it = m_segments.begin(); it != m_segments.end(); ++it) {
+			stream->Write(GetSegmentData(*it), it->size);
+		}
+		if (m_stream.GetSize() > m_stream_flushed) {
+			stream->Write(static_cast<const char*>(m_stream.GetData()) + m_stream_flushed, m_stream.GetSize() - m_stream_flushed);
+		}
+	}
+
+#ifndef ZBASE_WINDOWS
+	size_t OctetChain::GetIovec(struct iovec *iov, size_t n) const
+	{
+		size_t count = 0;
+		for (std::vector<Segment>::const_iterator it = m_segments.begin(); it != m_segments.end() && count < n; ++it) {
+			if (0 == it->size) {
+				continue;
+			}
+			iov[count].iov_base = const_cast<char*>(GetSegmentData(*it));
+			iov[count].iov_len = it->size;
+			++count;
+		}
+		if (m_stream.GetSize() > m_stream_flushed && count < n) {
+			iov[count].iov_base = const_cast<char*>(static_cast<const char*>(m_stream.GetData()) + m_stream_flushed);
+			iov[count].iov_len = m_stream.GetSize() - m_stream_flushed;
+			++count;
+		}
+		return count;
+	}
+#endif
+
+} // namespace zbase
@@ -1,77 +1,165 @@
 // Copyright (c) 2012 Junheng Zang. All Rights Reserved.
 //
 #include <zbase/octets.h>
+#include <zbase/hex.h>
 
-#include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cerrno>
 #include <algorithm>
 #include <iostream>
 #include <cassert>
+#include <new>
+#include <stdexcept>
+#include <utility>
+
+#ifdef ZBASE_WINDOWS
+#	include <fstream>
+#else
+#	include <fcntl.h>
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <unistd.h>
+#endif
 
 namespace zbase
 {
-	Octets::Rep::Rep(const void* data, size_t size) 
-		: m_data(NULL), m_capacity(size*2), m_size(size), m_refno(0)
+	static int CompareBytes(const void *a, size_t asize, const void *b, size_t bsize)
 	{
-		if (size > 0) {
-			m_data = malloc(m_capacity);
-			if (NULL != data) {
-				memcpy(m_data, data, size);
-			}
-			memset(static_cast<char*>(m_data) + size, 0, m_capacity - size);
+		size_t n = std::min(asize, bsize);
+		int retcode = (n > 0 ? memcmp(a, b, n) : 0);
+		if (0 == retcode && asize != bsize) {
+			retcode = (asize > bsize ? 1 : -1);
 		}
+		return retcode;
 	}
 
-	Octets::Rep::~Rep()
+#ifndef ZBASE_WINDOWS
+	// Owner of the mappings of Octets::MapFile(). The file is mapped right after an anonymous
+	// page whose tail holds the Rep header, so the data follows the header as in any other Rep,
+	// and the whole region can be found from the block and size passed to Deallocate().
+	class FileMappingAllocator : public Allocator
 	{
-		if (NULL != m_data) {
-			free(m_data);
-			m_data = NULL;
+	public:
+		static FileMappingAllocator* Instance()
+		{
+			static FileMappingAllocator s_instance;
+			return &s_instance;
 		}
-	}
 
-	void Octets::Rep::Reserve(size_t size)
+		// map size bytes of the file, return the block of the Rep or NULL with errno set
+		void* Map(int fd, size_t size, int hints);
+
+		// a read-only Rep is never allocated or resized by its allocator
+		virtual void* Allocate(size_t) { throw std::bad_alloc(); }
+		virtual void* Reallocate(void*, size_t, size_t) { throw std::bad_alloc(); }
+		virtual void Deallocate(void *ptr, size_t size);
+
+	private:
+		static size_t GetPageSize()
+		{
+			static const size_t s_page_size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+			return s_page_size;
+		}
+		static size_t GetRegionSize(size_t size)
+		{
+			size_t page_size = GetPageSize();
+			return page_size + (size + page_size - 1) / page_size * page_size;
+		}
+	};
+
+	void* FileMappingAllocator::Map(int fd, size_t size, int hints)
 	{
-		if (m_capacity >= size) return;
-		m_capacity = size * 2;
-		if (realloc(m_data, m_capacity) == NULL) {
-			// fatal error
-			exit(EXIT_FAILURE);
+		size_t page_size = GetPageSize();
+		size_t region_size = GetRegionSize(size);
+		char *region = static_cast<char*>(mmap(NULL, region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+		if (MAP_FAILED == region) {
+			return NULL;
 		}
-		memset(static_cast<char*>(m_data) + m_size, 0, m_capacity - m_size);
+		char *data = region + page_size;
+		if (MAP_FAILED == mmap(data, size, PROT_READ, MAP_PRIVATE | MAP_FIXED, fd, 0)) {
+			int error = errno;
+			munmap(region, region_size);
+			errno = error;
+			return NULL;
+		}
+		// hints are best effort, failures are ignored
+		if (hints & Octets::ACCESS_SEQUENTIAL) {
+			madvise(data, size, MADV_SEQUENTIAL);
+		} else if (hints & Octets::ACCESS_RANDOM) {
+			madvise(data, size, MADV_RANDOM);
+		}
+		if (hints & Octets::ACCESS_WILLNEED) {
+			madvise(data, size, MADV_WILLNEED);
+		}
+		CountAllocate(Octets::GetRepHeaderSize() + size, true);
+		return data - Octets::GetRepHeaderSize();
 	}
 
-	std::string Octets::Rep::Hex()
+	void FileMappingAllocator::Deallocate(void *ptr, size_t size)
 	{
-		std::stringstream ss;
-		char buf[3] = {0};
-		for (size_t i = 0; i < m_size; ++i) {
-			snprintf(buf, 2, "%02X", *(static_cast<char*>(m_data) + i));
-			ss << buf;
-			if (i + 1 < m_size) {
-				ss << " ";
-			}
+		size_t header_size = Octets::GetRepHeaderSize();
+		char *region = static_cast<char*>(ptr) + header_size - GetPageSize();
+		munmap(region, GetRegionSize(size - header_size));
+		CountDeallocate(size);
+	}
+#endif
+
+	Octets::Rep* Octets::Rep::Create(const void* data, size_t size, size_t capacity)
+	{
+		capacity = std::max(capacity, size);
+		Allocator *allocator = Allocator::GetCurrent();
+		void *block = allocator->Allocate(sizeof(Rep) + capacity);
+		Rep *rep = new (block) Rep(size, capacity, allocator);
+		if (NULL != data && size > 0) {
+			memcpy(rep->GetData(), data, size);
 		}
-		return ss.str();
+		return rep;
+	}
+
+	Octets::Rep* Octets::Rep::Adopt(void* block, size_t size, size_t capacity, Allocator *allocator)
+	{
+		return new (block) Rep(size, capacity, allocator);
+	}
+
+	void Octets::Rep::Destroy()
+	{
+		Allocator *allocator = m_allocator;
+		size_t block_size = sizeof(Rep) + m_capacity;
+		this->~Rep();
+		allocator->Deallocate(this, block_size);
+	}
+
+	Octets::Rep* Octets::Rep::Reserve(size_t size)
+	{
+		assert(IsWritable());
+		if (m_capacity >= size) return this;
+		size_t capacity = size * 2;
+		Rep *rep = static_cast<Rep*>(m_allocator->Reallocate(this, sizeof(Rep) + m_capacity, sizeof(Rep) + capacity));
+		rep->m_capacity = capacity;
+		return rep;
 	}
 
-	Octets::Octets() : m_rep(NULL)
+	Octets::Octets() : m_rep(NULL), m_small_size(0)
 	{
 	}
 
-	Octets::Octets(const void *data, size_t size)
+	Octets::Octets(const void *data, size_t size) : m_rep(NULL), m_small_size(0)
 	{
 		assert(NULL != data && size > 0);
-		m_rep = new Rep(data, size);
+		if (size <= SMALL_CAPACITY) {
+			AssignSmall(data, size);
+		} else {
+			m_rep = Rep::Create(data, size, size);
+		}
 	}
 
-	Octets::Octets(const std::string& str)
+	Octets::Octets(const std::string& str) : m_rep(NULL), m_small_size(0)
 	{
-		if (str.size() > 0) {
-			m_rep = new Rep(str.c_str(), str.size());
+		if (str.size() <= SMALL_CAPACITY) {
+			AssignSmall(str.c_str(), str.size());
 		} else {
-			m_rep = NULL;
+			m_rep = Rep::Create(str.c_str(), str.size(), str.size());
 		}
 	}
 
@@ -82,51 +170,119 @@ namespace zbase
 		}
 	}
 
-	Octets::Octets(const Octets& other)
+	// m_small_size is 0 whenever m_rep is set, see Swap()
+	Octets::Octets(const Octets& other) : m_rep(other.m_rep), m_small_size(NULL == other.m_rep ? other.m_small_size : 0)
 	{
-		m_rep = const_cast<Rep*>(other.m_rep);
 		if (NULL != m_rep) {
 			m_rep->AddRef();
+		} else {
+			memcpy(m_small, other.m_small, m_small_size);
 		}
 	}
 
 	Octets& Octets::operator = (const Octets& rhs)
 	{
 		// avoid self assignment
-		if (m_rep == rhs.m_rep) {
+		if (this == &rhs || (NULL != m_rep && m_rep == rhs.m_rep)) {
+			return *this;
+		}
+		if (NULL == rhs.m_rep) {
+			AssignSmall(rhs.m_small, rhs.m_small_size);
 			return *this;
 		}
 		if (NULL != m_rep) {
 			m_rep->Release();
 		}
-		m_rep = const_cast<Rep*>(rhs.m_rep);
+		m_rep = rhs.m_rep;
+		m_rep->AddRef();
+		m_small_size = 0;
+		return *this;
+	}
+
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	Octets::Octets(Octets&& other) : m_rep(other.m_rep), m_small_size(other.m_small_size)
+	{
+		if (NULL == m_rep) {
+			memcpy(m_small, other.m_small, m_small_size);
+		}
+		other.m_rep = NULL;
+		other.m_small_size = 0;
+	}
+
+	Octets& Octets::operator = (Octets&& rhs)
+	{
+		if (this == &rhs) {
+			return *this;
+		}
 		if (NULL != m_rep) {
-			m_rep->AddRef();
+			m_rep->Release();
 		}
+		m_rep = rhs.m_rep;
+		m_small_size = rhs.m_small_size;
+		if (NULL == m_rep) {
+			memcpy(m_small, rhs.m_small, m_small_size);
+		}
+		rhs.m_rep = NULL;
+		rhs.m_small_size = 0;
 		return *this;
 	}
+#endif
+
+	Octets Octets::AdoptBuffer(void *block, size_t size, size_t capacity, Allocator *allocator)
+	{
+		assert(NULL != block && capacity >= size);
+		if (NULL == allocator) {
+			allocator = Allocator::GetDefault();
+		}
+		if (size <= SMALL_CAPACITY) {
+			Octets o;
+			o.AssignSmall(static_cast<char*>(block) + sizeof(Rep), size);
+			allocator->Deallocate(block, sizeof(Rep) + capacity);
+			return o;
+		}
+		return Octets(Rep::Adopt(block, size, capacity, allocator));
+	}
+
+	void Octets::AssignSmall(const void *data, size_t size)
+	{
+		assert(size <= SMALL_CAPACITY);
+		if (NULL != m_rep) {
+			m_rep->Release();
+			m_rep = NULL;
+		}
+		if (size > 0) {
+			memcpy(m_small, data, size);
+		}
+		m_small_size = static_cast<unsigned char>(size);
+	}
 
 	int Octets::Compare(const Octets& rhs) const
 	{
-		size_t n = std::min(GetSize(), rhs.GetSize());
-		int retcode = memcmp(GetData(), rhs.GetData(), n);
-		if (0 == retcode && GetSize() != rhs.GetSize()) {
-			retcode = (GetSize() > rhs.GetSize() ? 1 : -1);
+		return CompareBytes(GetData(), GetSize(), rhs.GetData(), rhs.GetSize());
+	}
+
+	OctetsSlice Octets::Slice(size_t pos, size_t len) const
+	{
+		if (pos > GetSize()) {
+			throw std::out_of_range("Octets::Slice");
 		}
-		return retcode;
+		return OctetsSlice(*this, pos, std::min(len, GetSize() - pos));
 	}
 
 	Octets& Octets::Assign(const void *data, size_t size)
 	{
 		assert(NULL != data && size > 0);
-		if (NULL == m_rep) {
-			m_rep = new Rep(data, size);
-		} else if (m_rep->IsShared()) {
+		if (size <= SMALL_CAPACITY) {
+			AssignSmall(data, size);
+		} else if (NULL == m_rep) {
+			m_rep = Rep::Create(data, size, size);
+			m_small_size = 0;
+		} else if (!m_rep->IsWritable()) {
 			m_rep->Release();
-			m_rep = new Rep(data, size);
+			m_rep = Rep::Create(data, size, size);
 		} else {
 			if (m_rep->GetCapacity() < size) {
-				m_rep->Reserve(size);
+				m_rep = m_rep->Reserve(size);
 			}
 			memcpy(m_rep->GetData(), data, size);
 			m_rep->SetSize(size);
@@ -138,14 +294,23 @@ namespace zbase
 	{
 		assert(NULL != data && size > 0);
 		if (NULL == m_rep) {
-			m_rep = new Rep(data, size);
+			if (m_small_size + size <= SMALL_CAPACITY) {
+				memcpy(m_small + m_small_size, data, size);
+				m_small_size += size;
+				return *this;
+			}
+			// move out of the small buffer
+			m_rep = Rep::Create(NULL, m_small_size + size, m_small_size + size);
+			memcpy(m_rep->GetData(), m_small, m_small_size);
+			memcpy(static_cast<char*>(m_rep->GetData()) + m_small_size, data, size);
+			m_small_size = 0;
 		} else {
-			if (m_rep->IsShared()) {
+			if (!m_rep->IsWritable()) {
+				Rep *rep = m_rep->Clone(m_rep->GetSize() + size);
 				m_rep->Release();
-				m_rep = m_rep->Clone();
-			}
-			if (m_rep->GetCapacity() - m_rep->GetSize() < size) {
-				m_rep->Reserve(m_rep->GetSize() + size);
+				m_rep = rep;
+			} else if (m_rep->GetCapacity() - m_rep->GetSize() < size) {
+				m_rep = m_rep->Reserve(m_rep->GetSize() + size);
 			}
 			memcpy(static_cast<char*>(m_rep->GetData()) + m_rep->GetSize(), data, size);
 			m_rep->SetSize(m_rep->GetSize() + size);
@@ -155,33 +320,231 @@ namespace zbase
 
 	Octets& Octets::Append(const Octets& o)
 	{
+		if (o.IsEmpty()) {
+			return *this;
+		}
 		return Append(o.GetData(), o.GetSize());
 	}
 
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	Octets& Octets::Append(Octets&& o)
+	{
+		if (IsEmpty()) {
+			return *this = std::move(o);
+		}
+		return Append(static_cast<const Octets&>(o));
+	}
+#endif
+
 	void Octets::Swap(Octets& rhs)
 	{
 		Rep *p = m_rep;
 		m_rep = rhs.m_rep;
 		rhs.m_rep = p;
+		// bytes beyond the small sizes are never initialized
+		std::swap_ranges(m_small, m_small + std::max(m_small_size, rhs.m_small_size), rhs.m_small);
+		std::swap(m_small_size, rhs.m_small_size);
 	}
 
 	void Octets::Clear()
 	{
-		if (NULL != m_rep) {
-			if (m_rep->IsShared()) {
-				m_rep->Release();
-				m_rep = NULL;
+		if (NULL == m_rep) {
+			m_small_size = 0;
+		} else if (!m_rep->IsWritable()) {
+			m_rep->Release();
+			m_rep = NULL;
+			m_small_size = 0;
+		} else {
+			memset(m_rep->GetData(), 0, m_rep->GetSize());
+			m_rep->SetSize(0);
+		}
+	}
+
+	std::string Octets::Hex(const char *separator, size_t bytes_per_line) const
+	{
+		return hex::Format(GetData(), GetSize(), separator, bytes_per_line);
+	}
+
+	Octets Octets::FromHex(const std::string& hex)
+	{
+		Octets result;
+		if (hex.size() / 2 <= SMALL_CAPACITY) {
+			size_t size = hex::Decode(result.m_small, hex.data(), hex.size());
+			if (hex::npos == size) {
+				throw std::invalid_argument("Octets::FromHex");
+			}
+			result.m_small_size = static_cast<unsigned char>(size);
+		} else {
+			result.m_rep = Rep::Create(NULL, 0, hex.size() / 2);
+			size_t size = hex::Decode(result.m_rep->GetData(), hex.data(), hex.size());
+			if (hex::npos == size) {
+				throw std::invalid_argument("Octets::FromHex");
+			}
+			result.m_rep->SetSize(size);
+			if (size <= SMALL_CAPACITY) {
+				// separators made the input look longer than it is
+				Octets small;
+				small.AssignSmall(result.m_rep->GetData(), size);
+				return small;
+			}
+		}
+		return result;
+	}
+
+#ifdef ZBASE_WINDOWS
+	Octets Octets::MapFile(const std::string& path, int hints)
+	{
+		// no mapping support yet, read the whole file
+		std::ifstream ifs(path.c_str(), std::ios::in | std::ios::binary);
+		if (!ifs) {
+			throw std::runtime_error("Octets::MapFile: cannot open " + path);
+		}
+		ifs.seekg(0, std::ios::end);
+		size_t size = static_cast<size_t>(ifs.tellg());
+		ifs.seekg(0, std::ios::beg);
+		Octets result;
+		if (size > 0) {
+			result.m_rep = Rep::Create(NULL, size, size);
+			if (!ifs.read(static_cast<char*>(result.m_rep->GetData()), size)) {
+				throw std::runtime_error("Octets::MapFile: cannot read " + path);
+			}
+			if (size <= SMALL_CAPACITY) {
+				Octets small;
+				small.AssignSmall(result.m_rep->GetData(), size);
+				return small;
+			}
+		}
+		return result;
+	}
+#else
+	Octets Octets::MapFile(const std::string& path, int hints)
+	{
+		int fd = open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("Octets::MapFile: cannot open " + path + ": " + strerror(errno));
+		}
+		Octets result;
+		const char *failure = NULL;
+		struct stat st;
+		if (0 != fstat(fd, &st)) {
+			failure = "cannot stat ";
+		} else if (!S_ISREG(st.st_mode)) {
+			errno = EINVAL;
+			failure = "not a regular file ";
+		} else if (static_cast<size_t>(st.st_size) <= SMALL_CAPACITY) {
+			size_t size = static_cast<size_t>(st.st_size);
+			if (size > 0 && pread(fd, result.m_small, size, 0) != static_cast<ssize_t>(size)) {
+				failure = "cannot read ";
 			} else {
-				memset(m_rep->GetData(), 0, m_rep->GetSize());
-				m_rep->SetSize(0);
+				result.m_small_size = static_cast<unsigned char>(size);
+			}
+		} else {
+			size_t size = static_cast<size_t>(st.st_size);
+			FileMappingAllocator *allocator = FileMappingAllocator::Instance();
+			void *block = allocator->Map(fd, size, hints);
+			if (NULL == block) {
+				failure = "cannot map ";
+			} else {
+				result.m_rep = Rep::Adopt(block, size, size, allocator);
+				result.m_rep->SetReadOnly();
 			}
 		}
+		int error = errno;
+		close(fd);
+		if (NULL != failure) {
+			throw std::runtime_error(std::string("Octets::MapFile: ") + failure + path + ": " + strerror(error));
+		}
+		return result;
+	}
+#endif
+
+	OctetsSlice OctetsSlice::Slice(size_t pos, size_t len) const
+	{
+		if (pos > m_size) {
+			throw std::out_of_range("OctetsSlice::Slice");
+		}
+		return OctetsSlice(m_base, m_offset + pos, std::min(len, m_size - pos));
+	}
+
+	Octets OctetsSlice::ToOctets() const
+	{
+		if (m_offset == 0 && m_size == m_base.GetSize()) {
+			return m_base;
+		}
+		return 0 == m_size ? Octets() : Octets(GetData(), m_size);
+	}
+
+	int OctetsSlice::Compare(const OctetsSlice& rhs) const
+	{
+		return CompareBytes(GetData(), m_size, rhs.GetData(), rhs.m_size);
+	}
+
+	std::string OctetsSlice::Hex(const char *separator, size_t bytes_per_line) const
+	{
+		return hex::Format(GetData(), m_size, separator, bytes_per_line);
+	}
+
+	void OctetsSlice::Detach()
+	{
+		if (m_offset == 0 && m_size == m_base.GetSize()) {
+			return;
+		}
+		Octets o;
+		if (m_size > 0) {
+			o.Assign(GetData(), m_size);
+		}
+		m_base.Swap(o);
+		m_offset = 0;
+	}
+
+	OctetsSlice& OctetsSlice::Assign(const void *data, size_t size)
+	{
+		assert(NULL != data && size > 0);
+		// never write through a Rep that other objects may still refer to
+		Octets o(data, size);
+		m_base.Swap(o);
+		m_offset = 0;
+		m_size = size;
+		return *this;
+	}
+
+	OctetsSlice& OctetsSlice::Append(const void *data, size_t size)
+	{
+		assert(NULL != data && size > 0);
+		Detach();
+		// Octets does copy-on-write itself if the Rep is shared
+		m_base.Append(data, size);
+		m_size = m_base.GetSize();
+		return *this;
+	}
+
+	void OctetsSlice::Clear()
+	{
+		Octets o;
+		m_base.Swap(o);
+		m_offset = 0;
+		m_size = 0;
+	}
+
+	int OctetsView::Compare(const OctetsView& rhs) const
+	{
+		return CompareBytes(m_data, m_size, rhs.m_data, rhs.m_size);
 	}
 
 	Octets operator + (const Octets& a, const Octets& b)
 	{
-		return Octets(a) += b;
+		Octets result(a);
+		result += b;
+		return result;
+	}
+
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	Octets operator + (Octets&& a, const Octets& b)
+	{
+		a += b;
+		return std::move(a);
 	}
+#endif
 
 	std::ostringstream& operator << (std::ostringstream& oss, const Octets& data)
 	{
@@ -194,5 +557,10 @@ namespace zbase
 		return oss.write(static_cast<const char*>(data.GetData()), data.GetSize());
 	}
 
+	std::ostream& operator << (std::ostream& oss, const OctetsSlice& data)
+	{
+		return oss.write(static_cast<const char*>(data.GetData()), data.GetSize());
+	}
+
 } // namespace zbase
 
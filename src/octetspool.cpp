@@ -0,0 +1,168 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/octetspool.h>
+
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+#ifdef ZBASE_HAS_STD_HASH
+#	include <unordered_map>
+#else
+#	include <map>
+#endif
+
+namespace zbase
+{
+	const size_t OctetsPool::DEFAULT_SHARD_COUNT = 16;
+
+	struct OctetsPool::Shard
+	{
+		// values by hash
+#ifdef ZBASE_HAS_STD_HASH
+		typedef std::unordered_multimap<size_t, Octets> Table;
+#else
+		typedef std::multimap<size_t, Octets> Table;
+#endif
+
+		Shard() : bytes_stored(0), lookups(0), hits(0), bytes_saved(0) {}
+
+		boost::mutex mutex;
+		Table table;
+		size_t bytes_stored;
+		size_t lookups;
+		size_t hits;
+		size_t bytes_saved;
+	};
+
+	OctetsPool::OctetsPool(size_t shard_count)
+		: m_shards(NULL), m_shard_count(shard_count > 0 ? shard_count : 1)
+	{
+		m_shards = new Shard[m_shard_count];
+	}
+
+	OctetsPool::~OctetsPool()
+	{
+		delete[] m_shards;
+	}
+
+	OctetsPool::Shard& OctetsPool::GetShard(size_t hash) const
+	{
+		return m_shards[hash % m_shard_count];
+	}
+
+	Octets OctetsPool::Intern(const Octets& o)
+	{
+		return Intern(OctetsView(o), &o);
+	}
+
+	Octets OctetsPool::Intern(const void *data, size_t size)
+	{
+		return Intern(OctetsView(data, size), NULL);
+	}
+
+	Octets OctetsPool::Intern(const OctetsView& key, const Octets *o)
+	{
+		size_t hash = key.Hash();
+		Shard& shard = GetShard(hash);
+		boost::lock_guard<boost::mutex> guard(shard.mutex);
+		++shard.lookups;
+		std::pair<Shard::Table::iterator, Shard::Table::iterator> range = shard.table.equal_range(hash);
+		for (Shard::Table::iterator it = range.first; it != range.second; ++it) {
+			if (OctetsView(it->second) == key) {
+				++shard.hits;
+				// the caller would have kept a Rep of its own unless the data fits the small buffer
+				if (key.GetSize() > Octets::SMALL_CAPACITY && (NULL == o || !o->SharesDataWith(it->second))) {
+					shard.bytes_saved += Octets::GetRepHeaderSize() + key.GetSize();
+				}
+				return it->second;
+			}
+		}
+
+		// The pool outlives any arena or file mapping, so it only keeps the caller's Rep if that
+		// comes from the default allocator. Other values, and small values, which need a Rep of
+		// their own so that all interned values have one, are copied.
+		Octets value;
+		if (NULL != o && !o->IsSmall() && !o->IsReadOnly() && o->m_rep->GetAllocator() == Allocator::GetDefault()) {
+			value = *o;
+		} else {
+			ScopedAllocator scope(Allocator::GetDefault());
+			value = Octets(Octets::Rep::Create(key.GetData(), key.GetSize(), key.GetSize()));
+		}
+		shard.table.insert(std::make_pair(hash, value));
+		shard.bytes_stored += key.GetSize();
+		return value;
+	}
+
+	bool OctetsPool::Find(const OctetsView& key, Octets *result) const
+	{
+		size_t hash = key.Hash();
+		Shard& shard = GetShard(hash);
+		boost::lock_guard<boost::mutex> guard(shard.mutex);
+		++shard.lookups;
+		std::pair<Shard::Table::iterator, Shard::Table::iterator> range = shard.table.equal_range(hash);
+		for (Shard::Table::iterator it = range.first; it != range.second; ++it) {
+			if (OctetsView(it->second) == key) {
+				++shard.hits;
+				*result = it->second;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	size_t OctetsPool::Purge()
+	{
+		size_t count = 0;
+		for (size_t i = 0; i < m_shard_count; ++i) {
+			Shard& shard = m_shards[i];
+			boost::lock_guard<boost::mutex> guard(shard.mutex);
+			for (Shard::Table::iterator it = shard.table.begin(); it != shard.table.end(); ) {
+				// no new reference can be taken without the lock, so an unshared value is only in the pool
+				if (!it->second.IsShared()) {
+					shard.bytes_stored -= it->second.GetSize();
+					shard.table.erase(it++);
+					++count;
+				} else {
+					++it;
+				}
+			}
+		}
+		return count;
+	}
+
+	void OctetsPool::Clear()
+	{
+		for (size_t i = 0; i < m_shard_count; ++i) {
+			Shard& shard = m_shards[i];
+			boost::lock_guard<boost::mutex> guard(shard.mutex);
+			shard.table.clear();
+			shard.bytes_stored = shard.lookups = shard.hits = shard.bytes_saved = 0;
+		}
+	}
+
+	size_t OctetsPool::GetSize() const
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < m_shard_count; ++i) {
+			Shard& shard = m_shards[i];
+			boost::lock_guard<boost::mutex> guard(shard.mutex);
+			size += shard.table.size();
+		}
+		return size;
+	}
+
+	OctetsPoolStats OctetsPool::GetStats() const
+	{
+		OctetsPoolStats stats = { 0, 0, 0, 0, 0 };
+		for (size_t i = 0; i < m_shard_count; ++i) {
+			Shard& shard = m_shards[i];
+			boost::lock_guard<boost::mutex> guard(shard.mutex);
+			stats.entries += shard.table.size();
+			stats.bytes_stored += shard.bytes_stored;
+			stats.lookups += shard.lookups;
+			stats.hits += shard.hits;
+			stats.bytes_saved += shard.bytes_saved;
+		}
+		return stats;
+	}
+} // namespace zbase
@@ -1,26 +1,38 @@
 // Copyright (c) 2012 Junheng Zang. All Rights Reserved.
 //
 #include <zbase/octetstream.h>
+#include <zbase/hex.h>
 
 #include <cstdlib>
 #include <cstdio>
+#include <climits>
+#include <algorithm>
+#include <new>
 
 namespace zbase
 {
 	const size_t OctetStream::PAGE_SIZE = 256; // 256 Bytes
+	const size_t OctetStream::LARGE_PAGE_SIZE = 4096; // 4 KB
+
+	size_t ISerialize::GetPackSize() const
+	{
+		OctetStream stream;
+		Serialize(&stream);
+		return stream.GetSize();
+	}
 
 	OctetStream::OctetStream()
-		: m_buffer(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(false)
+		: m_buffer(NULL), m_allocator(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(false), m_growth_policy(GROWTH_GEOMETRIC), m_integer_encoding(ENCODING_FIXED)
 	{
 		//reserve(PAGE_SIZE);
 	}
 
 	OctetStream::OctetStream(const void *data, size_t n, bool is_attach)
-		: m_buffer(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(is_attach)
+		: m_buffer(NULL), m_allocator(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(is_attach), m_growth_policy(GROWTH_GEOMETRIC), m_integer_encoding(ENCODING_FIXED)
 	{
 		if (is_attach) {
 			Attach(data, n);
-		} else {
+		} else if (n > 0) {
 			Reserve((n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
 			memcpy(m_buffer, data, n);
 			m_read_pos = 0;
@@ -28,12 +40,12 @@ namespace zbase
 		}
 	}
 
-	OctetStream::OctetStream(Octets& data, bool is_attach)
-		: m_buffer(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(is_attach)
+	OctetStream::OctetStream(const Octets& data, bool is_attach)
+		: m_buffer(NULL), m_allocator(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(is_attach), m_growth_policy(GROWTH_GEOMETRIC), m_integer_encoding(ENCODING_FIXED)
 	{
 		if (is_attach) {
-			Attach(data.GetData(), data.GetSize());
-		} else {
+			Attach(data);
+		} else if (!data.IsEmpty()) {
 			Reserve((data.GetSize() + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
 			memcpy(m_buffer, data.GetData(), data.GetSize());
 			m_read_pos = 0;
@@ -49,10 +61,10 @@ namespace zbase
 	}
 
 	OctetStream::OctetStream(const OctetStream& rhs)
-		: m_buffer(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(false)
+		: m_buffer(NULL), m_allocator(NULL), m_capacity(0), m_read_pos(0), m_write_pos(0), m_is_attach_mode(false), m_growth_policy(rhs.m_growth_policy), m_integer_encoding(rhs.m_integer_encoding)
 	{
-		Reserve(rhs.m_capacity);
-		memcpy(m_buffer, rhs.m_buffer, rhs.m_capacity);
+		Reserve(rhs.m_write_pos);
+		memcpy(m_buffer, rhs.m_buffer, rhs.m_write_pos);
 		m_read_pos = rhs.m_read_pos;
 		m_write_pos = rhs.m_write_pos;
 	}
@@ -63,23 +75,85 @@ namespace zbase
 		if (this == &rhs) {
 			return *this;
 		}
-
-		if (m_capacity < rhs.m_capacity) {
-			Reserve(rhs.m_capacity);
-		} else if (m_capacity > rhs.m_capacity) {
-			memset(m_buffer, 0, m_capacity - rhs.m_capacity);
+		if (m_is_attach_mode) {
+			m_buffer = NULL;
+			m_capacity = m_read_pos = m_write_pos = 0;
+			m_is_attach_mode = false;
+			m_attached = Octets();
 		}
-		memcpy(m_buffer, rhs.m_buffer, rhs.m_capacity);
+
+		Reserve(rhs.m_write_pos);
+		memcpy(m_buffer, rhs.m_buffer, rhs.m_write_pos);
 		m_read_pos = rhs.m_read_pos;
 		m_write_pos = rhs.m_write_pos;
 		m_is_attach_mode = false;
+		m_growth_policy = rhs.m_growth_policy;
+		m_integer_encoding = rhs.m_integer_encoding;
 		return *this;
 	}
 
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	OctetStream::OctetStream(OctetStream&& rhs)
+		: m_buffer(rhs.m_buffer), m_allocator(rhs.m_allocator), m_capacity(rhs.m_capacity), m_read_pos(rhs.m_read_pos), m_write_pos(rhs.m_write_pos),
+		  m_is_attach_mode(rhs.m_is_attach_mode), m_attached(std::move(rhs.m_attached)), m_growth_policy(rhs.m_growth_policy), m_integer_encoding(rhs.m_integer_encoding)
+	{
+		if (m_is_attach_mode && m_attached.IsSmall() && !m_attached.IsEmpty()) {
+			// the data is inline in the moved Octets object
+			m_buffer = static_cast<byte_t*>(const_cast<void*>(m_attached.GetData()));
+		}
+		rhs.m_buffer = NULL;
+		rhs.m_capacity = rhs.m_read_pos = rhs.m_write_pos = 0;
+		rhs.m_is_attach_mode = false;
+	}
+
+	OctetStream& OctetStream::operator = (OctetStream&& rhs)
+	{
+		if (this == &rhs) {
+			return *this;
+		}
+		Release();
+		m_buffer = rhs.m_buffer;
+		m_allocator = rhs.m_allocator;
+		m_capacity = rhs.m_capacity;
+		m_read_pos = rhs.m_read_pos;
+		m_write_pos = rhs.m_write_pos;
+		m_is_attach_mode = rhs.m_is_attach_mode;
+		m_attached = std::move(rhs.m_attached);
+		if (m_is_attach_mode && m_attached.IsSmall() && !m_attached.IsEmpty()) {
+			m_buffer = static_cast<byte_t*>(const_cast<void*>(m_attached.GetData()));
+		}
+		m_growth_policy = rhs.m_growth_policy;
+		m_integer_encoding = rhs.m_integer_encoding;
+		rhs.m_buffer = NULL;
+		rhs.m_capacity = rhs.m_read_pos = rhs.m_write_pos = 0;
+		rhs.m_is_attach_mode = false;
+		return *this;
+	}
+#endif
+
+	Octets OctetStream::TakeOctets()
+	{
+		if (m_is_attach_mode || GetSize() <= Octets::SMALL_CAPACITY) {
+			Octets result;
+			if (!IsEmpty()) {
+				result.Assign(GetData(), GetSize());
+			}
+			m_read_pos = m_write_pos;
+			return result;
+		}
+
+		// hand the buffer over to the Octets object
+		Compact();
+		Octets result = Octets::AdoptBuffer(m_buffer - Octets::GetRepHeaderSize(), m_write_pos, m_capacity, m_allocator);
+		m_buffer = NULL;
+		m_capacity = m_read_pos = m_write_pos = 0;
+		return result;
+	}
+
 	void OctetStream::Release()
 	{
 		if (!m_is_attach_mode && NULL != m_buffer) {
-			delete[] m_buffer;
+			m_allocator->Deallocate(m_buffer - Octets::GetRepHeaderSize(), Octets::GetRepHeaderSize() + m_capacity);
 			m_buffer = NULL;
 			m_capacity = m_read_pos = m_write_pos = 0;
 		}
@@ -105,13 +179,54 @@ namespace zbase
 		m_read_pos += n;
 	}
 
+	const OctetStream::byte_t* OctetStream::PopBytePtr(size_t n)
+		throw (std::length_error)
+	{
+		assert(m_write_pos >= m_read_pos);
+
+		if (static_cast<size_t>(m_write_pos - m_read_pos) < n) {
+			throw std::length_error("OctetStream::PopBytePtr");
+		}
+		const byte_t *ptr = m_buffer + m_read_pos;
+		m_read_pos += n;
+		return ptr;
+	}
+
+	void OctetStream::PushVarint64(uint64_t value)
+	{
+		byte_t buf[10];
+		size_t n = 0;
+		while (value >= 0x80) {
+			buf[n++] = static_cast<byte_t>(value | 0x80);
+			value >>= 7;
+		}
+		buf[n++] = static_cast<byte_t>(value);
+		PushByte(buf, n);
+	}
+
+	bool OctetStream::DecodeVarint64Slow(uint64_t *value, size_t *n) const
+	{
+		const byte_t *p = m_buffer + m_read_pos;
+		size_t avail = std::min(static_cast<size_t>(m_write_pos - m_read_pos), static_cast<size_t>(10));
+		uint64_t v = 0;
+		for (size_t i = 0; i < avail; ++i) {
+			v |= static_cast<uint64_t>(p[i] & 0x7F) << (7 * i);
+			if (p[i] < 0x80) {
+				*value = v;
+				*n = i + 1;
+				return true;
+			}
+		}
+		return false;
+	}
+
 	void OctetStream::PushByte(const void* data, size_t n)
 	{
 		assert(!m_is_attach_mode);
 		assert(m_capacity >= m_write_pos);
 
 		if (static_cast<size_t>(m_capacity - m_write_pos) < n) {
-			Reserve(m_capacity + PAGE_SIZE);
+			Grow(m_write_pos + n);
 		}
 		memcpy(m_buffer + m_write_pos, data, n);
 		m_write_pos += n;
@@ -123,18 +238,63 @@ namespace zbase
 		assert(!m_is_attach_mode);
 
 		if (static_cast<size_t>(m_capacity) < n) {
-			m_capacity = (n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
-			m_buffer = static_cast<byte_t*>(realloc(m_buffer, m_capacity));
-			memset(m_buffer + m_write_pos, 0, m_capacity - m_write_pos);
+			// an exact capacity hint is taken as is
+			Reallocate(GROWTH_EXACT == m_growth_policy ? n : (n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE);
+		}
+	}
+
+	void OctetStream::Grow(size_t n)
+	{
+		assert(!m_is_attach_mode);
+
+		if (static_cast<size_t>(m_capacity) >= n) {
+			return;
+		}
+
+		size_t capacity = n;
+		switch (m_growth_policy) {
+		case GROWTH_EXACT:
+			break;
+		case GROWTH_PAGED:
+			capacity = (n + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+			break;
+		case GROWTH_GEOMETRIC:
+		default:
+			// doubling keeps the amortized cost of a push constant; large buffers stay page-aligned
+			capacity = std::max(n, static_cast<size_t>(m_capacity) * 2);
+			if (capacity > LARGE_PAGE_SIZE) {
+				capacity = (capacity + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * LARGE_PAGE_SIZE;
+			} else {
+				capacity = (capacity + PAGE_SIZE - 1) / PAGE_SIZE * PAGE_SIZE;
+			}
+			break;
+		}
+		Reallocate(capacity);
+	}
+
+	void OctetStream::Reallocate(size_t capacity)
+	{
+		// the owned buffer is preceded by room for an Octets Rep header, see TakeOctets()
+		const size_t header_size = Octets::GetRepHeaderSize();
+		byte_t *block;
+		if (NULL == m_buffer) {
+			// a new buffer is bound to the current allocator of the thread until released
+			m_allocator = Allocator::GetCurrent();
+			block = static_cast<byte_t*>(m_allocator->Allocate(header_size + capacity));
+		} else {
+			block = static_cast<byte_t*>(m_allocator->Reallocate(m_buffer - header_size, header_size + m_capacity, header_size + capacity));
 		}
+		m_buffer = block + header_size;
+		m_capacity = capacity;
 	}
 
-	void OctetStream::Shrink()
+	void OctetStream::Shrink(size_t capacity)
 	{
 		assert(!m_is_attach_mode);
 
-		if (m_capacity > m_write_pos) {
-			m_buffer = static_cast<byte_t*>(realloc(m_buffer, m_write_pos - 1));
+		capacity = std::max(capacity, static_cast<size_t>(m_write_pos));
+		if (static_cast<size_t>(m_capacity) > capacity && capacity > 0) {
+			Reallocate(capacity);
 		}
 	}
 
@@ -149,16 +309,34 @@ namespace zbase
 		m_read_pos = 0;
 		m_write_pos = n;
 		m_is_attach_mode = true;
+		m_attached = Octets();
 		return *this;
 	}
 
-	void OctetStream::Swap(OctetStream& rhs)
+	OctetStream& OctetStream::Attach(const Octets& data)
+		throw (std::length_error)
 	{
-		assert(!m_is_attach_mode);
+		// positions are int, larger data has to be read through slices
+		if (data.GetSize() > static_cast<size_t>(INT_MAX)) {
+			throw std::length_error("OctetStream::Attach");
+		}
+		Octets ref(data);
+		Attach(ref.GetData(), ref.GetSize());
+		m_attached.Swap(ref);
+		if (m_attached.IsSmall()) {
+			m_buffer = static_cast<byte_t*>(const_cast<void*>(m_attached.GetData()));
+		}
+		return *this;
+	}
 
+	void OctetStream::Swap(OctetStream& rhs)
+	{
 		byte_t *tmpptr = m_buffer;
 		m_buffer = rhs.m_buffer;
 		rhs.m_buffer = tmpptr;
+		Allocator *tmpallocator = m_allocator;
+		m_allocator = rhs.m_allocator;
+		rhs.m_allocator = tmpallocator;
 		int tmppos = m_capacity;
 		m_capacity = rhs.m_capacity;
 		rhs.m_capacity = tmppos;
@@ -168,6 +346,17 @@ namespace zbase
 		tmppos = m_write_pos;
 		m_write_pos = rhs.m_write_pos;
 		rhs.m_write_pos = tmppos;
+		std::swap(m_growth_policy, rhs.m_growth_policy);
+		std::swap(m_integer_encoding, rhs.m_integer_encoding);
+		std::swap(m_is_attach_mode, rhs.m_is_attach_mode);
+		m_attached.Swap(rhs.m_attached);
+		// data inline in an attached Octets object moved along with it, see Attach()
+		if (m_is_attach_mode && m_attached.IsSmall() && !m_attached.IsEmpty()) {
+			m_buffer = static_cast<byte_t*>(const_cast<void*>(m_attached.GetData()));
+		}
+		if (rhs.m_is_attach_mode && rhs.m_attached.IsSmall() && !rhs.m_attached.IsEmpty()) {
+			rhs.m_buffer = static_cast<byte_t*>(const_cast<void*>(rhs.m_attached.GetData()));
+		}
 	}
 
 	OctetStream& OctetStream::Insert(size_t pos, const void *data, size_t n)
@@ -176,7 +365,7 @@ namespace zbase
 		assert(m_capacity >= m_write_pos);
 
 		if (m_read_pos + (m_capacity - m_write_pos) < static_cast<int>(n)) {
-			Reserve(m_write_pos - m_read_pos + n);
+			Grow(m_write_pos - m_read_pos + n);
 		}
 		if (0 == pos) {
 			if (static_cast<size_t>(m_read_pos) >= n) {
@@ -209,6 +398,29 @@ namespace zbase
 		memset(m_buffer, 0, m_capacity);
 	}
 
+	void OctetStream::Compact()
+	{
+		assert(!m_is_attach_mode);
+
+		if (m_read_pos > 0) {
+			memmove(m_buffer, m_buffer + m_read_pos, m_write_pos - m_read_pos);
+			m_write_pos -= m_read_pos;
+			m_read_pos = 0;
+		}
+	}
+
+	OctetStream& OctetStream::Overwrite(size_t pos, const void *data, size_t n)
+		throw (std::out_of_range)
+	{
+		assert(!m_is_attach_mode);
+
+		if (pos > static_cast<size_t>(m_write_pos - m_read_pos) || n > m_write_pos - m_read_pos - pos) {
+			throw std::out_of_range("OctetStream::Overwrite");
+		}
+		memcpy(m_buffer + m_read_pos + pos, data, n);
+		return *this;
+	}
+
 	OctetStream& OctetStream::Ignore(size_t n)
 	{
 		if (static_cast<size_t>(m_write_pos - m_read_pos) >= n) {
@@ -229,21 +441,25 @@ namespace zbase
 		return *this;
 	}
 
-	std::string OctetStream::Hex() const
+	std::string OctetStream::Hex(const char *separator, size_t bytes_per_line) const
 	{
-		std::stringstream ss;
-		char buf[4] = {0};
-		for (int i = m_read_pos; i < m_write_pos; ++i) {
-			snprintf(buf, 3, "%02X ", *(m_buffer + i));
-			ss << buf;
-		}
-		return ss.str();
+		return hex::Format(m_buffer + m_read_pos, GetSize(), separator, bytes_per_line);
 	}
 
 	OctetStream& OctetStream::operator << (const Octets& value)
 	{
 		uint32_t len = value.GetSize();
-		PushInteger(len);
+		PushLength(len);
+		if (len > 0) {
+			PushByte(value.GetData(), len);
+		}
+		return *this;
+	}
+
+	OctetStream& OctetStream::operator << (const OctetsView& value)
+	{
+		uint32_t len = value.GetSize();
+		PushLength(len);
 		if (len > 0) {
 			PushByte(value.GetData(), len);
 		}
@@ -253,7 +469,7 @@ namespace zbase
 	OctetStream& OctetStream::operator << (const OctetStream& value)
 	{
 		uint32_t len = value.GetSize();
-		PushInteger(len);
+		PushLength(len);
 		if (len > 0) {
 			PushByte(value.GetData(), len);
 		}
@@ -263,7 +479,7 @@ namespace zbase
 	OctetStream& OctetStream::operator << (const std::string& data)
 	{
 		uint32_t len = data.size();
-		PushInteger(len);
+		PushLength(len);
 		if (len > 0) {
 			PushByte(data.c_str(), len);
 		}
@@ -272,57 +488,38 @@ namespace zbase
 
 	OctetStream& OctetStream::operator >> (Octets& value)
 	{
-		uint32_t len = PopInteger<uint32_t>();
+		uint32_t len = PopLength();
 		if (len > 0) {
-			byte_t* buf = new byte_t[len];
-			try {
-				PopByte(buf, len);
-			} catch (std::length_error &e) {
-				delete [] buf;
-				buf = NULL;
-				throw;
-			}
-			value.Append(buf, len);
-			delete [] buf;
-			buf = NULL;
+			value.Append(PopBytePtr(len), len);
+		}
+		return *this;
+	}
+
+	OctetStream& OctetStream::operator >> (OctetsView& value)
+	{
+		uint32_t len = PopLength();
+		if (len > 0) {
+			value = OctetsView(PopBytePtr(len), len);
+		} else {
+			value = OctetsView();
 		}
 		return *this;
 	}
 
 	OctetStream& OctetStream::operator >> (OctetStream& value)
 	{
-		uint32_t len = PopInteger<uint32_t>();
+		uint32_t len = PopLength();
 		if (len > 0) {
-			byte_t* buf = new byte_t[len];
-			try {
-				PopByte(buf, len);
-			} catch (std::length_error &e) {
-				delete [] buf;
-				buf = NULL;
-				throw;
-			}
-			value.Write(buf, len);
-			delete [] buf;
-			buf = NULL;
+			value.Write(PopBytePtr(len), len);
 		}
 		return *this;
 	}
 
 	OctetStream& OctetStream::operator >> (std::string& data)
 	{
-		uint32_t len = PopInteger<uint32_t>();
+		uint32_t len = PopLength();
 		if (len > 0) {
-			char* buf = new char[len];
-			try {
-				PopByte(buf, len);
-			} catch (std::length_error &e) {
-				delete [] buf;
-				buf = NULL;
-				throw;
-			}
-			data.append(buf, len);
-			delete[] buf;
-			buf = NULL;
+			data.append(reinterpret_cast<const char*>(PopBytePtr(len)), len);
 		}
 		return *this;
 	}
@@ -0,0 +1,148 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+#include <zbase/octetstreampool.h>
+#include <zbase/allocator.h>
+
+#include <vector>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/locks.hpp>
+
+namespace zbase
+{
+	const size_t OctetStreamPool::MIN_CAPACITY = 256;
+	const size_t OctetStreamPool::DEFAULT_MAX_CAPACITY = 1024 * 1024; // 1 MB
+	const size_t OctetStreamPool::DEFAULT_MAX_STREAMS_PER_CLASS = 64;
+
+	struct OctetStreamPool::SizeClass
+	{
+		SizeClass() : bytes(0), acquires(0), hits(0), releases(0), discards(0), shrinks(0) {}
+
+		boost::mutex mutex;
+		std::vector<OctetStream*> streams;
+		size_t bytes;
+		size_t acquires;
+		size_t hits;
+		size_t releases;
+		size_t discards;
+		size_t shrinks;
+	};
+
+	OctetStreamPool::OctetStreamPool(size_t max_capacity, size_t max_streams_per_class)
+		: m_classes(NULL), m_class_count(1), m_max_capacity(MIN_CAPACITY), m_max_streams_per_class(max_streams_per_class)
+	{
+		while (m_max_capacity * 2 <= max_capacity) {
+			m_max_capacity *= 2;
+			++m_class_count;
+		}
+		m_classes = new SizeClass[m_class_count];
+	}
+
+	OctetStreamPool::~OctetStreamPool()
+	{
+		Trim();
+		delete[] m_classes;
+	}
+
+	OctetStream* OctetStreamPool::Acquire(size_t capacity)
+	{
+		size_t index = 0;
+		while (index < m_class_count && GetClassCapacity(index) < capacity) {
+			++index;
+		}
+		// larger requests than the maximum capacity are counted in the last class but never hit
+		SizeClass& size_class = m_classes[index < m_class_count ? index : m_class_count - 1];
+		OctetStream *stream = NULL;
+		{
+			boost::lock_guard<boost::mutex> guard(size_class.mutex);
+			++size_class.acquires;
+			if (index < m_class_count && !size_class.streams.empty()) {
+				stream = size_class.streams.back();
+				size_class.streams.pop_back();
+				size_class.bytes -= stream->GetCapacity();
+				++size_class.hits;
+			}
+		}
+		if (NULL == stream) {
+			// pooled buffers may outlive any scoped allocator
+			ScopedAllocator scope(Allocator::GetDefault());
+			stream = new OctetStream();
+			stream->Reserve(index < m_class_count ? GetClassCapacity(index) : capacity);
+		}
+		return stream;
+	}
+
+	void OctetStreamPool::Release(OctetStream *stream)
+	{
+		if (NULL == stream) {
+			return;
+		}
+
+		// streams which were attached, had their buffer taken or regrew it from another allocator are not reused
+		bool reusable = !stream->IsAttachMode() && stream->GetCapacity() >= MIN_CAPACITY && stream->GetAllocator() == Allocator::GetDefault();
+		bool shrunk = false;
+		size_t index = 0;
+		if (reusable) {
+			// reset the positions only; Clear() would zero the whole buffer on every release
+			stream->Ignore(stream->GetSize());
+			stream->Compact();
+			if (stream->GetCapacity() > m_max_capacity) {
+				stream->Shrink(m_max_capacity);
+				shrunk = true;
+			}
+			stream->SetGrowthPolicy(OctetStream::GROWTH_GEOMETRIC);
+			stream->SetIntegerEncoding(OctetStream::ENCODING_FIXED);
+			while (index + 1 < m_class_count && GetClassCapacity(index + 1) <= stream->GetCapacity()) {
+				++index;
+			}
+		}
+
+		SizeClass& size_class = m_classes[index];
+		{
+			boost::lock_guard<boost::mutex> guard(size_class.mutex);
+			++size_class.releases;
+			if (shrunk) {
+				++size_class.shrinks;
+			}
+			if (reusable && size_class.streams.size() < m_max_streams_per_class) {
+				size_class.streams.push_back(stream);
+				size_class.bytes += stream->GetCapacity();
+				return;
+			}
+			++size_class.discards;
+		}
+		delete stream;
+	}
+
+	void OctetStreamPool::Trim()
+	{
+		for (size_t i = 0; i < m_class_count; ++i) {
+			std::vector<OctetStream*> streams;
+			{
+				SizeClass& size_class = m_classes[i];
+				boost::lock_guard<boost::mutex> guard(size_class.mutex);
+				streams.swap(size_class.streams);
+				size_class.bytes = 0;
+			}
+			for (size_t j = 0; j < streams.size(); ++j) {
+				delete streams[j];
+			}
+		}
+	}
+
+	OctetStreamPoolStats OctetStreamPool::GetStats() const
+	{
+		OctetStreamPoolStats stats = { 0, 0, 0, 0, 0, 0, 0 };
+		for (size_t i = 0; i < m_class_count; ++i) {
+			SizeClass& size_class = m_classes[i];
+			boost::lock_guard<boost::mutex> guard(size_class.mutex);
+			stats.acquires += size_class.acquires;
+			stats.hits += size_class.hits;
+			stats.releases += size_class.releases;
+			stats.discards += size_class.discards;
+			stats.shrinks += size_class.shrinks;
+			stats.pooled_streams += size_class.streams.size();
+			stats.pooled_bytes += size_class.bytes;
+		}
+		return stats;
+	}
+} // namespace zbase
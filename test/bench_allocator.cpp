@@ -0,0 +1,102 @@
+// Multithreaded benchmark of the Octets/OctetStream allocators
+//
+// Usage: bench_allocator [threads] [requests per thread]
+//
+// Every thread handles requests that build a few messages of mixed sizes into an
+// OctetStream, take them out as Octets and drop them, as a request handler would.
+#include <zbase/allocator.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+using namespace zbase;
+
+enum Mode { MODE_MALLOC, MODE_POOL, MODE_ARENA };
+
+struct Task
+{
+	Mode mode;
+	int requests;
+	size_t checksum;
+};
+
+static const size_t MESSAGES_PER_REQUEST = 16;
+
+static size_t HandleRequest(unsigned int *seed)
+{
+	static const char payload[4096] = {0};
+	std::vector<Octets> messages;
+	messages.reserve(MESSAGES_PER_REQUEST);
+	for (size_t i = 0; i < MESSAGES_PER_REQUEST; ++i) {
+		size_t size = 16 + rand_r(seed) % 2048;
+		OctetStream os;
+		os << (uint32_t)i;
+		os.Write(payload, size);
+		Octets header(payload, 32 + rand_r(seed) % 64);
+		header.Append(os.TakeOctets());
+		messages.push_back(header);
+	}
+	size_t total = 0;
+	for (size_t i = 0; i < messages.size(); ++i) {
+		total += messages[i].GetSize();
+	}
+	return total;
+}
+
+static void* RunTask(void *arg)
+{
+	Task *task = static_cast<Task*>(arg);
+	unsigned int seed = 12345;
+	task->checksum = 0;
+	if (MODE_ARENA == task->mode) {
+		ArenaAllocator arena;
+		for (int i = 0; i < task->requests; ++i) {
+			{
+				ScopedAllocator scope(&arena);
+				task->checksum += HandleRequest(&seed);
+			}
+			arena.Reset();
+		}
+	} else {
+		Allocator *allocator = (MODE_POOL == task->mode ? static_cast<Allocator*>(PoolAllocator::Instance()) : MallocAllocator::Instance());
+		ScopedAllocator scope(allocator);
+		for (int i = 0; i < task->requests; ++i) {
+			task->checksum += HandleRequest(&seed);
+		}
+	}
+	return NULL;
+}
+
+static double Run(Mode mode, int num_threads, int requests)
+{
+	std::vector<pthread_t> threads(num_threads);
+	std::vector<Task> tasks(num_threads);
+	struct timeval begin, end;
+	gettimeofday(&begin, NULL);
+	for (int i = 0; i < num_threads; ++i) {
+		tasks[i].mode = mode;
+		tasks[i].requests = requests;
+		pthread_create(&threads[i], NULL, RunTask, &tasks[i]);
+	}
+	for (int i = 0; i < num_threads; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	gettimeofday(&end, NULL);
+	return (end.tv_sec - begin.tv_sec) * 1000.0 + (end.tv_usec - begin.tv_usec) / 1000.0;
+}
+
+int main(int argc, char *argv[])
+{
+	int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+	int requests = argc > 2 ? atoi(argv[2]) : 100000;
+	const char *names[] = { "malloc", "pool", "arena" };
+	printf("%d threads, %d requests per thread, %u messages per request\n", num_threads, requests, (unsigned int)MESSAGES_PER_REQUEST);
+	for (int mode = MODE_MALLOC; mode <= MODE_ARENA; ++mode) {
+		double ms = Run(static_cast<Mode>(mode), num_threads, requests);
+		printf("%-8s %10.1f ms %12.0f requests/s\n", names[mode], ms, num_threads * requests * 1000.0 / ms);
+	}
+	return 0;
+}
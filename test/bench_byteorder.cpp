@@ -0,0 +1,127 @@
+// Benchmark of byte order conversion
+//
+// Usage: bench_byteorder [integers per round] [rounds]
+//
+// "baseline" is the former PushInteger path: an out-of-line HToLE specialization, which
+// tested the host byte order at run time, followed by a copy through Write().
+// SwapArray is compared with a loop of the BYTE_SWAP macros formerly in src/byteorder.cpp.
+#include <zbase/byteorder.h>
+#include <zbase/octetstream.h>
+#include <byteswap.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+using namespace zbase;
+
+static bool s_is_host_le = byteorder::kIsHostLE;
+
+__attribute__((noinline)) static uint32_t BaselineHToLE(uint32_t value)
+{
+	return s_is_host_le ? value : __builtin_bswap32(value);
+}
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void Report(const char *name, double seconds, size_t count)
+{
+	printf("%-28s %10.2f ns/op\n", name, seconds * 1e9 / count);
+}
+
+static void ReportBandwidth(const char *name, double seconds, size_t bytes)
+{
+	printf("%-28s %10.2f GB/s\n", name, bytes / seconds / 1e9);
+}
+
+__attribute__((noinline)) static void BaselineSwapArray(uint16_t *dst, const uint16_t *src, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		dst[i] = bswap_16(src[i]);
+	}
+}
+
+__attribute__((noinline)) static void BaselineSwapArray(uint32_t *dst, const uint32_t *src, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		dst[i] = bswap_32(src[i]);
+	}
+}
+
+__attribute__((noinline)) static void BaselineSwapArray(uint64_t *dst, const uint64_t *src, size_t n)
+{
+	for (size_t i = 0; i < n; ++i) {
+		dst[i] = bswap_64(src[i]);
+	}
+}
+
+template <typename T>
+static size_t BenchSwapArray(const char *baseline_name, const char *name, size_t n, int rounds)
+{
+	std::vector<T> src(n);
+	std::vector<T> dst(n);
+	for (size_t i = 0; i < n; ++i) {
+		src[i] = static_cast<T>(i * 2654435761U);
+	}
+	size_t checksum = 0;
+	double t = Now();
+	for (int r = 0; r < rounds; ++r) {
+		BaselineSwapArray(&dst[0], &src[0], n);
+		checksum += static_cast<size_t>(dst[r % n]);
+	}
+	ReportBandwidth(baseline_name, Now() - t, n * sizeof(T) * rounds);
+
+	t = Now();
+	for (int r = 0; r < rounds; ++r) {
+		byteorder::SwapArray(&dst[0], &src[0], n);
+		checksum += static_cast<size_t>(dst[r % n]);
+	}
+	ReportBandwidth(name, Now() - t, n * sizeof(T) * rounds);
+	return checksum;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t count = argc > 1 ? atoi(argv[1]) : 1000000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20;
+	size_t checksum = 0;
+
+	OctetStream os;
+	os.ReserveForWrite(count * sizeof(uint32_t));
+	double t = Now();
+	for (int r = 0; r < rounds; ++r) {
+		os.Clear();
+		for (size_t i = 0; i < count; ++i) {
+			uint32_t v = BaselineHToLE(static_cast<uint32_t>(i));
+			os.Write(&v, sizeof(v));
+		}
+		checksum += os.GetSize();
+	}
+	Report("baseline PushInteger", Now() - t, count * rounds);
+
+	t = Now();
+	for (int r = 0; r < rounds; ++r) {
+		os.Clear();
+		for (size_t i = 0; i < count; ++i) {
+			os << static_cast<uint32_t>(i);
+		}
+		checksum += os.GetSize();
+	}
+	Report("PushInteger", Now() - t, count * rounds);
+
+	// 64K elements per array, the size of a large container
+	size_t n = 64 * 1024;
+	int swap_rounds = static_cast<int>(count * rounds / n * 16);
+	checksum += BenchSwapArray<uint16_t>("BYTE_SWAP_16 loop", "SwapArray16", n, swap_rounds);
+	checksum += BenchSwapArray<uint32_t>("BYTE_SWAP_32 loop", "SwapArray32", n, swap_rounds);
+	checksum += BenchSwapArray<uint64_t>("BYTE_SWAP_64 loop", "SwapArray64", n, swap_rounds);
+
+	if (checksum == 0) {
+		printf("checksum 0\n");
+	}
+	return 0;
+}
@@ -0,0 +1,122 @@
+// Benchmark of block compression of serialized messages
+//
+// Usage: bench_compress [entries] [rounds]
+//
+// A replication batch of key/value updates is serialized through CompressedWriter with
+// several block sizes and read back with CompressedReader; "plain" serializes the same
+// batch into an OctetStream, which is the cost compression adds to.
+#include <zbase/compressedstream.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+struct Update
+{
+	uint64_t sequence;
+	uint32_t table;
+	std::string key;
+	std::string value;
+};
+
+static OctetStream& operator << (OctetStream &stream, const Update &update)
+{
+	return stream << update.sequence << update.table << update.key << update.value;
+}
+
+static OctetStream& operator >> (OctetStream &stream, Update &update)
+{
+	return stream >> update.sequence >> update.table >> update.key >> update.value;
+}
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static void Report(const char *name, double ms, size_t bytes)
+{
+	printf("%-24s %8.1f ms %8.0f MB/s\n", name, ms, bytes / ms / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t entries = argc > 1 ? atoi(argv[1]) : 100000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 10;
+
+	std::vector<Update> updates(entries);
+	for (size_t i = 0; i < entries; ++i) {
+		char buf[64];
+		updates[i].sequence = 1000000 + i;
+		updates[i].table = i % 8;
+		snprintf(buf, sizeof(buf), "user:%06u:profile", static_cast<unsigned int>(i % 5000));
+		updates[i].key = buf;
+		snprintf(buf, sizeof(buf), "{\"visits\":%u,\"tier\":\"%s\"}", static_cast<unsigned int>(i * 7 % 1000), i % 3 ? "free" : "premium");
+		updates[i].value = buf;
+	}
+
+	OctetStream plain;
+	double begin = Now();
+	for (int r = 0; r < rounds; ++r) {
+		plain.Clear();
+		for (size_t i = 0; i < entries; ++i) {
+			plain << updates[i];
+		}
+	}
+	Report("plain encode", Now() - begin, plain.GetSize() * rounds);
+
+	size_t block_sizes[] = { 4096, 16384, 65536, 262144 };
+	for (size_t b = 0; b < sizeof(block_sizes) / sizeof(block_sizes[0]); ++b) {
+		OctetStream output;
+		uint64_t raw_size = 0;
+		uint64_t compressed_size = 0;
+		begin = Now();
+		for (int r = 0; r < rounds; ++r) {
+			output.Clear();
+			CompressedWriter writer(&output, block_sizes[b]);
+			for (size_t i = 0; i < entries; ++i) {
+				writer << updates[i];
+			}
+			writer.End();
+			raw_size = writer.GetRawSize();
+			compressed_size = writer.GetCompressedSize();
+		}
+		double encoded = Now();
+
+		size_t checksum = 0;
+		for (int r = 0; r < rounds; ++r) {
+			CompressedReader reader;
+			reader.Feed(output.GetData(), output.GetSize());
+			OctetsView message;
+			if (!reader.NextMessage(message)) {
+				printf("incomplete message\n");
+				return 1;
+			}
+			OctetStream stream(message.GetData(), message.GetSize(), true);
+			Update update;
+			for (size_t i = 0; i < entries; ++i) {
+				update.key.clear();
+				update.value.clear();
+				stream >> update;
+				checksum += update.sequence;
+			}
+		}
+		double decoded = Now();
+
+		char label[64];
+		printf("block %u KB: ratio %.2f (%u -> %u bytes)\n", static_cast<unsigned int>(block_sizes[b] / 1024), static_cast<double>(raw_size) / compressed_size,
+			static_cast<unsigned int>(raw_size), static_cast<unsigned int>(compressed_size));
+		snprintf(label, sizeof(label), "  compress + encode");
+		Report(label, encoded - begin, raw_size * rounds);
+		snprintf(label, sizeof(label), "  decompress + decode");
+		Report(label, decoded - encoded, raw_size * rounds);
+		if (checksum == 0) {
+			printf("checksum 0\n");
+		}
+	}
+	return 0;
+}
@@ -0,0 +1,103 @@
+// Benchmark of ordered against unordered container serialization
+//
+// Usage: bench_container [entries] [rounds]
+//
+// Each round encodes a table into a reused stream and decodes it into a new container.
+// The "via map" rows copy an unordered table into a std::map before encoding it, which
+// is what had to be done before unordered containers could be serialized.
+#include <zbase/octetstream.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <map>
+#include <unordered_map>
+using namespace zbase;
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+static void Report(const char *name, double ms, size_t entries, size_t bytes)
+{
+	printf("%-28s %8.1f ms %8.1f ns/entry %8.0f MB/s\n", name, ms, ms * 1e6 / entries, bytes / ms / 1000.0);
+}
+
+template <typename Container>
+static void RoundTrip(const char *name, const Container &data, int rounds)
+{
+	OctetStream os;
+	size_t bytes = 0;
+	size_t checksum = 0;
+	double begin = Now();
+	for (int i = 0; i < rounds; ++i) {
+		os.Clear();
+		os << data;
+		bytes += os.GetSize();
+	}
+	double encoded = Now();
+	for (int i = 0; i < rounds; ++i) {
+		OctetStream in(os.GetData(), os.GetSize(), true);
+		Container decoded;
+		in >> decoded;
+		checksum += decoded.size();
+	}
+	double decoded = Now();
+
+	char label[64];
+	snprintf(label, sizeof(label), "%s encode", name);
+	Report(label, encoded - begin, data.size() * rounds, bytes);
+	snprintf(label, sizeof(label), "%s decode", name);
+	Report(label, decoded - encoded, data.size() * rounds, bytes);
+	if (checksum != data.size() * rounds) {
+		printf("checksum mismatch %u\n", (unsigned int)checksum);
+	}
+}
+
+template <typename Key, typename Value>
+static void ViaMap(const char *name, const std::unordered_map<Key, Value> &data, int rounds)
+{
+	OctetStream os;
+	size_t bytes = 0;
+	double begin = Now();
+	for (int i = 0; i < rounds; ++i) {
+		std::map<Key, Value> ordered(data.begin(), data.end());
+		os.Clear();
+		os << ordered;
+		bytes += os.GetSize();
+	}
+	char label[64];
+	snprintf(label, sizeof(label), "%s encode", name);
+	Report(label, Now() - begin, data.size() * rounds, bytes);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t entries = argc > 1 ? atoi(argv[1]) : 100000;
+	int rounds = argc > 2 ? atoi(argv[2]) : 20;
+
+	std::map<uint32_t, uint64_t> int_map;
+	std::unordered_map<uint32_t, uint64_t> int_hash;
+	std::map<std::string, uint32_t> str_map;
+	std::unordered_map<std::string, uint32_t> str_hash;
+	for (size_t i = 0; i < entries; ++i) {
+		uint32_t key = static_cast<uint32_t>(i * 2654435761U);
+		char name[32];
+		snprintf(name, sizeof(name), "instrument-%08x", key);
+		int_map[key] = i;
+		int_hash[key] = i;
+		str_map[name] = key;
+		str_hash[name] = key;
+	}
+
+	RoundTrip("map<uint32, uint64>", int_map, rounds);
+	RoundTrip("unordered_map<uint32, uint64>", int_hash, rounds);
+	ViaMap("  via map", int_hash, rounds);
+	RoundTrip("map<string, uint32>", str_map, rounds);
+	RoundTrip("unordered_map<string, uint32>", str_hash, rounds);
+	ViaMap("  via map", str_hash, rounds);
+	return 0;
+}
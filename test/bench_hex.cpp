@@ -0,0 +1,97 @@
+// Benchmark of hex encoding and decoding
+//
+// Usage: bench_hex [bytes per buffer] [iterations]
+//
+// The baseline is the former implementation of Octets::Hex(), which formatted each byte
+// with snprintf() into a std::stringstream.
+#include <zbase/hex.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+static std::string BaselineHex(const void *buf, size_t size)
+{
+	std::stringstream ss;
+	const unsigned char *data = static_cast<const unsigned char*>(buf);
+	char tmp[3] = {0};
+	for (size_t i = 0; i < size; ++i) {
+		snprintf(tmp, sizeof(tmp), "%02X", data[i]);
+		ss << tmp;
+		if (i + 1 < size) {
+			ss << " ";
+		}
+	}
+	return ss.str();
+}
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void Report(const char *name, double seconds, size_t bytes)
+{
+	printf("%-28s %10.1f MB/s\n", name, bytes / seconds / 1e6);
+}
+
+int main(int argc, char *argv[])
+{
+	size_t size = argc > 1 ? atoi(argv[1]) : 1500;
+	int iterations = argc > 2 ? atoi(argv[2]) : 20000;
+	std::vector<unsigned char> data(size);
+	for (size_t i = 0; i < size; ++i) {
+		data[i] = static_cast<unsigned char>(rand());
+	}
+	size_t total = size * iterations;
+	size_t checksum = 0;
+	printf("%u bytes per buffer, %d iterations\n", (unsigned int)size, iterations);
+
+	double t = Now();
+	for (int i = 0; i < iterations / 20 + 1; ++i) {
+		checksum += BaselineHex(&data[0], size).size();
+	}
+	Report("baseline snprintf", Now() - t, size * (iterations / 20 + 1));
+
+	t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		checksum += hex::Format(&data[0], size).size();
+	}
+	Report("Format(\" \")", Now() - t, total);
+
+	t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		checksum += hex::Format(&data[0], size, " ", 16).size();
+	}
+	Report("Format(\" \", 16)", Now() - t, total);
+
+	std::string encoded(2 * size, '\0');
+	t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		hex::Encode(&encoded[0], &data[0], size);
+		checksum += encoded[i % encoded.size()];
+	}
+	Report("Encode", Now() - t, total);
+
+	std::vector<unsigned char> decoded(size);
+	t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		checksum += hex::Decode(&decoded[0], encoded.data(), encoded.size());
+	}
+	Report("Decode", Now() - t, total);
+
+	std::string dump = hex::Format(&data[0], size, " ", 16);
+	t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		checksum += hex::Decode(&decoded[0], dump.data(), dump.size());
+	}
+	Report("Decode(dump)", Now() - t, total);
+
+	printf("checksum %u\n", (unsigned int)checksum);
+	return 0;
+}
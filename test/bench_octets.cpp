@@ -0,0 +1,96 @@
+// Benchmark of short Octets
+//
+// Usage: bench_octets [iterations]
+//
+// Each iteration creates, copies, assigns and destroys an Octets. "baseline" mimics the
+// former representation: a refcounted Rep and a separate data block for every payload.
+#include <zbase/octets.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace zbase;
+
+class BaselineOctets
+{
+public:
+	BaselineOctets(const void *data, size_t size) : m_rep(new Rep(data, size)) {}
+	BaselineOctets(const BaselineOctets &rhs) : m_rep(rhs.m_rep) { __sync_add_and_fetch(&m_rep->refno, 1); }
+	~BaselineOctets() { Release(); }
+	BaselineOctets& operator = (const BaselineOctets &rhs)
+	{
+		if (m_rep != rhs.m_rep) {
+			__sync_add_and_fetch(&rhs.m_rep->refno, 1);
+			Release();
+			m_rep = rhs.m_rep;
+		}
+		return *this;
+	}
+	size_t GetSize() const { return m_rep->size; }
+
+private:
+	struct Rep
+	{
+		Rep(const void *p, size_t n) : data(malloc(n)), size(n), refno(0) { memcpy(data, p, n); }
+		~Rep() { free(data); }
+		void *data;
+		size_t size;
+		int refno;
+	};
+
+	void Release()
+	{
+		if (__sync_sub_and_fetch(&m_rep->refno, 1) < 0) {
+			delete m_rep;
+		}
+	}
+
+	Rep *m_rep;
+};
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void Report(const char *name, double seconds, int iterations)
+{
+	printf("%-28s %10.1f ns\n", name, seconds * 1e9 / iterations);
+}
+
+template <typename T>
+static size_t Run(const char *name, const char *data, size_t size, int iterations)
+{
+	size_t checksum = 0;
+	T other(data, 1);
+	double t = Now();
+	for (int i = 0; i < iterations; ++i) {
+		T a(data, size);
+		T b(a);
+		T c(other);
+		c = b;
+		checksum += c.GetSize();
+	}
+	Report(name, Now() - t, iterations);
+	return checksum;
+}
+
+int main(int argc, char *argv[])
+{
+	int iterations = argc > 1 ? atoi(argv[1]) : 2000000;
+	char data[64];
+	memset(data, 'x', sizeof(data));
+	size_t checksum = 0;
+
+	checksum += Run<BaselineOctets>("baseline 4 bytes", data, 4, iterations);
+	checksum += Run<Octets>("Octets 4 bytes", data, 4, iterations);
+	checksum += Run<BaselineOctets>("baseline 64 bytes", data, 64, iterations);
+	checksum += Run<Octets>("Octets 64 bytes", data, 64, iterations);
+
+	if (checksum == 0) {
+		printf("checksum 0\n");
+	}
+	return 0;
+}
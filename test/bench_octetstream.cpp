@@ -0,0 +1,77 @@
+// Benchmark of OctetStream insertion
+//
+// Usage: bench_octetstream [total megabytes per case]
+//
+// Messages of several sizes are built from 64-byte writes under each growth policy.
+// GROWTH_PAGED is the former behavior, which grew the buffer by PAGE_SIZE steps;
+// "exact + hint" reserves the whole message with ReserveForWrite() first.
+#include <zbase/octetstream.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+using namespace zbase;
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static void Report(const char *name, double seconds, size_t bytes)
+{
+	printf("%-28s %10.1f MB/s\n", name, bytes / seconds / 1e6);
+}
+
+static size_t BuildMessages(OctetStream::GrowthPolicy policy, bool reserve, size_t message_size, int rounds)
+{
+	char chunk[64];
+	memset(chunk, 'x', sizeof(chunk));
+	size_t checksum = 0;
+	for (int r = 0; r < rounds; ++r) {
+		OctetStream os;
+		os.SetGrowthPolicy(policy);
+		if (reserve) {
+			os.ReserveForWrite(message_size);
+		}
+		for (size_t n = 0; n < message_size; n += sizeof(chunk)) {
+			os.Write(chunk, sizeof(chunk));
+		}
+		checksum += os.GetSize();
+	}
+	return checksum;
+}
+
+int main(int argc, char *argv[])
+{
+	size_t total = (argc > 1 ? atoi(argv[1]) : 256) * 1024 * 1024;
+	size_t message_sizes[] = { 1024, 1024 * 1024, 16 * 1024 * 1024, 64 * 1024 * 1024 };
+	size_t checksum = 0;
+
+	for (size_t m = 0; m < sizeof(message_sizes) / sizeof(message_sizes[0]); ++m) {
+		size_t message_size = message_sizes[m];
+		int rounds = static_cast<int>(total / message_size);
+		if (rounds < 1) {
+			rounds = 1;
+		}
+		size_t bytes = message_size * rounds;
+		printf("%u KB messages, %d rounds\n", static_cast<unsigned int>(message_size / 1024), rounds);
+
+		double t = Now();
+		checksum += BuildMessages(OctetStream::GROWTH_PAGED, false, message_size, rounds);
+		Report("  paged", Now() - t, bytes);
+
+		t = Now();
+		checksum += BuildMessages(OctetStream::GROWTH_GEOMETRIC, false, message_size, rounds);
+		Report("  geometric", Now() - t, bytes);
+
+		t = Now();
+		checksum += BuildMessages(OctetStream::GROWTH_EXACT, true, message_size, rounds);
+		Report("  exact + hint", Now() - t, bytes);
+	}
+	if (checksum == 0) {
+		printf("checksum 0\n");
+	}
+	return 0;
+}
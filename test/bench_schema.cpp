@@ -0,0 +1,119 @@
+// Benchmark of schema serialization against hand-written virtual ISerialize code
+//
+// Usage: bench_schema [messages]
+//
+// Both encode and decode the same market data message, which has a run of fixed-size
+// fields followed by a string, into a reused stream.
+#include <zbase/schema.h>
+#include <sys/time.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+using namespace zbase;
+
+struct Quote
+{
+	uint64_t id;
+	uint32_t instrument;
+	int64_t bid;
+	int64_t ask;
+	uint32_t bid_size;
+	uint32_t ask_size;
+	double last;
+	uint16_t flags;
+	bool is_final;
+	std::string venue;
+};
+ZBASE_SCHEMA(Quote, id, instrument, bid, ask, bid_size, ask_size, last, flags, is_final, venue)
+
+class LegacyQuote : public ISerialize
+{
+public:
+	virtual ~LegacyQuote() {}
+	virtual OctetStream* Serialize(OctetStream *stream) const
+	{
+		*stream << q.id << q.instrument << q.bid << q.ask << q.bid_size << q.ask_size << q.last << q.flags << q.is_final << q.venue;
+		return stream;
+	}
+	virtual OctetStream* Deserialize(OctetStream *stream)
+	{
+		*stream >> q.id >> q.instrument >> q.bid >> q.ask >> q.bid_size >> q.ask_size >> q.last >> q.flags >> q.is_final >> q.venue;
+		return stream;
+	}
+
+	Quote q;
+};
+
+static double Now()
+{
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// keep the compiler from seeing the dynamic type, as with messages from a registry
+static ISerialize* __attribute__((noinline)) NewLegacyQuote(const Quote &q)
+{
+	LegacyQuote *legacy = new LegacyQuote;
+	legacy->q = q;
+	return legacy;
+}
+
+static void Report(const char *name, double ms, int messages, size_t bytes)
+{
+	printf("%-16s %8.1f ms %8.1f ns/message %8.0f MB/s\n", name, ms, ms * 1e6 / messages, bytes / ms / 1000.0);
+}
+
+int main(int argc, char *argv[])
+{
+	int messages = argc > 1 ? atoi(argv[1]) : 10000000;
+	Quote quote = { 1234567890123ULL, 42, 1010000, 1010500, 300, 200, 101.02, 0x11, true, "XNAS" };
+	ISerialize *legacy = NewLegacyQuote(quote);
+	ISerialize *legacy_out = NewLegacyQuote(Quote());
+	Quote decoded;
+	OctetStream os;
+	size_t checksum = 0;
+
+	// batches of 1000 messages per stream fill, as a sender would
+	double begin = Now();
+	for (int i = 0; i < messages; i += 1000) {
+		os.Clear();
+		for (int j = 0; j < 1000; ++j) {
+			os << *legacy;
+		}
+		checksum += os.GetSize();
+	}
+	Report("virtual encode", Now() - begin, messages, checksum);
+	begin = Now();
+	for (int i = 0; i < messages; i += 1000) {
+		OctetStream in(os.GetData(), os.GetSize(), true);
+		for (int j = 0; j < 1000; ++j) {
+			in >> *legacy_out;
+		}
+	}
+	Report("virtual decode", Now() - begin, messages, checksum);
+
+	checksum = 0;
+	begin = Now();
+	for (int i = 0; i < messages; i += 1000) {
+		os.Clear();
+		for (int j = 0; j < 1000; ++j) {
+			os << quote;
+		}
+		checksum += os.GetSize();
+	}
+	Report("schema encode", Now() - begin, messages, checksum);
+	begin = Now();
+	for (int i = 0; i < messages; i += 1000) {
+		OctetStream in(os.GetData(), os.GetSize(), true);
+		for (int j = 0; j < 1000; ++j) {
+			in >> decoded;
+		}
+	}
+	Report("schema decode", Now() - begin, messages, checksum);
+	printf("checksum %u %u\n", (unsigned int)checksum, (unsigned int)(decoded.id + decoded.venue.size()));
+	// ISerialize has no virtual destructor
+	delete static_cast<LegacyQuote*>(legacy);
+	delete static_cast<LegacyQuote*>(legacy_out);
+	return 0;
+}
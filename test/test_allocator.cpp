@@ -0,0 +1,152 @@
+#include <gtest/gtest.h>
+#include <zbase/allocator.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+#include <pthread.h>
+#include <string>
+using namespace zbase;
+
+TEST(AllocatorTest, CurrentAllocator) {
+	ArenaAllocator arena;
+	EXPECT_TRUE(Allocator::GetCurrent() == Allocator::GetDefault());
+	{
+		ScopedAllocator scope(&arena);
+		EXPECT_TRUE(Allocator::GetCurrent() == &arena);
+		{
+			ScopedAllocator inner(PoolAllocator::Instance());
+			EXPECT_TRUE(Allocator::GetCurrent() == PoolAllocator::Instance());
+		}
+		EXPECT_TRUE(Allocator::GetCurrent() == &arena);
+	}
+	EXPECT_TRUE(Allocator::GetCurrent() == Allocator::GetDefault());
+}
+
+TEST(AllocatorTest, ArenaAllocator) {
+	ArenaAllocator arena(1024);
+	arena.EnableStats(true);
+	char *p1 = static_cast<char*>(arena.Allocate(10));
+	char *p2 = static_cast<char*>(arena.Allocate(100));
+	EXPECT_TRUE(p2 >= p1 + 10);
+	EXPECT_TRUE(reinterpret_cast<size_t>(p2) % 16 == 0);
+	// the latest block grows in place
+	memset(p2, 'x', 100);
+	EXPECT_TRUE(arena.Reallocate(p2, 100, 200) == p2);
+	EXPECT_TRUE(p2[99] == 'x');
+	arena.Deallocate(p2, 200);
+	EXPECT_TRUE(arena.Allocate(50) == p2);
+	// large blocks
+	void *p3 = arena.Allocate(4096);
+	EXPECT_TRUE(p3 != NULL);
+	AllocatorStats stats = arena.GetStats();
+	EXPECT_TRUE(stats.allocations == 4);
+	EXPECT_TRUE(stats.reallocations == 1);
+	EXPECT_TRUE(stats.deallocations == 1);
+	EXPECT_TRUE(stats.bytes_in_use == 10 + 50 + 4096);
+	EXPECT_TRUE(stats.system_allocations == 2);
+	EXPECT_TRUE(arena.GetReservedSize() == 1024 + 4096);
+	arena.Reset();
+	EXPECT_TRUE(arena.GetReservedSize() == 1024);
+	EXPECT_TRUE(arena.Allocate(10) == p1);
+}
+
+TEST(AllocatorTest, PoolAllocator) {
+	PoolAllocator *pool = PoolAllocator::Instance();
+	pool->Trim();
+	pool->ResetStats();
+	pool->EnableStats(true);
+	void *p1 = pool->Allocate(40);
+	pool->Deallocate(p1, 40);
+	// blocks are reused within a size class
+	void *p2 = pool->Allocate(64);
+	EXPECT_TRUE(p2 == p1);
+	EXPECT_TRUE(pool->Reallocate(p2, 64, 50) == p2);
+	void *p3 = pool->Reallocate(p2, 50, 1000);
+	EXPECT_TRUE(p3 != NULL);
+	void *p4 = pool->Allocate(PoolAllocator::MAX_BLOCK_SIZE + 1);
+	pool->Deallocate(p4, PoolAllocator::MAX_BLOCK_SIZE + 1);
+	pool->Deallocate(p3, 1000);
+	AllocatorStats stats = pool->GetStats();
+	EXPECT_TRUE(stats.allocations == 4);
+	EXPECT_TRUE(stats.deallocations == 4);
+	EXPECT_TRUE(stats.bytes_in_use == 0);
+	EXPECT_TRUE(stats.system_allocations == 3);
+	pool->EnableStats(false);
+	pool->Trim();
+}
+
+TEST(AllocatorTest, OctetsAllocator) {
+	ArenaAllocator arena;
+	arena.EnableStats(true);
+	std::string str(100, 'a');
+	Octets o1;
+	{
+		ScopedAllocator scope(&arena);
+		Octets o2(str);
+		o2.Append("bcd", 3);
+		EXPECT_TRUE(arena.GetStats().allocations >= 1);
+		// small objects do not allocate
+		Octets o3("small");
+		// copies outside the scope keep using the arena
+		o1 = o2;
+	}
+	EXPECT_TRUE(arena.GetStats().bytes_in_use > 0);
+	o1.Append("efg", 3);
+	EXPECT_TRUE(o1 == Octets(str + "bcdefg"));
+	o1.Clear();
+	o1 = Octets();
+	EXPECT_TRUE(arena.GetStats().bytes_in_use == 0);
+}
+
+TEST(AllocatorTest, OctetStreamAllocator) {
+	ArenaAllocator arena;
+	arena.EnableStats(true);
+	OctetStream os1;
+	EXPECT_TRUE(os1.GetAllocator() == NULL);
+	{
+		ScopedAllocator scope(&arena);
+		os1 << std::string(1000, 'x');
+		EXPECT_TRUE(os1.GetAllocator() == &arena);
+	}
+	os1 << std::string(5000, 'y');
+	EXPECT_TRUE(os1.GetAllocator() == &arena);
+	// the taken buffer is returned to the arena
+	Octets o1 = os1.TakeOctets();
+	EXPECT_TRUE(o1.GetSize() == 6000 + 2 * sizeof(uint32_t));
+	EXPECT_TRUE(arena.GetStats().bytes_in_use > 0);
+	o1 = Octets();
+	EXPECT_TRUE(arena.GetStats().bytes_in_use == 0);
+	os1 << (int32_t)1;
+	EXPECT_TRUE(os1.GetAllocator() == Allocator::GetDefault());
+}
+
+static void* AllocateInThread(void *arg)
+{
+	ScopedAllocator scope(PoolAllocator::Instance());
+	Octets *o = static_cast<Octets*>(arg);
+	for (int i = 0; i < 1000; ++i) {
+		Octets tmp(std::string(100 + i % 100, 'p'));
+		tmp.Append("q", 1);
+		if (i == 999) {
+			*o = tmp;
+		}
+	}
+	return NULL;
+}
+
+TEST(AllocatorTest, PoolAllocatorThreads) {
+	const int NUM_THREADS = 4;
+	Octets results[NUM_THREADS];
+	pthread_t threads[NUM_THREADS];
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_create(&threads[i], NULL, AllocateInThread, &results[i]);
+	}
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	// blocks allocated in other threads are released in this one
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		EXPECT_TRUE(results[i] == Octets(std::string(199, 'p') + "q"));
+		results[i] = Octets();
+	}
+	PoolAllocator::Instance()->Trim();
+}
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 #include <zbase/byteorder.h>
 #include <zbase/inttypes.h>
+#include <vector>
+#include <cstring>
 using namespace zbase;
 
 uint16_t u16         =             0x1122;
@@ -88,3 +90,56 @@ TEST(ByteOrderTest, BigEndianToHost) {
 	}
 }
 
+
+TEST(ByteOrderTest, ByteSwap) {
+	EXPECT_EQ(byteorder::ByteSwap(u16), u16_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(i16), i16_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(u32), u32_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(i32), i32_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(u64), u64_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(i64), i64_reverse);
+	EXPECT_EQ(byteorder::ByteSwap(byteorder::ByteSwap(i64)), i64);
+#if defined(ZBASE_CPP11) && __cplusplus >= 201103L
+	static_assert(byteorder::ByteSwap(static_cast<uint32_t>(0x11223344)) == 0x44332211, "ByteSwap is constexpr");
+	static_assert(byteorder::BEToH(byteorder::HToBE(static_cast<uint16_t>(0x1122))) == 0x1122, "BEToH is constexpr");
+#endif
+}
+
+template <typename T>
+static void CheckSwapArray()
+{
+	// cover the vectorized body and the scalar tail
+	for (size_t n = 0; n < 70; ++n) {
+		std::vector<T> src(n + 1), dst(n + 1, 0), inplace;
+		for (size_t i = 0; i < src.size(); ++i) {
+			src[i] = static_cast<T>(static_cast<uint64_t>(i + 1) * 0x0102030405060708ULL);
+		}
+		inplace = src;
+		// unaligned source
+		byteorder::SwapArray(&dst[0], &src[1], n);
+		byteorder::SwapArray(&inplace[0], &inplace[0], n + 1);
+		for (size_t i = 0; i < n; ++i) {
+			EXPECT_EQ(dst[i], byteorder::ByteSwap(src[i + 1]));
+		}
+		for (size_t i = 0; i <= n; ++i) {
+			EXPECT_EQ(inplace[i], byteorder::ByteSwap(src[i]));
+		}
+		byteorder::BEToHArray(&dst[0], &dst[0], n);
+		byteorder::HToBEArray(&dst[0], &dst[0], n);
+		for (size_t i = 0; i < n; ++i) {
+			EXPECT_EQ(dst[i], byteorder::ByteSwap(src[i + 1]));
+		}
+	}
+}
+
+TEST(ByteOrderTest, SwapArray) {
+	CheckSwapArray<uint16_t>();
+	CheckSwapArray<int32_t>();
+	CheckSwapArray<uint64_t>();
+
+	double d1 = 1.5, d2 = 0, d3 = 0;
+	byteorder::SwapArray(&d2, &d1, 1);
+	byteorder::SwapArray(&d3, &d2, 1);
+	EXPECT_EQ(d1, d3);
+	EXPECT_NE(memcmp(&d1, &d2, sizeof(d1)), 0);
+}
@@ -0,0 +1,161 @@
+#include <gtest/gtest.h>
+#include <zbase/compressedstream.h>
+#include <zbase/byteorder.h>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <map>
+using namespace zbase;
+
+static std::map<uint32_t, std::string> MakeEntries(uint32_t count)
+{
+	std::map<uint32_t, std::string> entries;
+	for (uint32_t i = 0; i < count; ++i) {
+		char buf[64];
+		snprintf(buf, sizeof(buf), "SET key-%u value-%u", i % 100, i * 7);
+		entries[i] = buf;
+	}
+	return entries;
+}
+
+TEST(CompressedStreamTest, RoundTrip) {
+	std::map<uint32_t, std::string> entries = MakeEntries(10000);
+	OctetStream output;
+	CompressedWriter writer(&output, 4096);
+	writer << uint32_t(1) << entries;
+	writer.End();
+	writer << std::string("second");
+	writer.End();
+	// an empty message
+	writer.End();
+
+	OctetStream plain;
+	plain << uint32_t(1) << entries;
+	EXPECT_TRUE(writer.GetRawSize() == plain.GetSize() + 6 + sizeof(uint32_t));
+	EXPECT_TRUE(writer.GetCompressedSize() == output.GetSize());
+	EXPECT_TRUE(output.GetSize() < plain.GetSize() / 2);
+
+	CompressedReader reader;
+	reader.Feed(output.GetData(), output.GetSize());
+	OctetsView message;
+	ASSERT_TRUE(reader.NextMessage(message));
+	EXPECT_TRUE(message == OctetsView(plain.GetData(), plain.GetSize()));
+	std::string second;
+	ASSERT_TRUE(reader.Decode(second));
+	EXPECT_TRUE(second == "second");
+	ASSERT_TRUE(reader.NextMessage(message));
+	EXPECT_TRUE(message.GetSize() == 0);
+	EXPECT_FALSE(reader.NextMessage(message));
+	EXPECT_TRUE(reader.GetBufferedSize() == 0);
+}
+
+TEST(CompressedStreamTest, Blocks) {
+	OctetStream output;
+	std::string big(10000, 'x');
+	std::vector<char> noise(3000);
+	srand(1);
+	for (size_t i = 0; i < noise.size(); ++i) {
+		noise[i] = static_cast<char>(rand());
+	}
+	{
+		CompressedWriter writer(&output, 1024);
+		writer.Write("ab", 2);
+		// full blocks of large data go straight to the output
+		writer.Write(big.data(), big.size());
+		writer.Write(&noise[0], noise.size());
+		// the destructor ends the message
+	}
+	// walk the blocks: every one but the last is full, incompressible ones are stored
+	OctetStream blocks(output.GetData(), output.GetSize(), true);
+	size_t raw = 0;
+	size_t stored = 0;
+	uint32_t header = 0;
+	do {
+		header = blocks.PopInteger<uint32_t>();
+		uint32_t raw_size = blocks.PopInteger<uint32_t>();
+		if (!(header & CompressedBlock::FLAG_END)) {
+			EXPECT_TRUE(raw_size == 1024);
+		}
+		if (header & CompressedBlock::FLAG_STORED) {
+			EXPECT_TRUE((header & CompressedBlock::SIZE_MASK) == raw_size);
+			++stored;
+		}
+		blocks.Ignore(header & CompressedBlock::SIZE_MASK);
+		raw += raw_size;
+	} while (!(header & CompressedBlock::FLAG_END));
+	EXPECT_TRUE(blocks.IsEmpty());
+	EXPECT_TRUE(raw == 2 + big.size() + noise.size());
+	EXPECT_TRUE(stored >= 2);
+
+	// fed one byte at a time
+	CompressedReader reader;
+	OctetsView message;
+	const char *data = static_cast<const char*>(output.GetData());
+	for (size_t i = 0; i < output.GetSize(); ++i) {
+		EXPECT_FALSE(reader.NextMessage(message));
+		memcpy(reader.PrepareFeed(1), data + i, 1);
+		reader.CommitFeed(1);
+	}
+	ASSERT_TRUE(reader.NextMessage(message));
+	std::string expected = "ab" + big + std::string(noise.begin(), noise.end());
+	EXPECT_TRUE(message == OctetsView(expected.data(), expected.size()));
+}
+
+TEST(CompressedStreamTest, VarintEncoding) {
+	std::vector<uint64_t> values(1000, 300);
+	OctetStream output;
+	CompressedWriter writer(&output);
+	writer.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	writer << values;
+	writer.End();
+	EXPECT_TRUE(writer.GetRawSize() == 2 + 2 * values.size());
+
+	CompressedReader reader;
+	reader.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	reader.Feed(output.GetData(), output.GetSize());
+	std::vector<uint64_t> decoded;
+	ASSERT_TRUE(reader.Decode(decoded));
+	EXPECT_TRUE(decoded == values);
+}
+
+TEST(CompressedStreamTest, Errors) {
+	std::map<uint32_t, std::string> entries = MakeEntries(1000);
+	OctetStream output;
+	CompressedWriter writer(&output, 4096);
+	writer << entries;
+	writer.End();
+	std::string bytes = output.ToString();
+
+	// larger than the maximum message size
+	CompressedReader small(1000);
+	small.Feed(bytes.data(), bytes.size());
+	OctetsView message;
+	EXPECT_THROW(small.NextMessage(message), std::length_error);
+
+	// corrupt payload: a match offset before the start of the block
+	std::string corrupt = bytes;
+	ASSERT_FALSE(static_cast<uint8_t>(corrupt[3]) & 0x40);
+	corrupt[CompressedBlock::HEADER_SIZE] = '\x0F';
+	corrupt[CompressedBlock::HEADER_SIZE + 1] = '\xFF';
+	corrupt[CompressedBlock::HEADER_SIZE + 2] = '\xFF';
+	CompressedReader reader;
+	reader.Feed(corrupt.data(), corrupt.size());
+	EXPECT_THROW(reader.NextMessage(message), std::invalid_argument);
+	reader.Clear();
+
+	// headers claiming more payload than the block may hold are rejected before any payload arrives
+	uint32_t oversized[2] = { byteorder::HToLE(CompressedBlock::SIZE_MASK), byteorder::HToLE(static_cast<uint32_t>(4096)) };
+	reader.Feed(oversized, sizeof(oversized));
+	EXPECT_THROW(reader.NextMessage(message), std::invalid_argument);
+	reader.Clear();
+	uint32_t stored[2] = { byteorder::HToLE(CompressedBlock::FLAG_STORED | 100), byteorder::HToLE(static_cast<uint32_t>(99)) };
+	reader.Feed(stored, sizeof(stored));
+	EXPECT_THROW(reader.NextMessage(message), std::invalid_argument);
+	reader.Clear();
+
+	reader.Feed(bytes.data(), bytes.size());
+	std::map<uint32_t, std::string> decoded;
+	ASSERT_TRUE(reader.Decode(decoded));
+	EXPECT_TRUE(decoded == entries);
+}
@@ -0,0 +1,98 @@
+#include <gtest/gtest.h>
+#include <zbase/framedecoder.h>
+using namespace zbase;
+
+static OctetStream MakeFrames(int count)
+{
+	OctetStream frames;
+	for (int i = 0; i < count; ++i) {
+		OctetStream payload;
+		payload << (int32_t)i << std::string(i, 'x');
+		frames << payload;
+	}
+	return frames;
+}
+
+TEST(FrameDecoderTest, ChunkedFeed) {
+	OctetStream frames = MakeFrames(50);
+	const char *data = static_cast<const char*>(frames.GetData());
+	// feed in chunks of every size from 1 byte up
+	for (size_t chunk = 1; chunk < 40; chunk += 7) {
+		FrameDecoder decoder;
+		int next = 0;
+		for (size_t pos = 0; pos < frames.GetSize(); pos += chunk) {
+			decoder.Feed(data + pos, std::min(chunk, frames.GetSize() - pos));
+			OctetsView frame;
+			while (decoder.NextFrame(frame)) {
+				OctetStream payload(frame.GetData(), frame.GetSize(), true);
+				int32_t id = -1;
+				std::string str;
+				payload >> id >> str;
+				EXPECT_EQ(id, next);
+				EXPECT_EQ(str, std::string(next, 'x'));
+				++next;
+			}
+		}
+		EXPECT_EQ(next, 50);
+		EXPECT_EQ(decoder.GetBufferedSize(), 0U);
+	}
+}
+
+TEST(FrameDecoderTest, PartialFrame) {
+	OctetStream frames = MakeFrames(2);
+	FrameDecoder decoder;
+	OctetsView frame;
+	decoder.Feed(frames.GetData(), 3);
+	EXPECT_FALSE(decoder.NextFrame(frame));
+	EXPECT_EQ(decoder.GetBufferedSize(), 3U);
+	// receive the rest directly into the decoder
+	memcpy(decoder.PrepareFeed(frames.GetSize() - 3), static_cast<const char*>(frames.GetData()) + 3, frames.GetSize() - 3);
+	decoder.CommitFeed(frames.GetSize() - 3);
+	int32_t id = -1;
+	EXPECT_TRUE(decoder.Decode(id));
+	EXPECT_EQ(id, 0);
+	EXPECT_TRUE(decoder.Decode(id));
+	EXPECT_EQ(id, 1);
+	EXPECT_FALSE(decoder.Decode(id));
+}
+
+TEST(FrameDecoderTest, MaxFrameSize) {
+	OctetStream frames = MakeFrames(20);
+	FrameDecoder decoder(8);
+	decoder.Feed(frames.GetData(), frames.GetSize());
+	OctetsView frame;
+	int count = 0;
+	try {
+		while (decoder.NextFrame(frame)) {
+			++count;
+		}
+	} catch (std::length_error &e) {
+	}
+	// payload is 4 bytes id + 4 bytes length + i bytes
+	EXPECT_EQ(count, 1);
+	EXPECT_THROW(decoder.NextFrame(frame), std::length_error);
+	decoder.Clear();
+	EXPECT_EQ(decoder.GetBufferedSize(), 0U);
+}
+
+TEST(FrameDecoderTest, Transaction) {
+	OctetStream os;
+	os << (int32_t)1 << std::string("abc");
+	OctetStream partial(os.GetData(), os.GetSize() - 1);
+	int32_t v = 0;
+	std::string str;
+	{
+		OctetStream::Transaction transaction(partial);
+		EXPECT_THROW(partial >> v >> str, std::length_error);
+	}
+	EXPECT_EQ(partial.GetSize(), os.GetSize() - 1);
+	partial.Write("c", 1);
+	{
+		OctetStream::Transaction transaction(partial);
+		partial >> v >> str;
+		transaction.Commit();
+	}
+	EXPECT_EQ(v, 1);
+	EXPECT_EQ(str, "abc");
+	EXPECT_TRUE(partial.IsEmpty());
+}
@@ -0,0 +1,89 @@
+#include <gtest/gtest.h>
+#include <zbase/hash.h>
+#include <zbase/octets.h>
+#include <set>
+#include <string>
+#include <vector>
+#ifdef ZBASE_HAS_STD_HASH
+#	include <unordered_map>
+#	include <unordered_set>
+#endif
+using namespace zbase;
+
+TEST(HashTest, Hash64) {
+	std::vector<unsigned char> data(300);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<unsigned char>(i * 31 + 7);
+	}
+	// deterministic, seeded and sensitive to every length and every byte
+	std::set<uint64_t> hashes;
+	for (size_t n = 0; n <= data.size(); ++n) {
+		uint64_t h = hash::Hash64(&data[0], n);
+		EXPECT_EQ(h, hash::Hash64(&data[0], n));
+		EXPECT_NE(h, hash::Hash64(&data[0], n, 1));
+		hashes.insert(h);
+	}
+	EXPECT_EQ(data.size() + 1, hashes.size());
+	for (size_t n = 1; n <= 100; n += 11) {
+		uint64_t h = hash::Hash64(&data[0], n);
+		for (size_t i = 0; i < n; ++i) {
+			for (int bit = 0; bit < 8; ++bit) {
+				data[i] ^= (1 << bit);
+				EXPECT_NE(h, hash::Hash64(&data[0], n));
+				data[i] ^= (1 << bit);
+			}
+		}
+	}
+	// the result does not depend on the alignment of the input
+	std::vector<unsigned char> copy(data.begin(), data.end());
+	copy.insert(copy.begin(), 0);
+	EXPECT_EQ(hash::Hash64(&data[0], 100), hash::Hash64(&copy[1], 100));
+}
+
+TEST(HashTest, Distribution) {
+	// sequential keys spread evenly over the buckets
+	const size_t NUM_BUCKETS = 64;
+	const size_t NUM_KEYS = 64000;
+	std::vector<size_t> buckets(NUM_BUCKETS);
+	for (uint32_t i = 0; i < NUM_KEYS; ++i) {
+		++buckets[hash::Hash64(&i, sizeof(i)) % NUM_BUCKETS];
+	}
+	for (size_t i = 0; i < NUM_BUCKETS; ++i) {
+		EXPECT_GT(buckets[i], NUM_KEYS / NUM_BUCKETS * 8 / 10);
+		EXPECT_LT(buckets[i], NUM_KEYS / NUM_BUCKETS * 12 / 10);
+	}
+}
+
+TEST(HashTest, OctetsHash) {
+	std::string str(100, 'h');
+	Octets o1(str);
+	Octets o2(o1);
+	size_t h = o1.Hash();
+	EXPECT_EQ(h, o2.Hash());
+	EXPECT_EQ(h, Octets(str).Hash());
+	EXPECT_EQ(h, OctetsView(str.data(), str.size()).Hash());
+	EXPECT_EQ(Octets("small").Hash(), Octets(str + "small").Slice(100).Hash());
+	EXPECT_EQ(Octets().Hash(), OctetsView().Hash());
+	// the cached hash follows modifications
+	o1.Append("x", 1);
+	EXPECT_NE(h, o1.Hash());
+	EXPECT_EQ(h, o2.Hash());
+	o2.Append("x", 1);
+	EXPECT_EQ(o1.Hash(), o2.Hash());
+	o2.Assign(str.data(), str.size());
+	EXPECT_EQ(h, o2.Hash());
+}
+
+#ifdef ZBASE_HAS_STD_HASH
+TEST(HashTest, UnorderedContainers) {
+	std::unordered_map<Octets, int> map;
+	for (int i = 0; i < 1000; ++i) {
+		map[Octets(std::string(i % 50, 'k') + std::to_string(i))] = i;
+	}
+	EXPECT_EQ(1000u, map.size());
+	EXPECT_EQ(123, map[Octets(std::string(23, 'k') + "123")]);
+	std::unordered_set<OctetsView> views;
+	views.insert(OctetsView("abc", 3));
+	EXPECT_TRUE(views.count(OctetsView("abc", 3)) == 1);
+}
+#endif
@@ -0,0 +1,123 @@
+#include <gtest/gtest.h>
+#include <zbase/hex.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+#include <cctype>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+static std::string NaiveHex(const unsigned char *data, size_t n)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	std::string s;
+	for (size_t i = 0; i < n; ++i) {
+		s += digits[data[i] >> 4];
+		s += digits[data[i] & 0x0F];
+	}
+	return s;
+}
+
+TEST(HexTest, Encode) {
+	std::vector<unsigned char> data(300);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<unsigned char>(i * 7 + 3);
+	}
+	// all lengths around the vector widths
+	for (size_t n = 0; n <= 100; ++n) {
+		std::string s(2 * n, '?');
+		if (n > 0) {
+			hex::Encode(&s[0], &data[0], n);
+		}
+		EXPECT_EQ(NaiveHex(&data[0], n), s);
+	}
+	EXPECT_TRUE(hex::Format(&data[0], 0) == "");
+}
+
+TEST(HexTest, Format) {
+	const unsigned char data[] = { 0x01, 0xAB, 0xFF, 0x00, 0x7F };
+	EXPECT_EQ("01 AB FF 00 7F", hex::Format(data, 5));
+	EXPECT_EQ("01AB\nFF00\n7F", hex::Format(data, 5, "", 2));
+	EXPECT_EQ("01:AB:FF\n00:7F", hex::Format(data, 5, ":", 3));
+	EXPECT_EQ("01, AB, FF, 00, 7F", hex::Format(data, 5, ", "));
+	EXPECT_EQ("01 AB FF 00 7F", hex::Format(data, 5, " ", 5));
+	EXPECT_EQ("01\nAB\nFF\n00\n7F", hex::Format(data, 5, " ", 1));
+	for (size_t n = 1; n <= 5; ++n) {
+		EXPECT_EQ(hex::Format(data, n, ", ", 2).size(), hex::GetFormattedSize(n, 2, 2));
+	}
+}
+
+TEST(HexTest, FormatLengths) {
+	std::vector<unsigned char> data(200);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<unsigned char>(i * 11 + 1);
+	}
+	const size_t widths[] = { 0, 1, 15, 16, 17, 32, 48 };
+	for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); ++w) {
+		for (size_t n = 1; n <= data.size(); ++n) {
+			std::string expected;
+			for (size_t i = 0; i < n; ++i) {
+				if (i > 0) {
+					expected += (widths[w] > 0 && i % widths[w] == 0) ? "\n" : " ";
+				}
+				expected += NaiveHex(&data[i], 1);
+			}
+			EXPECT_EQ(expected, hex::Format(&data[0], n, " ", widths[w]));
+		}
+	}
+}
+
+TEST(HexTest, Decode) {
+	std::vector<unsigned char> data(200);
+	for (size_t i = 0; i < data.size(); ++i) {
+		data[i] = static_cast<unsigned char>(i * 13 + 5);
+	}
+	unsigned char out[200];
+	for (size_t n = 0; n <= data.size(); n += 7) {
+		std::string s = NaiveHex(&data[0], n);
+		EXPECT_EQ(n, hex::Decode(out, s.data(), s.size()));
+		EXPECT_TRUE(0 == n || memcmp(out, &data[0], n) == 0);
+		// lower case
+		for (size_t i = 0; i < s.size(); ++i) {
+			s[i] = tolower(s[i]);
+		}
+		EXPECT_EQ(n, hex::Decode(out, s.data(), s.size()));
+		EXPECT_TRUE(0 == n || memcmp(out, &data[0], n) == 0);
+		// dumps
+		s = hex::Format(&data[0], n, " ", 16);
+		EXPECT_EQ(n, hex::Decode(out, s.data(), s.size()));
+		EXPECT_TRUE(0 == n || memcmp(out, &data[0], n) == 0);
+	}
+	EXPECT_EQ(hex::npos, hex::Decode(out, "0", 1));
+	EXPECT_EQ(hex::npos, hex::Decode(out, "0 1", 3));
+	EXPECT_EQ(hex::npos, hex::Decode(out, "0g", 2));
+	std::string bad = NaiveHex(&data[0], 40);
+	bad[50] = 'x';
+	EXPECT_EQ(hex::npos, hex::Decode(out, bad.data(), bad.size()));
+	bad[50] = '@';
+	EXPECT_EQ(hex::npos, hex::Decode(out, bad.data(), bad.size()));
+	bad[50] = 'G';
+	EXPECT_EQ(hex::npos, hex::Decode(out, bad.data(), bad.size()));
+}
+
+TEST(HexTest, OctetsHex) {
+	std::string str(100, 'Z');
+	Octets o1(str);
+	EXPECT_TRUE(Octets::FromHex(o1.Hex()) == o1);
+	EXPECT_TRUE(Octets::FromHex(o1.Hex("", 16)) == o1);
+	EXPECT_TRUE(Octets::FromHex("01 ab-CD:ef") == Octets("\x01\xAB\xCD\xEF", 4));
+	EXPECT_TRUE(Octets::FromHex("").IsEmpty());
+	// short data with long separators is kept in the small buffer
+	Octets o2 = Octets::FromHex(Octets("0123456789").Hex("    "));
+	EXPECT_TRUE(o2 == Octets("0123456789"));
+	EXPECT_TRUE(o2.IsSmall());
+	EXPECT_THROW(Octets::FromHex("ABC"), std::invalid_argument);
+	EXPECT_THROW(Octets::FromHex(std::string(60, 'k')), std::invalid_argument);
+	EXPECT_TRUE(o1.Slice(0, 2).Hex(":") == "5A:5A");
+
+	OctetStream os;
+	os << (uint8_t)0x12 << (uint8_t)0x34 << (uint8_t)0x56;
+	EXPECT_TRUE(os.Hex() == "12 34 56");
+	EXPECT_TRUE(os.Hex("", 2) == "1234\n56");
+}
@@ -0,0 +1,221 @@
+#include <gtest/gtest.h>
+#include <zbase/lazycontainer.h>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+using namespace zbase;
+
+static std::string MakeName(uint32_t i)
+{
+	char buf[32];
+	snprintf(buf, sizeof(buf), "name-%u", i);
+	return buf;
+}
+
+static std::map<uint32_t, std::vector<std::string> > MakeMap(uint32_t count)
+{
+	std::map<uint32_t, std::vector<std::string> > data;
+	for (uint32_t i = 0; i < count; ++i) {
+		// empty containers write nothing, so nested ones would not round-trip
+		std::vector<std::string> &names = data[i * 3];
+		for (uint32_t j = 0; j <= i % 4; ++j) {
+			names.push_back(MakeName(i + j));
+		}
+	}
+	return data;
+}
+
+TEST(LazyContainerTest, Sequence) {
+	std::vector<std::string> names;
+	for (uint32_t i = 0; i < 100; ++i) {
+		names.push_back(MakeName(i));
+	}
+	std::list<int32_t> numbers;
+	numbers.push_back(-1);
+	numbers.push_back(7);
+	OctetStream os;
+	os << names << numbers << uint32_t(0xCAFE);
+
+	LazyContainer<std::string> lazy_names;
+	LazyContainer<int32_t> lazy_numbers;
+	os >> lazy_names >> lazy_numbers;
+	EXPECT_TRUE(os.PopInteger<uint32_t>() == 0xCAFE);
+	EXPECT_TRUE(os.IsEmpty());
+
+	EXPECT_TRUE(lazy_names.GetCount() == names.size());
+	size_t i = 0;
+	for (LazyContainer<std::string>::const_iterator it = lazy_names.begin(); it != lazy_names.end(); ++it, ++i) {
+		EXPECT_TRUE(*it == names[i]);
+		EXPECT_TRUE(it->size() == names[i].size());
+	}
+	EXPECT_TRUE(i == names.size());
+	EXPECT_TRUE(lazy_names.At(57) == names[57]);
+	EXPECT_TRUE(lazy_names.At(0) == names[0]);
+	EXPECT_THROW(lazy_names.At(100), std::out_of_range);
+
+	std::list<int32_t> copy;
+	lazy_numbers.CopyTo(copy);
+	EXPECT_TRUE(copy == numbers);
+	EXPECT_TRUE(lazy_numbers.At(1) == 7);
+
+	// skipping an element without dereferencing the iterator
+	LazyContainer<std::string>::const_iterator it = lazy_names.begin();
+	it++;
+	++it;
+	EXPECT_TRUE(*it == names[2]);
+}
+
+TEST(LazyContainerTest, FixedSize) {
+	std::vector<uint32_t> values;
+	for (uint32_t i = 0; i < 1000; ++i) {
+		values.push_back(i * i);
+	}
+	OctetStream os;
+	os << values;
+	LazyContainer<uint32_t> lazy;
+	os >> lazy;
+	EXPECT_TRUE(lazy.GetCount() == values.size());
+	EXPECT_TRUE(lazy.GetBytes().GetSize() == values.size() * sizeof(uint32_t));
+	EXPECT_TRUE(lazy.At(999) == values[999]);
+	std::vector<uint32_t> copy;
+	lazy.CopyTo(copy);
+	EXPECT_TRUE(copy == values);
+
+	// varint elements have no fixed size
+	OctetStream vs;
+	vs.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	vs << values;
+	vs >> lazy;
+	EXPECT_TRUE(vs.IsEmpty());
+	EXPECT_TRUE(lazy.GetCount() == values.size());
+	EXPECT_TRUE(lazy.At(999) == values[999]);
+	EXPECT_TRUE(lazy.At(3) == values[3]);
+
+#ifdef ZBASE_HAS_STD_ARRAY
+	// char arrays stay raw bytes under varint encoding
+	std::vector<std::array<char, 4> > names(10);
+	for (size_t i = 0; i < names.size(); ++i) {
+		names[i][0] = static_cast<char>('a' + i);
+	}
+	vs << names;
+	LazyContainer<std::array<char, 4> > lazy_names;
+	vs >> lazy_names;
+	EXPECT_TRUE(vs.IsEmpty());
+	EXPECT_TRUE(lazy_names.GetCount() == names.size());
+	EXPECT_TRUE(lazy_names.GetBytes().GetSize() == names.size() * 4);
+	EXPECT_TRUE(lazy_names.At(7) == names[7]);
+#endif
+}
+
+TEST(LazyContainerTest, Map) {
+	std::map<uint32_t, std::vector<std::string> > data = MakeMap(1000);
+	OctetStream os;
+	os << data << std::string("tail");
+
+	LazyMap<uint32_t, std::vector<std::string> > lazy;
+	os >> lazy;
+	std::string tail;
+	os >> tail;
+	EXPECT_TRUE(tail == "tail");
+	EXPECT_TRUE(lazy.GetCount() == data.size());
+
+	std::vector<std::string> names;
+	EXPECT_TRUE(lazy.Find(3 * 7, names));
+	EXPECT_TRUE(names == data[3 * 7]);
+	EXPECT_TRUE(lazy.Find(0, names));
+	EXPECT_TRUE(names == data[0]);
+	EXPECT_TRUE(lazy.Find(3 * 999, names));
+	EXPECT_TRUE(names == data[3 * 999]);
+	EXPECT_FALSE(lazy.Find(3 * 7 + 1, names));
+	EXPECT_FALSE(lazy.Find(3 * 1000, names));
+	EXPECT_TRUE(lazy.Contains(3 * 500));
+	EXPECT_FALSE(lazy.Contains(1));
+
+	std::map<uint32_t, std::vector<std::string> > copy;
+	lazy.CopyTo(copy);
+	EXPECT_TRUE(copy == data);
+
+	std::multimap<std::string, int32_t> multi;
+	multi.insert(std::make_pair(std::string("b"), 2));
+	multi.insert(std::make_pair(std::string("a"), 1));
+	multi.insert(std::make_pair(std::string("b"), 3));
+	OctetStream ms;
+	ms << multi;
+	LazyMap<std::string, int32_t> lazy_multi;
+	ms >> lazy_multi;
+	int32_t value = 0;
+	EXPECT_TRUE(lazy_multi.Find("b", value));
+	EXPECT_TRUE(value == 2);
+	EXPECT_FALSE(lazy_multi.Find("c", value));
+}
+
+TEST(LazyContainerTest, Nested) {
+	std::map<uint32_t, std::vector<std::string> > data = MakeMap(100);
+	OctetStream os;
+	os << data;
+	// values are views into the same buffer
+	LazyMap<uint32_t, LazyContainer<std::string> > lazy;
+	os >> lazy;
+	LazyContainer<std::string> names;
+	EXPECT_TRUE(lazy.Find(3 * 11, names));
+	EXPECT_TRUE(names.GetCount() == data[3 * 11].size());
+	EXPECT_TRUE(names.At(2) == data[3 * 11][2]);
+}
+
+TEST(LazyContainerTest, Serialize) {
+	std::map<uint32_t, std::vector<std::string> > data = MakeMap(50);
+	OctetStream os;
+	os << data;
+	std::string bytes = os.ToString();
+	LazyMap<uint32_t, std::vector<std::string> > lazy;
+	os >> lazy;
+
+	// written back as read
+	OctetStream out;
+	out << lazy;
+	EXPECT_TRUE(out.ToString() == bytes);
+	EXPECT_TRUE(lazy.GetPackSize() == bytes.size());
+
+	// re-encoded for a stream with another integer encoding
+	OctetStream vs;
+	vs.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	vs << lazy;
+	std::map<uint32_t, std::vector<std::string> > copy;
+	vs >> copy;
+	EXPECT_TRUE(copy == data);
+
+	// nothing is written for an empty view
+	LazyContainer<std::string> empty;
+	OctetStream es;
+	es >> empty;
+	EXPECT_TRUE(empty.IsEmpty());
+	es << empty;
+	EXPECT_TRUE(es.IsEmpty());
+	EXPECT_TRUE(empty.begin() == empty.end());
+}
+
+TEST(LazyContainerTest, Truncated) {
+	std::vector<std::string> names;
+	names.push_back("alpha");
+	names.push_back("beta");
+	OctetStream full;
+	full << names;
+	std::string bytes = full.ToString();
+
+	// the count says 2 but only the first element is there
+	OctetStream os(bytes.data(), bytes.size() - 8);
+	LazyContainer<std::string> lazy;
+	EXPECT_THROW(os >> lazy, std::length_error);
+	EXPECT_TRUE(os.GetSize() == bytes.size() - 8);
+	EXPECT_TRUE(lazy.IsEmpty());
+
+	std::vector<uint32_t> values(4, 1);
+	OctetStream fs;
+	fs << values;
+	OctetStream short_stream(fs.GetData(), fs.GetSize() - 1);
+	LazyContainer<uint32_t> lazy_values;
+	EXPECT_THROW(short_stream >> lazy_values, std::length_error);
+	EXPECT_TRUE(short_stream.GetSize() == fs.GetSize() - 1);
+}
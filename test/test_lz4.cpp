@@ -0,0 +1,99 @@
+#include <gtest/gtest.h>
+#include <zbase/lz4.h>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+static std::string MakeText(size_t n, unsigned int seed)
+{
+	static const char *words[] = {"replica ", "set ", "key=", "value ", "42 ", "\n"};
+	std::string s;
+	srand(seed);
+	while (s.size() < n) {
+		s += words[rand() % 6];
+	}
+	s.resize(n);
+	return s;
+}
+
+static void ExpectRoundTrip(const std::string &data)
+{
+	std::vector<char> compressed(lz4::GetMaxCompressedSize(data.size()));
+	size_t size = lz4::Compress(&compressed[0], compressed.size(), data.data(), data.size());
+	ASSERT_TRUE(size > 0);
+	std::string decompressed(data.size() + 1, '\0');
+	EXPECT_TRUE(lz4::Decompress(&decompressed[0], data.size(), &compressed[0], size) == data.size());
+	EXPECT_TRUE(memcmp(decompressed.data(), data.data(), data.size()) == 0);
+	// the exact compressed size fits, one byte less does not
+	EXPECT_TRUE(lz4::Compress(&compressed[0], size, data.data(), data.size()) == size);
+	EXPECT_TRUE(lz4::Compress(&compressed[0], size - 1, data.data(), data.size()) == 0);
+	if (!data.empty()) {
+		EXPECT_TRUE(lz4::Decompress(&decompressed[0], data.size() - 1, &compressed[0], size) == lz4::npos);
+	}
+}
+
+TEST(Lz4Test, RoundTrip) {
+	// all lengths around the match limits
+	for (size_t n = 0; n <= 40; ++n) {
+		ExpectRoundTrip(MakeText(n, n));
+		ExpectRoundTrip(std::string(n, 'a'));
+	}
+	ExpectRoundTrip(MakeText(100000, 1));
+	ExpectRoundTrip(std::string(100000, '\0'));
+	std::string noise(70000, '\0');
+	srand(2);
+	for (size_t i = 0; i < noise.size(); ++i) {
+		noise[i] = static_cast<char>(rand());
+	}
+	ExpectRoundTrip(noise);
+	// long literal runs and matches need length extension bytes
+	ExpectRoundTrip(noise.substr(0, 1000) + std::string(1000, 'z') + noise.substr(0, 1000));
+}
+
+TEST(Lz4Test, Format) {
+	// a literal-only block is a token with the literal count and the literals
+	char out[16];
+	EXPECT_TRUE(lz4::Compress(out, sizeof(out), "abc", 3) == 4);
+	EXPECT_TRUE(memcmp(out, "\x30" "abc", 4) == 0);
+	EXPECT_TRUE(lz4::Compress(out, sizeof(out), "", 0) == 1);
+	EXPECT_TRUE(out[0] == 0);
+
+	// "abcd" then a match of 4 + 6 bytes at offset 4, then 5 literals
+	const char block[] = "\x46" "abcd" "\x04\x00" "\x50" "abcde";
+	char text[32];
+	EXPECT_TRUE(lz4::Decompress(text, sizeof(text), block, sizeof(block) - 1) == 19);
+	EXPECT_TRUE(std::string(text, 19) == "abcdabcdabcdab" "abcde");
+
+	std::string repeated = std::string(64, 'x') + "tail!";
+	std::vector<char> compressed(lz4::GetMaxCompressedSize(repeated.size()));
+	size_t size = lz4::Compress(&compressed[0], compressed.size(), repeated.data(), repeated.size());
+	EXPECT_TRUE(size < 16);
+}
+
+TEST(Lz4Test, Malformed) {
+	char out[64];
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "", 0) == lz4::npos);
+	// literals past the end of the input
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "\x40" "abc", 4) == lz4::npos);
+	// offset 0 and an offset before the start of the output
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "\x10" "a" "\x00\x00" "\x10" "a", 6) == lz4::npos);
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "\x10" "a" "\x02\x00" "\x10" "a", 6) == lz4::npos);
+	// truncated offset and length extension
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "\x10" "a" "\x01", 3) == lz4::npos);
+	EXPECT_TRUE(lz4::Decompress(out, sizeof(out), "\xF0\xFF", 2) == lz4::npos);
+
+	// no corruption of a valid block writes out of bounds
+	std::string data = MakeText(5000, 3);
+	std::vector<char> compressed(lz4::GetMaxCompressedSize(data.size()));
+	size_t size = lz4::Compress(&compressed[0], compressed.size(), data.data(), data.size());
+	std::vector<char> decompressed(data.size());
+	srand(4);
+	for (int i = 0; i < 2000; ++i) {
+		std::vector<char> corrupt(compressed.begin(), compressed.begin() + size);
+		corrupt[rand() % size] ^= static_cast<char>(1 << (rand() % 8));
+		size_t n = lz4::Decompress(&decompressed[0], decompressed.size(), &corrupt[0], corrupt.size());
+		EXPECT_TRUE(n == lz4::npos || n <= decompressed.size());
+	}
+}
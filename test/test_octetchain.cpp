@@ -0,0 +1,58 @@
+#include <gtest/gtest.h>
+#include <zbase/octetchain.h>
+using namespace zbase;
+
+TEST(OctetChainTest, SameLayoutAsOctetStream) {
+	Octets small("small");
+	Octets large(std::string(100, 'L'));
+	std::vector<int32_t> values(10, 7);
+	OctetChain chain(64);
+	chain << (int32_t)1 << small << large << std::string("mid") << large << values;
+	OctetStream expected;
+	expected << (int32_t)1 << small << large << std::string("mid") << large << values;
+	EXPECT_EQ(chain.GetSize(), expected.GetSize());
+	// header, large, "mid" and length, large, tail
+	EXPECT_EQ(chain.GetSegmentCount(), 5U);
+
+	OctetStream flat;
+	chain.CopyTo(&flat);
+	EXPECT_EQ(flat.GetSize(), expected.GetSize());
+	EXPECT_TRUE(memcmp(flat.GetData(), expected.GetData(), expected.GetSize()) == 0);
+
+	chain.Clear();
+	EXPECT_TRUE(chain.IsEmpty());
+	EXPECT_EQ(chain.GetSegmentCount(), 0U);
+}
+
+#ifndef ZBASE_WINDOWS
+TEST(OctetChainTest, Iovec) {
+	Octets large(std::string(5000, 'L'));
+	OctetChain chain;
+	chain << (uint16_t)1 << large;
+	struct iovec iov[4];
+	size_t count = chain.GetIovec(iov, 4);
+	EXPECT_EQ(count, 2U);
+	EXPECT_EQ(iov[0].iov_len, sizeof(uint16_t) + sizeof(uint32_t));
+	// the payload is referenced, not copied
+	EXPECT_EQ(iov[1].iov_base, large.GetData());
+	EXPECT_EQ(iov[1].iov_len, large.GetSize());
+	EXPECT_EQ(chain.GetIovec(iov, 1), 1U);
+}
+
+TEST(OctetChainTest, NoEmptySegments) {
+	Octets large(std::string(100, 'L'));
+	OctetChain chain(0);
+	chain << Octets() << large << large << Octets();
+	OctetStream expected;
+	expected << Octets() << large << large << Octets();
+	EXPECT_EQ(chain.GetSize(), expected.GetSize());
+	// both lengths, large, length, large, tail
+	EXPECT_EQ(chain.GetSegmentCount(), 5U);
+	struct iovec iov[8];
+	size_t count = chain.GetIovec(iov, 8);
+	EXPECT_EQ(count, 5U);
+	for (size_t i = 0; i < count; ++i) {
+		EXPECT_TRUE(iov[i].iov_len > 0);
+	}
+}
+#endif
@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <zbase/octets.h>
+#include <cstdio>
+#include <stdexcept>
+#include <unistd.h>
 using namespace zbase;
 
 TEST(OctetsTest, DefaultConstructor) {
@@ -72,3 +75,208 @@ TEST(OctetsTest, DataModifier) {
 	EXPECT_TRUE(o1 == o3);
 }
 
+
+TEST(OctetsTest, View) {
+	std::string str("test");
+	Octets o(str);
+	OctetsView v1(o);
+	OctetsView v2(str.c_str(), str.size());
+	OctetsView v3;
+	EXPECT_TRUE(v1.GetData() == o.GetData());
+	EXPECT_TRUE(v1 == v2);
+	EXPECT_TRUE(v1 != v3);
+	EXPECT_TRUE(v3.IsEmpty());
+	EXPECT_TRUE(v2.ToOctets() == o);
+	EXPECT_TRUE(v2.ToString() == str);
+}
+
+TEST(OctetsTest, SmallBuffer) {
+	std::string small(Octets::SMALL_CAPACITY, 's');
+	std::string large(Octets::SMALL_CAPACITY + 1, 'l');
+	Octets o1(small);
+	Octets o2(large);
+	EXPECT_TRUE(o1.IsSmall());
+	EXPECT_FALSE(o2.IsSmall());
+	// small copies own their data, large copies share the Rep
+	Octets o3(o1);
+	Octets o4(o2);
+	EXPECT_TRUE(o3.GetData() != o1.GetData());
+	EXPECT_TRUE(o4.GetData() == o2.GetData());
+	EXPECT_TRUE(o3 == o1);
+	EXPECT_TRUE(o4 == o2);
+	// growing out of the small buffer
+	Octets o5("ab");
+	o5.Append(large.c_str(), large.size());
+	EXPECT_FALSE(o5.IsSmall());
+	EXPECT_TRUE(o5 == Octets("ab" + large));
+	// swap and assignment between both representations
+	o1.Swap(o2);
+	EXPECT_TRUE(o1 == o4);
+	EXPECT_TRUE(o2 == o3);
+	o1 = o3;
+	EXPECT_TRUE(o1.IsSmall());
+	EXPECT_TRUE(o1 == o3);
+	o1.Assign(large.c_str(), large.size());
+	EXPECT_TRUE(o1 == o4);
+	// objects which left the small buffer swap back into it correctly
+	Octets o6("xy");
+	o6 = o4;
+	Octets o7(o6);
+	Octets o8("z");
+	o7.Swap(o8);
+	EXPECT_TRUE(o7 == Octets("z"));
+	EXPECT_TRUE(o8 == o4);
+	o1.Swap(o7);
+	EXPECT_TRUE(o1 == Octets("z"));
+	EXPECT_TRUE(o7 == o4);
+	o1.Clear();
+	EXPECT_TRUE(o1.IsEmpty());
+	EXPECT_TRUE(o4.GetSize() == large.size());
+	EXPECT_TRUE(Octets("\x01\xAB", 2).Hex() == "01 AB");
+}
+
+TEST(OctetsTest, CopyOnWrite) {
+	std::string str(100, 'x');
+	Octets o1(str);
+	Octets o2(o1);
+	EXPECT_TRUE(o1.GetData() == o2.GetData());
+	// writing to a shared Rep leaves the other owner untouched
+	for (int i = 0; i < 100; ++i) {
+		o2.Append(str.c_str(), str.size());
+	}
+	EXPECT_TRUE(o1.GetSize() == str.size());
+	EXPECT_TRUE(o2.GetSize() == 101 * str.size());
+	EXPECT_TRUE(o1 == Octets(str));
+	o1.Assign(str.c_str(), 50);
+	EXPECT_TRUE(o1.GetSize() == 50);
+	o1 = o2;
+	o2.Assign(str.c_str(), str.size());
+	EXPECT_TRUE(o1.GetSize() == 101 * str.size());
+	EXPECT_TRUE(o2 == Octets(str));
+}
+
+TEST(OctetsTest, Slice) {
+	std::string str("0123456789abcdefghijklmnopqrstuvwxyz");
+	Octets packet(str);
+	OctetsSlice s1 = packet.Slice(10, 6);
+	OctetsSlice s2 = packet.Slice(30);
+	OctetsSlice s3 = packet.Slice(str.size());
+	// slices share the buffer of the packet
+	EXPECT_TRUE(s1.GetData() == static_cast<const char*>(packet.GetData()) + 10);
+	EXPECT_TRUE(s1.ToString() == "abcdef");
+	EXPECT_TRUE(s2.ToString() == "uvwxyz");
+	EXPECT_TRUE(s3.IsEmpty());
+	EXPECT_TRUE(s1.Slice(2, 2).ToString() == "cd");
+	EXPECT_TRUE(s1.Slice(2, 2).GetOffset() == 12);
+	EXPECT_THROW(packet.Slice(str.size() + 1), std::out_of_range);
+	EXPECT_THROW(s1.Slice(7), std::out_of_range);
+	EXPECT_TRUE(s1.Hex() == "61 62 63 64 65 66");
+	EXPECT_TRUE(s1 < s2);
+	EXPECT_TRUE(s1 == Octets("abcdef").Slice());
+	EXPECT_TRUE(packet.Slice().ToOctets().GetData() == packet.GetData());
+	EXPECT_TRUE(s1.ToOctets() == Octets("abcdef"));
+	std::ostringstream oss;
+	oss << s1;
+	EXPECT_TRUE(oss.str() == "abcdef");
+
+	// the slice keeps the data alive
+	packet.Clear();
+	EXPECT_TRUE(s2.ToString() == "uvwxyz");
+
+	// modification copies the slice data and leaves other slices alone
+	OctetsSlice s4 = s1;
+	s4.Append("gh", 2);
+	EXPECT_TRUE(s4.ToString() == "abcdefgh");
+	EXPECT_TRUE(s1.ToString() == "abcdef");
+	s1.Assign("xyz", 3);
+	EXPECT_TRUE(s1.ToString() == "xyz");
+	EXPECT_TRUE(s2.ToString() == "uvwxyz");
+	s2.Clear();
+	EXPECT_TRUE(s2.IsEmpty());
+	EXPECT_TRUE(s2.GetData() == NULL);
+}
+
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+TEST(OctetsTest, MoveSemantics) {
+	std::string str(100, 'm');
+	Octets o1(str);
+	const void *data = o1.GetData();
+	// moves hand over the Rep without copying
+	Octets o2(std::move(o1));
+	EXPECT_TRUE(o1.IsEmpty());
+	EXPECT_TRUE(o2.GetData() == data);
+	Octets o3;
+	o3 = std::move(o2);
+	EXPECT_TRUE(o2.IsEmpty());
+	EXPECT_TRUE(o3.GetData() == data);
+	Octets o4;
+	o4.Append(std::move(o3));
+	EXPECT_TRUE(o4.GetData() == data);
+	Octets o5 = std::move(o4) + Octets("tail");
+	EXPECT_TRUE(o5.GetSize() == str.size() + 4);
+	EXPECT_TRUE(o5 == Octets(str + "tail"));
+	// small objects are moved by value
+	Octets o6("small");
+	Octets o7(std::move(o6));
+	EXPECT_TRUE(o6.IsEmpty());
+	EXPECT_TRUE(o7 == Octets("small"));
+}
+#endif
+
+static std::string WriteTempFile(const std::string& content)
+{
+	char path[] = "/tmp/zbase_octets_XXXXXX";
+	int fd = mkstemp(path);
+	EXPECT_TRUE(fd >= 0);
+	EXPECT_TRUE(write(fd, content.data(), content.size()) == (ssize_t)content.size());
+	close(fd);
+	return path;
+}
+
+TEST(OctetsTest, MapFile) {
+	std::string content;
+	for (int i = 0; i < 10000; ++i) {
+		content += (char)('a' + i % 26);
+	}
+	std::string path = WriteTempFile(content);
+	Octets o1 = Octets::MapFile(path);
+	EXPECT_TRUE(o1.IsReadOnly());
+	EXPECT_FALSE(o1.IsShared());
+	EXPECT_TRUE(o1 == Octets(content));
+	EXPECT_TRUE(o1.Hash() == Octets(content).Hash());
+	// copies and slices share the mapping
+	Octets o2(o1);
+	EXPECT_TRUE(o2.SharesDataWith(o1));
+	OctetsSlice slice = o1.Slice(5000, 26);
+	EXPECT_TRUE(slice.ToString() == content.substr(5000, 26));
+	o1 = Octets();
+	o2 = Octets();
+	EXPECT_TRUE(slice.ToString() == content.substr(5000, 26));
+	// modifications copy the data even if it is not shared
+	Octets o3 = Octets::MapFile(path, Octets::ACCESS_RANDOM | Octets::ACCESS_WILLNEED);
+	const void *mapped = o3.GetData();
+	o3.Append("!", 1);
+	EXPECT_FALSE(o3.IsReadOnly());
+	EXPECT_TRUE(o3.GetData() != mapped);
+	EXPECT_TRUE(o3 == Octets(content + "!"));
+	Octets o4 = Octets::MapFile(path);
+	o4.Clear();
+	EXPECT_TRUE(o4.IsEmpty());
+	Octets o5 = Octets::MapFile(path);
+	o5.Assign(content.data(), 100);
+	EXPECT_TRUE(o5 == Octets(content.substr(0, 100)));
+	unlink(path.c_str());
+}
+
+TEST(OctetsTest, MapSmallFile) {
+	std::string path = WriteTempFile("tiny");
+	Octets o1 = Octets::MapFile(path);
+	EXPECT_TRUE(o1.IsSmall());
+	EXPECT_TRUE(o1 == Octets("tiny"));
+	unlink(path.c_str());
+	path = WriteTempFile("");
+	EXPECT_TRUE(Octets::MapFile(path).IsEmpty());
+	unlink(path.c_str());
+	EXPECT_THROW(Octets::MapFile(path), std::runtime_error);
+	EXPECT_THROW(Octets::MapFile("/tmp"), std::runtime_error);
+}
@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <zbase/octetspool.h>
+#include <pthread.h>
+#include <cstdio>
+#include <unistd.h>
+#include <string>
+using namespace zbase;
+
+TEST(OctetsPoolTest, Intern) {
+	OctetsPool pool;
+	std::string str(100, 'i');
+	Octets o1 = pool.Intern(Octets(str));
+	Octets o2 = pool.Intern(Octets(str));
+	Octets o3 = pool.Intern(str.data(), str.size());
+	EXPECT_TRUE(o1 == Octets(str));
+	EXPECT_TRUE(o1.SharesDataWith(o2));
+	EXPECT_TRUE(o1.SharesDataWith(o3));
+	EXPECT_FALSE(o1.SharesDataWith(Octets(str)));
+	// small values get a Rep as well
+	Octets s1 = pool.Intern(Octets("tag"));
+	Octets s2 = pool.Intern("tag", 3);
+	EXPECT_TRUE(s1 == Octets("tag"));
+	EXPECT_TRUE(s1.SharesDataWith(s2));
+	EXPECT_FALSE(s1.SharesDataWith(o1));
+	EXPECT_TRUE(pool.GetSize() == 2);
+
+	Octets found;
+	EXPECT_TRUE(pool.Find(OctetsView(str.data(), str.size()), &found));
+	EXPECT_TRUE(found.SharesDataWith(o1));
+	EXPECT_FALSE(pool.Find(OctetsView("none", 4), &found));
+
+	OctetsPoolStats stats = pool.GetStats();
+	EXPECT_TRUE(stats.entries == 2);
+	EXPECT_TRUE(stats.bytes_stored == str.size() + 3);
+	EXPECT_TRUE(stats.lookups == 7);
+	EXPECT_TRUE(stats.hits == 4);
+	EXPECT_TRUE(stats.bytes_saved == 2 * (Octets::GetRepHeaderSize() + str.size()));
+
+	// a modified copy does not affect the canonical value
+	o2.Append("x", 1);
+	EXPECT_TRUE(o1 == Octets(str));
+	EXPECT_TRUE(pool.Intern(Octets(str)).SharesDataWith(o1));
+}
+
+TEST(OctetsPoolTest, Purge) {
+	OctetsPool pool(4);
+	Octets kept = pool.Intern(Octets(std::string(50, 'k')));
+	pool.Intern(Octets(std::string(50, 'd')));
+	pool.Intern("dropped", 7);
+	EXPECT_TRUE(pool.GetSize() == 3);
+	EXPECT_TRUE(pool.Purge() == 2);
+	EXPECT_TRUE(pool.GetSize() == 1);
+	EXPECT_TRUE(pool.GetStats().bytes_stored == 50);
+	EXPECT_TRUE(pool.Intern(Octets(std::string(50, 'k'))).SharesDataWith(kept));
+	pool.Clear();
+	EXPECT_TRUE(pool.GetSize() == 0);
+	EXPECT_TRUE(kept == Octets(std::string(50, 'k')));
+}
+
+TEST(OctetsPoolTest, ForeignAllocators) {
+	OctetsPool pool;
+	std::string str(100, 'a');
+	ArenaAllocator arena;
+	Octets arena_value;
+	Octets o1, o2;
+	{
+		ScopedAllocator scope(&arena);
+		arena_value = Octets(str);
+		// neither the caller's Rep nor a new one may come from the arena
+		o1 = pool.Intern(arena_value);
+		o2 = pool.Intern("arena", 5);
+	}
+	EXPECT_FALSE(o1.SharesDataWith(arena_value));
+	arena_value.Clear();
+	arena.Reset();
+	{
+		ScopedAllocator scope(&arena);
+		Octets overwrite(std::string(200, 'z'));
+	}
+	EXPECT_TRUE(o1 == Octets(str));
+	EXPECT_TRUE(o2 == Octets("arena"));
+	EXPECT_TRUE(pool.Intern(Octets(str)).SharesDataWith(o1));
+
+	// a file mapping is copied rather than kept alive by the pool
+	char path[] = "/tmp/zbase_octetspool_XXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_TRUE(fd >= 0);
+	std::string content(100, 'm');
+	EXPECT_TRUE(write(fd, content.data(), content.size()) == static_cast<ssize_t>(content.size()));
+	close(fd);
+	Octets mapped = Octets::MapFile(path);
+	unlink(path);
+	Octets o3 = pool.Intern(mapped);
+	EXPECT_TRUE(o3 == mapped);
+	EXPECT_FALSE(o3.SharesDataWith(mapped));
+	EXPECT_FALSE(o3.IsReadOnly());
+}
+
+static OctetsPool s_pool;
+
+static void* InternInThread(void *arg)
+{
+	Octets *results = static_cast<Octets*>(arg);
+	char name[64];
+	for (int round = 0; round < 10; ++round) {
+		for (int i = 0; i < 100; ++i) {
+			snprintf(name, sizeof(name), "metric.name.%040d", i);
+			Octets o = s_pool.Intern(name, strlen(name));
+			if (0 == round) {
+				results[i] = o;
+			}
+		}
+	}
+	return NULL;
+}
+
+TEST(OctetsPoolTest, Threads) {
+	const int NUM_THREADS = 4;
+	Octets results[NUM_THREADS][100];
+	pthread_t threads[NUM_THREADS];
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_create(&threads[i], NULL, InternInThread, results[i]);
+	}
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	EXPECT_TRUE(s_pool.GetSize() == 100);
+	for (int t = 1; t < NUM_THREADS; ++t) {
+		for (int i = 0; i < 100; ++i) {
+			EXPECT_TRUE(results[t][i].SharesDataWith(results[0][i]));
+		}
+	}
+	OctetsPoolStats stats = s_pool.GetStats();
+	EXPECT_TRUE(stats.lookups == NUM_THREADS * 1000);
+	EXPECT_TRUE(stats.hits == NUM_THREADS * 1000 - 100);
+	s_pool.Clear();
+}
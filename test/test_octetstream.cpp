@@ -1,5 +1,8 @@
 #include <gtest/gtest.h>
 #include <zbase/octetstream.h>
+#include <zbase/utility.h>
+#include <cstdio>
+#include <unistd.h>
 using namespace zbase;
 
 TEST(OctetStreamTest, DefaultConstructor) {
@@ -288,3 +291,495 @@ TEST(OctetStreamTest, InsertionAndExtraction_multimap) {
 	}
 }
 
+TEST(OctetStreamTest, InsertionAndExtraction_array) {
+	uint32_t data1[] = {1, 2, 0xDEADBEEF};
+	uint32_t data2[ARRAY_SIZE(data1)] = {0};
+	std::string strs1[] = {"a", "", "ccc"};
+	std::string strs2[ARRAY_SIZE(strs1)] = {"x", "y", "z"};
+	OctetStream os;
+	os << data1 << strs1;
+	// no length prefix
+	EXPECT_TRUE(os.GetSize() == sizeof(data1) + 3 * sizeof(uint32_t) + 4);
+	EXPECT_TRUE(OctetStream::GetPackSize(data1) + OctetStream::GetPackSize(strs1) == os.GetSize());
+	os >> data2 >> strs2;
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_TRUE(memcmp(data1, data2, sizeof(data1)) == 0);
+	// elements are overwritten, not appended to
+	for (size_t i = 0; i < ARRAY_SIZE(strs1); ++i) {
+		EXPECT_TRUE(strs1[i] == strs2[i]);
+	}
+	// char arrays, string literals included, do not compile: os << "abc";
+
+	int16_t matrix1[2][3] = {{1, -2, 3}, {-4, 5, -6}};
+	int16_t matrix2[2][3] = {{0}};
+	os.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	os << matrix1;
+	EXPECT_TRUE(os.GetSize() == 6);
+	os >> matrix2;
+	EXPECT_TRUE(memcmp(matrix1, matrix2, sizeof(matrix1)) == 0);
+
+	// truncated input
+	os.SetIntegerEncoding(OctetStream::ENCODING_FIXED);
+	os << data1;
+	OctetStream truncated(os.GetData(), os.GetSize() - 1);
+	EXPECT_THROW(truncated >> data2, std::length_error);
+
+#ifdef ZBASE_HAS_STD_ARRAY
+	std::array<uint64_t, 3> array1 = {{7, 8, 9}};
+	std::array<uint64_t, 3> array2 = {{0, 0, 0}};
+	std::array<std::string, 2> array3 = {{"x", "yz"}};
+	std::array<std::string, 2> array4;
+	// std::array<char, N> is a byte buffer, without a length prefix
+	std::array<char, 8> name1 = {{'z', 'b', 'a', 's', 'e'}};
+	std::array<char, 8> name2 = {{0}};
+	os.Clear();
+	os << array1 << array3 << name1;
+	EXPECT_TRUE(os.GetSize() == OctetStream::GetPackSize(array1) + OctetStream::GetPackSize(array3) + name1.size());
+	EXPECT_TRUE(OctetStream::GetPackSize(name1) == name1.size());
+	os >> array2 >> array4 >> name2;
+	EXPECT_TRUE(array1 == array2);
+	EXPECT_TRUE(array3 == array4);
+	EXPECT_TRUE(name1 == name2);
+#endif
+}
+
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+TEST(OctetStreamTest, InsertionAndExtraction_unordered) {
+	std::unordered_map<uint32_t, std::string> data1, data2;
+	for (uint32_t i = 0; i < 100; ++i) {
+		data1[i * 7] = std::string(i % 5 + 1, 'a' + i % 26);
+	}
+	OctetStream os;
+	os << data1;
+	EXPECT_TRUE(os.GetSize() == OctetStream::GetPackSize(data1));
+	os >> data2;
+	EXPECT_TRUE(data1 == data2);
+	// buckets are reserved up front
+	EXPECT_TRUE(data2.bucket_count() >= data1.size() / data2.max_load_factor());
+
+	// same wire layout as the ordered containers
+	os << data1;
+	std::map<uint32_t, std::string> ordered;
+	os >> ordered;
+	EXPECT_TRUE(ordered.size() == data1.size());
+	EXPECT_TRUE(ordered[7 * 42] == data1[7 * 42]);
+
+	std::unordered_multimap<std::string, int32_t> multi1, multi2;
+	multi1.insert(std::make_pair(std::string("k"), 1));
+	multi1.insert(std::make_pair(std::string("k"), 2));
+	std::unordered_set<int64_t> set1, set2;
+	set1.insert(-1);
+	set1.insert(1LL << 40);
+	std::unordered_multiset<uint8_t> mset1, mset2;
+	mset1.insert(3);
+	mset1.insert(3);
+	os << multi1 << set1 << mset1;
+	os >> multi2 >> set2 >> mset2;
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_TRUE(multi1 == multi2);
+	EXPECT_TRUE(set1 == set2);
+	EXPECT_TRUE(mset1 == mset2);
+
+	// a huge count from the wire does not reserve a huge table
+	OctetStream bogus;
+	bogus.PushInteger<uint32_t>(0xFFFFFFFF);
+	bogus << uint32_t(1) << std::string("one");
+	std::unordered_map<uint32_t, std::string> small;
+	bogus >> small;
+	EXPECT_TRUE(small.size() == 1);
+	EXPECT_TRUE(small.bucket_count() < 1024);
+}
+#endif
+
+TEST(OctetStreamTest, GrowthPolicy) {
+	std::string str(1000, 'x');
+	OctetStream os1;
+	EXPECT_TRUE(os1.GetGrowthPolicy() == OctetStream::GROWTH_GEOMETRIC);
+	for (int i = 0; i < 100; ++i) {
+		os1.Write(str.c_str(), str.size());
+	}
+	EXPECT_TRUE(os1.GetSize() == 100 * str.size());
+	EXPECT_TRUE(os1.GetCapacity() >= os1.GetSize());
+	EXPECT_TRUE(os1.GetCapacity() % OctetStream::LARGE_PAGE_SIZE == 0);
+
+	OctetStream os2;
+	os2.SetGrowthPolicy(OctetStream::GROWTH_EXACT);
+	os2.Write(str.c_str(), 10);
+	EXPECT_TRUE(os2.GetCapacity() == 10);
+	os2.Write(str.c_str(), 5);
+	EXPECT_TRUE(os2.GetCapacity() == 15);
+	os2.ReserveForWrite(100);
+	EXPECT_TRUE(os2.GetCapacity() == 115);
+	// the policy goes with the buffer
+	os1.Swap(os2);
+	EXPECT_TRUE(os1.GetGrowthPolicy() == OctetStream::GROWTH_EXACT);
+	EXPECT_TRUE(os2.GetGrowthPolicy() == OctetStream::GROWTH_GEOMETRIC);
+	os1.Swap(os2);
+
+	OctetStream os3;
+	os3.SetGrowthPolicy(OctetStream::GROWTH_PAGED);
+	os3.Write(str.c_str(), str.size());
+	EXPECT_TRUE(os3.GetCapacity() == 4 * OctetStream::PAGE_SIZE);
+	EXPECT_TRUE(memcmp(os3.GetData(), str.c_str(), str.size()) == 0);
+}
+
+TEST(OctetStreamTest, ReserveForWrite) {
+	OctetStream os;
+	os << (int32_t)1;
+	os.ReserveForWrite(4096);
+	size_t capacity = os.GetCapacity();
+	EXPECT_TRUE(capacity >= 4096 + sizeof(int32_t));
+	for (int i = 0; i < 1024; ++i) {
+		os << (int32_t)i;
+	}
+	EXPECT_TRUE(os.GetCapacity() == capacity);
+	int32_t value = 0;
+	os >> value;
+	EXPECT_TRUE(value == 1);
+	for (int i = 0; i < 1024; ++i) {
+		os >> value;
+		EXPECT_TRUE(value == i);
+	}
+}
+
+class PackSizeTestData : public ISerialize
+{
+public:
+	PackSizeTestData() : id(0) {}
+
+	virtual OctetStream* Serialize(OctetStream *stream) const
+	{
+		return &(*stream << id << name << values);
+	}
+
+	virtual OctetStream* Deserialize(OctetStream *stream)
+	{
+		return &(*stream >> id >> name >> values);
+	}
+
+	int32_t id;
+	std::string name;
+	std::map<std::string, std::vector<int16_t> > values;
+};
+
+TEST(OctetStreamTest, GetPackSize) {
+	PackSizeTestData data;
+	data.id = 7;
+	data.name = "pack size";
+	data.values["a"].push_back(1);
+	data.values["a"].push_back(2);
+	data.values["bc"].push_back(3);
+	std::list<std::pair<int64_t, Octets> > items;
+	items.push_back(std::make_pair((int64_t)1, Octets("one")));
+	items.push_back(std::make_pair((int64_t)2, Octets("two")));
+	std::vector<int32_t> empty;
+
+	size_t size = OctetStream::GetPackSize(data) + OctetStream::GetPackSize(items)
+		+ OctetStream::GetPackSize(empty) + OctetStream::GetPackSize(true) + OctetStream::GetPackSize(1.0);
+	OctetStream os;
+	os.SetGrowthPolicy(OctetStream::GROWTH_EXACT);
+	os.ReserveForWrite(size);
+	size_t capacity = os.GetCapacity();
+	os << data << items << empty << true << 1.0;
+	EXPECT_TRUE(os.GetSize() == size);
+	EXPECT_TRUE(os.GetCapacity() == capacity);
+}
+
+TEST(OctetStreamTest, ExtractionView) {
+	OctetStream os1;
+	os1 << Octets("hello") << std::string() << std::string("world");
+	Octets data(os1);
+	OctetStream os2(data, true);
+	OctetsView v1, v2, v3;
+	os2 >> v1 >> v2 >> v3;
+	EXPECT_TRUE(os2.IsEmpty());
+	EXPECT_TRUE(v1.ToString() == "hello");
+	EXPECT_TRUE(v2.IsEmpty());
+	EXPECT_TRUE(v3.ToString() == "world");
+	// views refer to the attached buffer without copying
+	EXPECT_TRUE(static_cast<const char*>(v1.GetData()) == static_cast<const char*>(os2.begin()) + sizeof(uint32_t));
+
+	OctetStream os3;
+	os3 << v3;
+	std::string str;
+	os3 >> str;
+	EXPECT_TRUE(str == "world");
+}
+
+TEST(OctetStreamTest, InsertionAndExtraction_bulkvector) {
+	std::vector<int32_t> data1, data2;
+	std::vector<double> data3, data4;
+	std::vector<std::string> data5, data6;
+	for (int i = -1000; i <= 1000; ++i) {
+		data1.push_back(i * 12345);
+		data3.push_back(i / 7.0);
+	}
+	data5.push_back("bulk");
+	OctetStream os;
+	os << data1 << data3 << data5;
+	EXPECT_TRUE(os.GetSize() == OctetStream::GetPackSize(data1) + OctetStream::GetPackSize(data3) + OctetStream::GetPackSize(data5));
+	// wire format is the same as element by element insertion
+	OctetStream expected;
+	expected << (uint32_t)data1.size();
+	for (size_t i = 0; i < data1.size(); ++i) {
+		expected << data1[i];
+	}
+	EXPECT_TRUE(memcmp(os.GetData(), expected.GetData(), expected.GetSize()) == 0);
+	os >> data2 >> data4 >> data6;
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_TRUE(data1 == data2);
+	EXPECT_TRUE(data3 == data4);
+	EXPECT_TRUE(data5 == data6);
+
+	// truncated input
+	os << data1;
+	OctetStream truncated(os.GetData(), os.GetSize() - 1);
+	EXPECT_THROW(truncated >> data2, std::length_error);
+}
+
+TEST(OctetStreamTest, ArrayReadWrite) {
+	uint16_t data1[] = {1, 2, 0x1234, 0xFFFF};
+	uint16_t data2[ARRAY_SIZE(data1)] = {0};
+	OctetStream os;
+	os.WriteArray(data1, ARRAY_SIZE(data1));
+	EXPECT_TRUE(os.GetSize() == sizeof(data1));
+	uint16_t value = 0;
+	os >> value;
+	EXPECT_TRUE(value == 1);
+	os.Unget(sizeof(value));
+	os.ReadArray(data2, ARRAY_SIZE(data2));
+	EXPECT_TRUE(memcmp(data1, data2, sizeof(data1)) == 0);
+}
+
+TEST(OctetStreamTest, Varint) {
+	OctetStream os;
+	os.PushVarint<uint32_t>(0);
+	os.PushVarint<uint32_t>(127);
+	os.PushVarint<uint32_t>(128);
+	os.PushVarint<int32_t>(-1);
+	os.PushVarint<int32_t>(-64);
+	os.PushVarint<int64_t>(INT64_MIN);
+	os.PushVarint<uint64_t>(UINT64_MAX);
+	EXPECT_TRUE(os.GetSize() == 1 + 1 + 2 + 1 + 1 + 10 + 10);
+	// LEB128 wire format
+	EXPECT_TRUE(memcmp(os.GetData(), "\x00\x7F\x80\x01\x01\x7F", 6) == 0);
+	EXPECT_TRUE(OctetStream::GetVarintPackSize<uint32_t>(128) == 2);
+	EXPECT_TRUE(OctetStream::GetVarintPackSize<int64_t>(INT64_MIN) == 10);
+	EXPECT_TRUE(os.PeekVarint<uint32_t>() == 0);
+	EXPECT_TRUE(os.PopVarint<uint32_t>() == 0);
+	EXPECT_TRUE(os.PopVarint<uint32_t>() == 127);
+	EXPECT_TRUE(os.PopVarint<uint32_t>() == 128);
+	EXPECT_TRUE(os.PopVarint<int32_t>() == -1);
+	EXPECT_TRUE(os.PopVarint<int32_t>() == -64);
+	EXPECT_TRUE(os.PopVarint<int64_t>() == INT64_MIN);
+	EXPECT_TRUE(os.PopVarint<uint64_t>() == UINT64_MAX);
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_THROW(os.PopVarint<uint32_t>(), std::length_error);
+	// incomplete value
+	os.Write("\x80\x80", 2);
+	EXPECT_THROW(os.PopVarint<uint32_t>(), std::length_error);
+	EXPECT_TRUE(os.GetSize() == 2);
+}
+
+TEST(OctetStreamTest, VarintEncoding) {
+	std::vector<int32_t> data1, data2;
+	std::map<std::string, uint64_t> data3, data4;
+	for (int i = -100; i <= 100; ++i) {
+		data1.push_back(i);
+	}
+	data3["a"] = 1;
+	data3["b"] = 300;
+	int16_t v1 = -2, t1 = 0;
+	uint64_t v2 = 1, t2 = 0;
+	std::string v3("varint"), t3;
+
+	OctetStream os;
+	os.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	os << v1 << v2 << v3 << data1 << data3;
+	// v1, v2, length-prefixed v3, vector count, map with count and varint values
+	size_t expected = 1 + 1 + (1 + 6) + 2 + (1 + (2 + 1) + (2 + 2));
+	for (size_t i = 0; i < data1.size(); ++i) {
+		expected += OctetStream::GetVarintPackSize(data1[i]);
+	}
+	EXPECT_TRUE(os.GetSize() == expected);
+	os >> t1 >> t2 >> t3 >> data2 >> data4;
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_TRUE(v1 == t1);
+	EXPECT_TRUE(v2 == t2);
+	EXPECT_TRUE(v3 == t3);
+	EXPECT_TRUE(data1 == data2);
+	EXPECT_TRUE(data3 == data4);
+}
+
+TEST(OctetStreamTest, SwapEncoding) {
+	OctetStream fixed;
+	OctetStream varint;
+	varint.SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	fixed << (uint32_t)300 << std::string("fixed");
+	varint << (uint32_t)70000 << std::string("varint");
+	// the encoding goes with the bytes written in it
+	fixed.Swap(varint);
+	EXPECT_TRUE(fixed.GetIntegerEncoding() == OctetStream::ENCODING_VARINT);
+	EXPECT_TRUE(varint.GetIntegerEncoding() == OctetStream::ENCODING_FIXED);
+	uint32_t v1 = 0, v2 = 0;
+	std::string s1, s2;
+	fixed >> v1 >> s1;
+	varint >> v2 >> s2;
+	EXPECT_TRUE(fixed.IsEmpty());
+	EXPECT_TRUE(varint.IsEmpty());
+	EXPECT_TRUE(v1 == 70000 && s1 == "varint");
+	EXPECT_TRUE(v2 == 300 && s2 == "fixed");
+}
+
+TEST(OctetStreamTest, TryPop) {
+	OctetStream os;
+	os << (uint16_t)0x1234 << (int32_t)-5;
+	os.PushVarint<int64_t>(-300);
+	uint16_t v1 = 0;
+	int32_t v2 = 0;
+	int64_t v3 = 0;
+	uint64_t v4 = 0;
+	char buf[4] = {0};
+	EXPECT_TRUE(os.TryPopInteger(v1));
+	EXPECT_TRUE(os.TryPopInteger(v2));
+	EXPECT_FALSE(os.TryPopInteger(v4));
+	EXPECT_TRUE(os.TryPopVarint(v3));
+	EXPECT_FALSE(os.TryPopVarint(v4));
+	EXPECT_FALSE(os.TryRead(buf, 1));
+	EXPECT_TRUE(v1 == 0x1234);
+	EXPECT_TRUE(v2 == -5);
+	EXPECT_TRUE(v3 == -300);
+	EXPECT_TRUE(os.IsEmpty());
+}
+
+TEST(OctetStreamTest, CheckedRegion) {
+	OctetStream os;
+	os << (uint32_t)7 << (uint16_t)2 << (uint8_t)1 << 1.5 << (int8_t)-1;
+	{
+		OctetStream::CheckedRegion region(os, 64);
+		EXPECT_FALSE(region.IsValid());
+		EXPECT_TRUE(os.GetSize() == 16);
+	}
+	{
+		OctetStream::CheckedRegion region(os, 15);
+		EXPECT_TRUE(region.IsValid());
+		EXPECT_TRUE(os.GetSize() == 1);
+		EXPECT_TRUE(region.ReadInteger<uint32_t>() == 7);
+		EXPECT_TRUE(region.ReadInteger<uint16_t>() == 2);
+		region.Skip(1);
+		EXPECT_TRUE(region.ReadRaw<double>() == 1.5);
+		EXPECT_TRUE(region.GetSize() == 0);
+	}
+	int8_t last = 0;
+	os >> last;
+	EXPECT_TRUE(last == -1);
+}
+
+TEST(OctetStreamTest, InsertionSlice) {
+	Octets packet(std::string("header:payload"));
+	OctetStream os;
+	os << packet.Slice(7);
+	EXPECT_TRUE(os.GetSize() == OctetStream::GetPackSize(packet.Slice(7)));
+	Octets data;
+	os >> data;
+	EXPECT_TRUE(data == Octets("payload"));
+}
+
+TEST(OctetStreamTest, TakeOctets) {
+	std::string str(1000, 't');
+	OctetStream os1;
+	os1 << (int32_t)1;
+	os1.Write(str.c_str(), str.size());
+	int32_t v = 0;
+	os1 >> v;
+	const void *data = os1.GetData();
+	Octets o1 = os1.TakeOctets();
+	EXPECT_TRUE(os1.IsEmpty());
+	EXPECT_TRUE(o1 == Octets(str));
+	// the buffer was handed over, moving the unread data to its front only
+	EXPECT_TRUE(static_cast<const char*>(o1.GetData()) == static_cast<const char*>(data) - sizeof(int32_t));
+	os1 << (int32_t)2;
+	os1 >> v;
+	EXPECT_TRUE(v == 2);
+
+	OctetStream os2(str.c_str(), 10, true);
+	Octets o2 = os2.TakeOctets();
+	EXPECT_TRUE(os2.IsEmpty());
+	EXPECT_TRUE(o2 == Octets(str.substr(0, 10)));
+	EXPECT_TRUE(os2.TakeOctets().IsEmpty());
+}
+
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+TEST(OctetStreamTest, MoveSemantics) {
+	OctetStream os1;
+	os1 << std::string("move");
+	const void *data = os1.GetData();
+	OctetStream os2(std::move(os1));
+	EXPECT_TRUE(os1.IsEmpty());
+	EXPECT_TRUE(os2.GetData() == data);
+	OctetStream os3;
+	os3 = std::move(os2);
+	EXPECT_TRUE(os3.GetData() == data);
+	std::string str;
+	os3 >> str;
+	EXPECT_TRUE(str == "move");
+
+	// extracted elements are moved into the container
+	std::vector<Octets> data1, data2;
+	data1.push_back(Octets(std::string(100, 'a')));
+	data1.push_back(Octets("b"));
+	os3 << data1;
+	os3 >> data2;
+	EXPECT_TRUE(data2.size() == 2);
+	EXPECT_TRUE(data1[0] == data2[0]);
+	EXPECT_TRUE(data1[1] == data2[1]);
+}
+#endif
+
+TEST(OctetStreamTest, AttachOctets) {
+	OctetStream writer;
+	for (int32_t i = 0; i < 1000; ++i) {
+		writer << i;
+	}
+	char path[] = "/tmp/zbase_octetstream_XXXXXX";
+	int fd = mkstemp(path);
+	ASSERT_TRUE(fd >= 0);
+	EXPECT_TRUE(write(fd, writer.GetData(), writer.GetSize()) == (ssize_t)writer.GetSize());
+	close(fd);
+	// the stream keeps the mapping alive
+	OctetStream os(Octets::MapFile(path), true);
+	unlink(path);
+	EXPECT_TRUE(os.IsAttachMode());
+	EXPECT_TRUE(os.GetSize() == writer.GetSize());
+	int32_t value = 0;
+	for (int32_t i = 0; i < 1000; ++i) {
+		os >> value;
+		EXPECT_EQ(i, value);
+	}
+	// small data is held inline and follows the stream when it is moved
+	OctetStream small;
+	small.Attach(Octets("abc"));
+	EXPECT_TRUE(small.ToString() == "abc");
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	OctetStream moved(std::move(small));
+	EXPECT_TRUE(moved.ToString() == "abc");
+#endif
+	// and when it is swapped, in attach mode or not
+	OctetStream owner;
+	{
+		OctetStream attached;
+		attached.Attach(Octets("xyz"));
+		owner << (int32_t)7;
+		owner.Swap(attached);
+		EXPECT_FALSE(attached.IsAttachMode());
+		int32_t seven = 0;
+		attached >> seven;
+		EXPECT_EQ(7, seven);
+	}
+	EXPECT_TRUE(owner.IsAttachMode());
+	EXPECT_TRUE(owner.ToString() == "xyz");
+	// assignment turns an attached stream into an owning one
+	os = writer;
+	EXPECT_FALSE(os.IsAttachMode());
+	EXPECT_TRUE(os.GetSize() == writer.GetSize());
+}
@@ -0,0 +1,119 @@
+#include <gtest/gtest.h>
+#include <zbase/octetstreampool.h>
+#include <zbase/allocator.h>
+#include <pthread.h>
+#include <string>
+using namespace zbase;
+
+TEST(OctetStreamPoolTest, AcquireRelease) {
+	OctetStreamPool pool(64 * 1024, 2);
+	EXPECT_TRUE(pool.GetMaxCapacity() == 64 * 1024);
+	OctetStream *os1 = pool.Acquire(1000);
+	EXPECT_TRUE(os1->IsEmpty());
+	EXPECT_TRUE(os1->GetCapacity() == 1024);
+	*os1 << std::string(500, 'a');
+	os1->Ignore(100);
+	os1->SetIntegerEncoding(OctetStream::ENCODING_VARINT);
+	pool.Release(os1);
+	// the same stream comes back cleared and with default settings
+	OctetStream *os2 = pool.Acquire(600);
+	EXPECT_TRUE(os2 == os1);
+	EXPECT_TRUE(os2->IsEmpty());
+	EXPECT_TRUE(os2->GetCapacity() == 1024);
+	*os2 << std::string(1000, 'b');
+	EXPECT_TRUE(os2->GetCapacity() == 1024);
+	EXPECT_TRUE(os2->GetIntegerEncoding() == OctetStream::ENCODING_FIXED);
+	// another size class
+	OctetStream *os3 = pool.Acquire(100);
+	EXPECT_TRUE(os3 != os2);
+	EXPECT_TRUE(os3->GetCapacity() == OctetStreamPool::MIN_CAPACITY);
+	pool.Release(os2);
+	pool.Release(os3);
+	OctetStreamPoolStats stats = pool.GetStats();
+	EXPECT_TRUE(stats.acquires == 3);
+	EXPECT_TRUE(stats.hits == 1);
+	EXPECT_TRUE(stats.releases == 3);
+	EXPECT_TRUE(stats.discards == 0);
+	EXPECT_TRUE(stats.pooled_streams == 2);
+	EXPECT_TRUE(stats.pooled_bytes == 1024 + OctetStreamPool::MIN_CAPACITY);
+	pool.Trim();
+	EXPECT_TRUE(pool.GetStats().pooled_streams == 0);
+	EXPECT_TRUE(pool.GetStats().pooled_bytes == 0);
+}
+
+TEST(OctetStreamPoolTest, Trimming) {
+	OctetStreamPool pool(4096, 1);
+	// streams grown beyond the maximum capacity are shrunk
+	OctetStream *os1 = pool.Acquire();
+	*os1 << std::string(10000, 'x');
+	pool.Release(os1);
+	OctetStreamPoolStats stats = pool.GetStats();
+	EXPECT_TRUE(stats.shrinks == 1);
+	EXPECT_TRUE(stats.pooled_bytes == 4096);
+	// full classes and streams without a buffer are discarded
+	OctetStream *os2 = pool.Acquire(4096);
+	OctetStream *os3 = pool.Acquire(4096);
+	EXPECT_TRUE(os2 == os1);
+	pool.Release(os2);
+	pool.Release(os3);
+	OctetStream *os4 = pool.Acquire();
+	*os4 << std::string(1000, 'y');
+	Octets o = os4->TakeOctets();
+	pool.Release(os4);
+	stats = pool.GetStats();
+	EXPECT_TRUE(stats.discards == 2);
+	EXPECT_TRUE(stats.pooled_streams == 1);
+	// oversized requests never hit
+	OctetStream *os5 = pool.Acquire(100000);
+	EXPECT_TRUE(os5->GetCapacity() >= 100000);
+	pool.Release(os5);
+	EXPECT_TRUE(pool.GetStats().hits == 1);
+}
+
+TEST(OctetStreamPoolTest, ScopedStream) {
+	OctetStreamPool pool;
+	ArenaAllocator arena;
+	{
+		ScopedAllocator scope(&arena);
+		PooledOctetStream os(pool, 300);
+		// pooled buffers never come from a scoped allocator
+		EXPECT_TRUE(os->GetAllocator() == Allocator::GetDefault());
+		*os << (int32_t)1;
+		EXPECT_TRUE(os->GetSize() == sizeof(int32_t));
+	}
+	{
+		PooledOctetStream os(pool, 300);
+		EXPECT_TRUE((*os).IsEmpty());
+	}
+	OctetStreamPoolStats stats = pool.GetStats();
+	EXPECT_TRUE(stats.hits == 1);
+	EXPECT_TRUE(stats.pooled_streams == 1);
+}
+
+static void* EncodeInThread(void *arg)
+{
+	OctetStreamPool *pool = static_cast<OctetStreamPool*>(arg);
+	for (int i = 0; i < 1000; ++i) {
+		PooledOctetStream os(*pool, 100 + i % 2000);
+		// exactly the requested capacity, so that the stream stays in its size class
+		*os << std::string(100 + i % 2000 - sizeof(uint32_t), 'z');
+		EXPECT_TRUE(os->GetSize() == 100 + static_cast<size_t>(i % 2000));
+	}
+	return NULL;
+}
+
+TEST(OctetStreamPoolTest, Threads) {
+	const int NUM_THREADS = 4;
+	OctetStreamPool pool;
+	pthread_t threads[NUM_THREADS];
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_create(&threads[i], NULL, EncodeInThread, &pool);
+	}
+	for (int i = 0; i < NUM_THREADS; ++i) {
+		pthread_join(threads[i], NULL);
+	}
+	OctetStreamPoolStats stats = pool.GetStats();
+	EXPECT_TRUE(stats.acquires == NUM_THREADS * 1000);
+	EXPECT_TRUE(stats.releases == NUM_THREADS * 1000);
+	EXPECT_TRUE(stats.hits + NUM_THREADS * 5 >= stats.acquires);
+}
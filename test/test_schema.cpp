@@ -0,0 +1,164 @@
+#include <gtest/gtest.h>
+#include <zbase/schema.h>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+namespace
+{
+	struct Point
+	{
+		int32_t x;
+		int32_t y;
+	};
+	ZBASE_SCHEMA(Point, x, y)
+
+	struct Order
+	{
+		uint64_t id;
+		bool is_buy;
+		int8_t side;
+		double price;
+		std::string symbol;
+		uint16_t flags;
+		Point origin;
+		std::vector<int32_t> fills;
+		Octets note;
+	};
+	ZBASE_SCHEMA(Order, id, is_buy, side, price, symbol, flags, origin, fills, note)
+
+	// the same message through the virtual interface
+	struct LegacyOrder : public ISerialize
+	{
+		virtual OctetStream* Serialize(OctetStream *stream) const
+		{
+			*stream << order.id << order.is_buy << order.side << order.price << order.symbol << order.flags
+			        << order.origin.x << order.origin.y << order.fills << order.note;
+			return stream;
+		}
+		virtual OctetStream* Deserialize(OctetStream *stream)
+		{
+			*stream >> order.id >> order.is_buy >> order.side >> order.price >> order.symbol >> order.flags
+			        >> order.origin.x >> order.origin.y >> order.fills >> order.note;
+			return stream;
+		}
+
+		Order order;
+	};
+
+	struct Tick : public schema::SchemaSerialize<Tick>
+	{
+		uint32_t seq;
+		float value;
+	};
+	ZBASE_SCHEMA(Tick, seq, value)
+
+	Order MakeOrder()
+	{
+		Order order;
+		order.id = 0x0102030405060708ULL;
+		order.is_buy = true;
+		order.side = -3;
+		order.price = 101.25;
+		order.symbol = "ZBASE";
+		order.flags = 0xABCD;
+		order.origin.x = -7;
+		order.origin.y = 9;
+		order.fills.push_back(100);
+		order.fills.push_back(-200);
+		order.note = Octets(std::string(40, 'n'));
+		return order;
+	}
+
+	void ExpectEqual(const Order& a, const Order& b)
+	{
+		EXPECT_EQ(a.id, b.id);
+		EXPECT_EQ(a.is_buy, b.is_buy);
+		EXPECT_EQ(a.side, b.side);
+		EXPECT_EQ(a.price, b.price);
+		EXPECT_EQ(a.symbol, b.symbol);
+		EXPECT_EQ(a.flags, b.flags);
+		EXPECT_EQ(a.origin.x, b.origin.x);
+		EXPECT_EQ(a.origin.y, b.origin.y);
+		EXPECT_TRUE(a.fills == b.fills);
+		EXPECT_TRUE(a.note == b.note);
+	}
+}
+
+TEST(SchemaTest, HasSchema) {
+	EXPECT_TRUE(schema::HasSchema<Point>::value);
+	EXPECT_TRUE(schema::HasSchema<Order>::value);
+	EXPECT_FALSE(schema::HasSchema<int>::value);
+	EXPECT_FALSE(schema::HasSchema<LegacyOrder>::value);
+}
+
+TEST(SchemaTest, WireCompatibility) {
+	LegacyOrder legacy;
+	legacy.order = MakeOrder();
+	for (int encoding = OctetStream::ENCODING_FIXED; encoding <= OctetStream::ENCODING_VARINT; ++encoding) {
+		OctetStream os1, os2;
+		os1.SetIntegerEncoding(static_cast<OctetStream::IntegerEncoding>(encoding));
+		os2.SetIntegerEncoding(static_cast<OctetStream::IntegerEncoding>(encoding));
+		os1 << legacy.order;
+		os2 << legacy;
+		// the schema writes exactly what the hand-written code does
+		EXPECT_TRUE(os1.ToString() == os2.ToString());
+		if (OctetStream::ENCODING_FIXED == encoding) {
+			EXPECT_EQ(schema::GetPackSize(legacy.order), os1.GetSize());
+		}
+		LegacyOrder decoded;
+		os1 >> decoded.order;
+		EXPECT_TRUE(os1.IsEmpty());
+		ExpectEqual(legacy.order, decoded.order);
+	}
+}
+
+TEST(SchemaTest, Underflow) {
+	OctetStream os;
+	os << MakeOrder();
+	std::string data = os.ToString();
+	// the first run of fixed fields is incomplete
+	OctetStream truncated(data.data(), 10);
+	Order order;
+	EXPECT_THROW(truncated >> order, std::length_error);
+	EXPECT_EQ(truncated.GetSize(), 10U);
+	OctetStream truncated2(data.data(), data.size() - 1);
+	EXPECT_THROW(truncated2 >> order, std::length_error);
+}
+
+TEST(SchemaTest, Containers) {
+	std::vector<Point> points;
+	for (int i = 0; i < 100; ++i) {
+		Point p = { i, -i };
+		points.push_back(p);
+	}
+	OctetStream os;
+	os << points;
+	EXPECT_EQ(os.GetSize(), sizeof(uint32_t) + 100 * 2 * sizeof(int32_t));
+	EXPECT_EQ(OctetStream::GetPackSize(points), os.GetSize());
+	std::vector<Point> decoded;
+	os >> decoded;
+	ASSERT_EQ(decoded.size(), 100U);
+	EXPECT_EQ(decoded[99].x, 99);
+	EXPECT_EQ(decoded[99].y, -99);
+}
+
+TEST(SchemaTest, SchemaSerialize) {
+	Tick tick;
+	tick.seq = 42;
+	tick.value = 1.5f;
+	OctetStream os1, os2;
+	os1 << tick;
+	// the virtual interface gives the same bytes
+	const ISerialize& base = tick;
+	os2 << base;
+	EXPECT_TRUE(os1.ToString() == os2.ToString());
+	EXPECT_EQ(base.GetPackSize(), sizeof(uint32_t) + sizeof(float));
+	Tick decoded;
+	ISerialize& target = decoded;
+	os2 >> target;
+	EXPECT_EQ(decoded.seq, 42U);
+	EXPECT_EQ(decoded.value, 1.5f);
+}
+#endif
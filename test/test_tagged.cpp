@@ -0,0 +1,201 @@
+#include <gtest/gtest.h>
+#include <zbase/tagged.h>
+#include <string>
+#include <vector>
+using namespace zbase;
+
+TEST(TaggedTest, WriterReader) {
+	OctetStream os;
+	{
+		tagged::Writer writer(os);
+		writer.Write(1, (int32_t)-5).Write(2, true).Write(3, 1.5).Write(4, 2.5f);
+		writer.Write(5, "text").Write(6, Octets(std::string(30, 'o')));
+		std::vector<int32_t> v(3, 7);
+		writer.Write(7, v);
+		writer.Write(1000, (uint64_t)1 << 40);
+	}
+	os << (uint32_t)0xDEADBEEF;
+	tagged::Reader reader(os);
+	int32_t i = 0;
+	bool b = false;
+	double d = 0;
+	std::string str;
+	uint64_t u = 0;
+	std::vector<int32_t> v;
+	while (reader.Next()) {
+		switch (reader.GetId()) {
+		case 1: reader.Read(i); break;
+		case 2: reader.Read(b); break;
+		case 3: reader.Read(d); break;
+		case 5: reader.Read(str); break;
+		case 7: reader.Read(v); break;
+		case 1000: reader.Read(u); break;
+		default: reader.Skip(); break;
+		}
+	}
+	EXPECT_EQ(i, -5);
+	EXPECT_TRUE(b);
+	EXPECT_EQ(d, 1.5);
+	EXPECT_EQ(str, "text");
+	EXPECT_EQ(v.size(), 3U);
+	EXPECT_EQ(u, (uint64_t)1 << 40);
+	// the message is consumed exactly
+	uint32_t tail = 0;
+	os >> tail;
+	EXPECT_EQ(tail, 0xDEADBEEF);
+}
+
+TEST(TaggedTest, WireTypeMismatch) {
+	OctetStream os;
+	{
+		tagged::Writer writer(os);
+		writer.Write(1, std::string("not an integer"));
+	}
+	tagged::Reader reader(os);
+	ASSERT_TRUE(reader.Next());
+	EXPECT_EQ(reader.GetType(), tagged::WIRE_BYTES);
+	int32_t i = 0;
+	EXPECT_THROW(reader.Read(i), std::invalid_argument);
+}
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+namespace
+{
+	struct PointV1
+	{
+		int32_t x;
+		int32_t y;
+	};
+	ZBASE_TAGGED_SCHEMA(PointV1, (1, x), (2, y))
+
+	struct QuoteV1
+	{
+		uint32_t id;
+		std::string symbol;
+		int32_t price;
+	};
+	ZBASE_TAGGED_SCHEMA(QuoteV1, (1, id), (2, symbol), (3, price))
+
+	// id 2 was removed, price became 64-bit, fields were added
+	struct QuoteV2
+	{
+		uint32_t id;
+		int64_t price;
+		double volume;
+		std::vector<std::string> venues;
+		PointV1 point;
+		Octets blob;
+		bool is_final;
+	};
+	ZBASE_TAGGED_SCHEMA(QuoteV2, (1, id), (3, price), (4, volume), (5, venues), (6, point), (7, blob), (8, is_final))
+
+	// consumer that only needs a few fields
+	struct QuoteDigest
+	{
+		uint32_t id;
+		bool is_final;
+	};
+	ZBASE_TAGGED_SCHEMA(QuoteDigest, (1, id), (8, is_final))
+
+	QuoteV2 MakeQuoteV2()
+	{
+		QuoteV2 q;
+		q.id = 77;
+		q.price = -((int64_t)1 << 40);
+		q.volume = 12.5;
+		q.venues.push_back("XNAS");
+		q.venues.push_back("XNYS");
+		q.point.x = 3;
+		q.point.y = -4;
+		q.blob = Octets(std::string(100, 'b'));
+		q.is_final = true;
+		return q;
+	}
+}
+
+TEST(TaggedTest, Schema) {
+	QuoteV2 q = MakeQuoteV2();
+	OctetStream os;
+	os << q;
+	EXPECT_EQ(tagged::GetPackSize(q), os.GetSize());
+	QuoteV2 decoded;
+	os >> decoded;
+	EXPECT_TRUE(os.IsEmpty());
+	EXPECT_EQ(decoded.id, q.id);
+	EXPECT_EQ(decoded.price, q.price);
+	EXPECT_EQ(decoded.volume, q.volume);
+	EXPECT_TRUE(decoded.venues == q.venues);
+	EXPECT_EQ(decoded.point.x, 3);
+	EXPECT_EQ(decoded.point.y, -4);
+	EXPECT_TRUE(decoded.blob == q.blob);
+	EXPECT_TRUE(decoded.is_final);
+}
+
+TEST(TaggedTest, SchemaEvolution) {
+	// new writer, old reader: unknown fields are skipped
+	OctetStream os;
+	os << MakeQuoteV2() << (int32_t)12345;
+	QuoteV1 v1 = { 0, "unchanged", 0 };
+	os >> v1;
+	EXPECT_EQ(v1.id, 77U);
+	EXPECT_EQ(v1.symbol, "unchanged");
+	// the 64-bit price does not fit, but is still decoded as a varint
+	int32_t tail = 0;
+	os >> tail;
+	EXPECT_EQ(tail, 12345);
+
+	// old writer, new reader: missing fields keep their values
+	QuoteV1 old = { 5, "OLD", -300 };
+	os << old;
+	QuoteV2 v2 = MakeQuoteV2();
+	os >> v2;
+	EXPECT_EQ(v2.id, 5U);
+	EXPECT_EQ(v2.price, -300);
+	EXPECT_EQ(v2.volume, 12.5);
+	EXPECT_TRUE(os.IsEmpty());
+
+	// partial decoding
+	os << MakeQuoteV2();
+	QuoteDigest digest = { 0, false };
+	os >> digest;
+	EXPECT_EQ(digest.id, 77U);
+	EXPECT_TRUE(digest.is_final);
+	EXPECT_TRUE(os.IsEmpty());
+}
+
+TEST(TaggedTest, Containers) {
+	std::vector<PointV1> points;
+	for (int i = 0; i < 10; ++i) {
+		PointV1 p = { i, i * i };
+		points.push_back(p);
+	}
+	OctetStream os;
+	os << points;
+	EXPECT_EQ(OctetStream::GetPackSize(points), os.GetSize());
+	std::vector<PointV1> decoded;
+	os >> decoded;
+	ASSERT_EQ(decoded.size(), 10U);
+	EXPECT_EQ(decoded[9].y, 81);
+}
+
+TEST(TaggedTest, Truncated) {
+	OctetStream os;
+	os << MakeQuoteV2();
+	std::string data = os.ToString();
+	for (size_t n = 0; n < data.size(); n += 7) {
+		OctetStream truncated(data.data(), n);
+		QuoteV2 q;
+		EXPECT_THROW(truncated >> q, std::length_error);
+	}
+	// a length beyond the message is malformed
+	OctetStream corrupted;
+	{
+		tagged::Writer writer(corrupted);
+		writer.Write(1, std::string(10, 's'));
+	}
+	corrupted << (uint32_t)0;
+	corrupted.OverwriteInteger<uint32_t>(5, 12);
+	QuoteV1 q;
+	EXPECT_THROW(corrupted >> q, std::invalid_argument);
+}
+#endif
@@ -0,0 +1,164 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Pluggable memory allocators of Octets and OctetStream buffers
+//
+#ifndef ZBASE__ALLOCATOR_H
+#define ZBASE__ALLOCATOR_H
+
+#include <cstddef>
+
+#include <zbase/config.h>
+
+namespace zbase
+{
+	struct AllocatorStats
+	{
+		size_t allocations;
+		size_t deallocations;
+		size_t reallocations;
+		size_t bytes_in_use;        // requested bytes not deallocated yet
+		size_t system_allocations;  // blocks obtained from malloc()
+	};
+
+	// Memory allocator interface. Octets and OctetStream take the current allocator of the
+	// calling thread when they allocate a buffer, and keep using it until the buffer is freed,
+	// so a buffer may be released by a thread other than the one that allocated it.
+	// Allocate() and Reallocate() throw std::bad_alloc on failure. Deallocate() and Reallocate()
+	// must be passed the size that the block was allocated (or last reallocated) with.
+	class Allocator
+	{
+	public:
+		Allocator();
+		virtual ~Allocator() {}
+
+		virtual void* Allocate(size_t size) = 0;
+		// Reallocate(NULL, 0, size) is equivalent to Allocate(size)
+		virtual void* Reallocate(void *ptr, size_t old_size, size_t new_size) = 0;
+		virtual void Deallocate(void *ptr, size_t size) = 0;
+
+		// Statistics are off by default: with several threads the counters are shared atomics.
+		void EnableStats(bool enable) { m_stats_enabled = enable; }
+		bool IsStatsEnabled() const { return m_stats_enabled; }
+		AllocatorStats GetStats() const { return m_stats; }
+		void ResetStats();
+
+		// process-wide allocator, malloc() based unless replaced at startup
+		static Allocator* GetDefault();
+		static void SetDefault(Allocator *allocator);
+		// allocator of the calling thread, the default one unless a ScopedAllocator is active
+		static Allocator* GetCurrent();
+
+	protected:
+		void CountAllocate(size_t size, bool from_system);
+		void CountReallocate(size_t old_size, size_t new_size, bool from_system);
+		void CountDeallocate(size_t size);
+
+	private:
+		friend class ScopedAllocator;
+		static Allocator *s_default;
+		static ZBASE_THREAD_LOCAL Allocator *s_current;
+
+		AllocatorStats m_stats;
+		bool m_stats_enabled;
+	};
+
+	// Thin wrapper of malloc()/realloc()/free()
+	class MallocAllocator : public Allocator
+	{
+	public:
+		static MallocAllocator* Instance();
+
+		virtual void* Allocate(size_t size);
+		virtual void* Reallocate(void *ptr, size_t old_size, size_t new_size);
+		virtual void Deallocate(void *ptr, size_t size);
+	};
+
+	// Size-class pool with a cache of free blocks per thread. Requests are rounded up to a power
+	// of two between MIN_BLOCK_SIZE and MAX_BLOCK_SIZE; a freed block goes to the cache of the
+	// freeing thread, which takes no lock. Larger requests are passed through to malloc().
+	// The cache of a thread is returned to the system when the thread exits.
+	class PoolAllocator : public Allocator
+	{
+	public:
+		static const size_t MIN_BLOCK_SIZE;
+		static const size_t MAX_BLOCK_SIZE;
+		static const size_t MAX_CACHED_BYTES;   // per size class and thread
+
+	public:
+		static PoolAllocator* Instance();
+
+		virtual void* Allocate(size_t size);
+		virtual void* Reallocate(void *ptr, size_t old_size, size_t new_size);
+		virtual void Deallocate(void *ptr, size_t size);
+
+		// return the free blocks cached by the calling thread to the system
+		void Trim();
+
+	private:
+		PoolAllocator() {}
+	};
+
+	// Bump allocator for the data of one request or one task: allocation takes a few
+	// instructions, Deallocate() only reclaims the latest block and Reset() frees everything
+	// at once. ATTENTION: not thread-safe, and no Octets or OctetStream buffer allocated from
+	// the arena may be used after Reset() or destruction.
+	class ArenaAllocator : public Allocator
+	{
+	public:
+		static const size_t DEFAULT_CHUNK_SIZE;
+
+	public:
+		explicit ArenaAllocator(size_t chunk_size = DEFAULT_CHUNK_SIZE);
+		virtual ~ArenaAllocator();
+
+		virtual void* Allocate(size_t size);
+		virtual void* Reallocate(void *ptr, size_t old_size, size_t new_size);
+		virtual void Deallocate(void *ptr, size_t size);
+
+		// free all blocks, keeping the first chunk for reuse
+		void Reset();
+		// total size of the chunks obtained from the system
+		size_t GetReservedSize() const { return m_reserved_size; }
+
+	private:
+		struct Chunk
+		{
+			Chunk *next;
+			size_t size;
+		};
+
+		static size_t Align(size_t size) { return (size + 15) & ~static_cast<size_t>(15); }
+		char* NewChunk(Chunk **list, size_t size);
+		void FreeChunks(Chunk *chunk);
+
+		// forbid copy
+		ArenaAllocator(const ArenaAllocator&);
+		ArenaAllocator& operator = (const ArenaAllocator&);
+
+	private:
+		size_t m_chunk_size;
+		size_t m_reserved_size;
+		Chunk *m_chunks;      // the newest chunk first
+		Chunk *m_large_chunks;
+		char *m_pos;          // free space of the newest chunk
+		char *m_end;
+		char *m_last;         // the latest block, NULL if it cannot be reclaimed
+	};
+
+	// Make an allocator the current one of the calling thread during the scope
+	class ScopedAllocator
+	{
+	public:
+		explicit ScopedAllocator(Allocator *allocator) : m_previous(Allocator::s_current) { Allocator::s_current = allocator; }
+		~ScopedAllocator() { Allocator::s_current = m_previous; }
+
+	private:
+		// forbid copy
+		ScopedAllocator(const ScopedAllocator&);
+		ScopedAllocator& operator = (const ScopedAllocator&);
+
+	private:
+		Allocator *m_previous;
+	};
+} // namespace zbase
+#endif // ZBASE__ALLOCATOR_H
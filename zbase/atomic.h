@@ -31,6 +31,16 @@ namespace zbase
 		template <typename T_Int> T_Int XorAndFetch(T_Int *ptr, T_Int value);
 
 		template <typename T_Int> T_Int CompareAndSwap(T_Int *ptr, T_Int old_value, T_Int new_value);
+
+		// Relaxed load and store: free of data races, but without any ordering guarantee.
+		// They compile to plain moves, so they are defined inline.
+#if defined __GNUC__
+		template <typename T_Int> inline T_Int Load(const T_Int *ptr) { return __atomic_load_n(ptr, __ATOMIC_RELAXED); }
+		template <typename T_Int> inline void Store(T_Int *ptr, T_Int value) { __atomic_store_n(ptr, value, __ATOMIC_RELAXED); }
+#else
+		template <typename T_Int> inline T_Int Load(const T_Int *ptr) { return *static_cast<const volatile T_Int*>(ptr); }
+		template <typename T_Int> inline void Store(T_Int *ptr, T_Int value) { *static_cast<volatile T_Int*>(ptr) = value; }
+#endif
 	} // namespace atomic
 } // namespace zbase
 #endif // ZBASE__ATOMIC_H
@@ -2,22 +2,140 @@
 //
 // Portable byte order detecting and converting utility
 //
+// Header-only: the host byte order is known at compile time, so the
+// conversions inline down to nothing or a single bswap instruction.
+//
 #ifndef ZBASE__BYTE_ORDER_H
 #define ZBASE__BYTE_ORDER_H
 
+#include <cstddef>
+#include <cstring>
+
+#include <zbase/config.h>
+#include <zbase/inttypes.h>
+
 namespace zbase
 {
 	namespace byteorder
 	{
-		extern const bool kIsHostLE;
+#ifdef ZBASE_LITTLE_ENDIAN
+		static const bool kIsHostLE = true;
+#else
+		static const bool kIsHostLE = false;
+#endif
+
+		namespace detail
+		{
+			// Unsigned integer type of the same width, only defined for integer types
+			template <typename T> struct UnsignedOf;
+			template <> struct UnsignedOf<short>              { typedef unsigned short type; };
+			template <> struct UnsignedOf<unsigned short>     { typedef unsigned short type; };
+			template <> struct UnsignedOf<int>                { typedef unsigned int type; };
+			template <> struct UnsignedOf<unsigned int>       { typedef unsigned int type; };
+			template <> struct UnsignedOf<long>               { typedef unsigned long type; };
+			template <> struct UnsignedOf<unsigned long>      { typedef unsigned long type; };
+			template <> struct UnsignedOf<long long>          { typedef unsigned long long type; };
+			template <> struct UnsignedOf<unsigned long long> { typedef unsigned long long type; };
+
+			ZBASE_CONSTEXPR uint16_t ByteSwap16(uint16_t x)
+			{
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 8))
+				return __builtin_bswap16(x);
+#else
+				return static_cast<uint16_t>((x << 8) | (x >> 8));
+#endif
+			}
+
+			ZBASE_CONSTEXPR uint32_t ByteSwap32(uint32_t x)
+			{
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+				return __builtin_bswap32(x);
+#else
+				return ((x & 0x000000FFU) << 24) | ((x & 0x0000FF00U) << 8) |
+				       ((x & 0x00FF0000U) >> 8)  | ((x & 0xFF000000U) >> 24);
+#endif
+			}
+
+			ZBASE_CONSTEXPR uint64_t ByteSwap64(uint64_t x)
+			{
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 3))
+				return __builtin_bswap64(x);
+#else
+				return (static_cast<uint64_t>(ByteSwap32(static_cast<uint32_t>(x))) << 32) |
+				       ByteSwap32(static_cast<uint32_t>(x >> 32));
+#endif
+			}
 
-		template <typename T> T ByteSwap(T value);
-		template <typename T> T HToLE(T value);
-		template <typename T> T HToBE(T value);
-		template <typename T> T LEToH(T value);
-		template <typename T> T BEToH(T value);
+			template <size_t N> struct ByteSwapImpl;
+			template <> struct ByteSwapImpl<2>
+			{
+				template <typename U> static ZBASE_CONSTEXPR U Swap(U x) { return static_cast<U>(ByteSwap16(static_cast<uint16_t>(x))); }
+			};
+			template <> struct ByteSwapImpl<4>
+			{
+				template <typename U> static ZBASE_CONSTEXPR U Swap(U x) { return static_cast<U>(ByteSwap32(static_cast<uint32_t>(x))); }
+			};
+			template <> struct ByteSwapImpl<8>
+			{
+				template <typename U> static ZBASE_CONSTEXPR U Swap(U x) { return static_cast<U>(ByteSwap64(static_cast<uint64_t>(x))); }
+			};
+		} // namespace detail
+
+		template <typename T> ZBASE_CONSTEXPR T ByteSwap(T value)
+		{
+			typedef typename detail::UnsignedOf<T>::type U;
+			return static_cast<T>(detail::ByteSwapImpl<sizeof(T)>::Swap(static_cast<U>(value)));
+		}
+
+		// Bulk byte swap of n elements from src to dst; src and dst may be the same array but must not
+		// overlap otherwise. Neither needs to be aligned. Vectorized with SSSE3/AVX2 when the CPU supports it.
+		void SwapArray16(void *dst, const void *src, size_t n);
+		void SwapArray32(void *dst, const void *src, size_t n);
+		void SwapArray64(void *dst, const void *src, size_t n);
+
+		namespace detail
+		{
+			template <size_t N> struct SwapArrayImpl;
+			template <> struct SwapArrayImpl<1> { static void Swap(void *dst, const void *src, size_t n) { if (dst != src) memmove(dst, src, n); } };
+			template <> struct SwapArrayImpl<2> { static void Swap(void *dst, const void *src, size_t n) { SwapArray16(dst, src, n); } };
+			template <> struct SwapArrayImpl<4> { static void Swap(void *dst, const void *src, size_t n) { SwapArray32(dst, src, n); } };
+			template <> struct SwapArrayImpl<8> { static void Swap(void *dst, const void *src, size_t n) { SwapArray64(dst, src, n); } };
+
+			template <typename T> inline void CopyArray(T *dst, const T *src, size_t n)
+			{
+				if (dst != src) {
+					memmove(dst, src, n * sizeof(T));
+				}
+			}
+		} // namespace detail
+
+		// Element types are integers, float or double
+		template <typename T> inline void SwapArray(T *dst, const T *src, size_t n) { detail::SwapArrayImpl<sizeof(T)>::Swap(dst, src, n); }
+
+#ifdef ZBASE_LITTLE_ENDIAN
+		template <typename T> inline void HToLEArray(T *dst, const T *src, size_t n) { detail::CopyArray(dst, src, n); }
+		template <typename T> inline void HToBEArray(T *dst, const T *src, size_t n) { SwapArray(dst, src, n); }
+		template <typename T> inline void LEToHArray(T *dst, const T *src, size_t n) { detail::CopyArray(dst, src, n); }
+		template <typename T> inline void BEToHArray(T *dst, const T *src, size_t n) { SwapArray(dst, src, n); }
+#else
+		template <typename T> inline void HToLEArray(T *dst, const T *src, size_t n) { SwapArray(dst, src, n); }
+		template <typename T> inline void HToBEArray(T *dst, const T *src, size_t n) { detail::CopyArray(dst, src, n); }
+		template <typename T> inline void LEToHArray(T *dst, const T *src, size_t n) { SwapArray(dst, src, n); }
+		template <typename T> inline void BEToHArray(T *dst, const T *src, size_t n) { detail::CopyArray(dst, src, n); }
+#endif
+
+#ifdef ZBASE_LITTLE_ENDIAN
+		template <typename T> ZBASE_CONSTEXPR T HToLE(T value) { return value; }
+		template <typename T> ZBASE_CONSTEXPR T HToBE(T value) { return ByteSwap(value); }
+		template <typename T> ZBASE_CONSTEXPR T LEToH(T value) { return value; }
+		template <typename T> ZBASE_CONSTEXPR T BEToH(T value) { return ByteSwap(value); }
+#else
+		template <typename T> ZBASE_CONSTEXPR T HToLE(T value) { return ByteSwap(value); }
+		template <typename T> ZBASE_CONSTEXPR T HToBE(T value) { return value; }
+		template <typename T> ZBASE_CONSTEXPR T LEToH(T value) { return ByteSwap(value); }
+		template <typename T> ZBASE_CONSTEXPR T BEToH(T value) { return value; }
+#endif
 	}
 }
 
 #endif
-
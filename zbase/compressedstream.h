@@ -0,0 +1,152 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Block compression of serialized messages
+//
+#ifndef ZBASE__COMPRESSEDSTREAM_H
+#define ZBASE__COMPRESSEDSTREAM_H
+
+#include <cstddef>
+#include <stdexcept>
+
+#include <zbase/config.h>
+#include <zbase/inttypes.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+
+namespace zbase
+{
+	//
+	// A compressed message is a sequence of blocks, each of which is an 8-byte header followed
+	// by a payload compressed with lz4::Compress(), or stored as is if that does not save space:
+	//   uint32 flags and payload size: bits 0-29 payload size, bit 30 stored, bit 31 end of message
+	//   uint32 uncompressed size
+	// Both are little-endian. Blocks are independent, so a message is compressed and
+	// decompressed one block at a time.
+	//
+	struct CompressedBlock
+	{
+		static const size_t HEADER_SIZE = 8;
+		static const uint32_t SIZE_MASK = 0x3FFFFFFF;
+		static const uint32_t FLAG_STORED = 0x40000000;
+		static const uint32_t FLAG_END = 0x80000000;
+	};
+
+	// Serializes values into a pending block like an OctetStream and appends each full block,
+	// compressed, to the output stream. Memory use is bounded by the block size, plus the size of
+	// the largest single value inserted, whatever the size of the message.
+	//
+	//   CompressedWriter writer(&output);
+	//   writer << header << entries;
+	//   writer.End();
+	class CompressedWriter
+	{
+	public:
+		static const size_t DEFAULT_BLOCK_SIZE;
+		static const size_t MAX_BLOCK_SIZE;
+
+	public:
+		explicit CompressedWriter(OctetStream *output, size_t block_size = DEFAULT_BLOCK_SIZE);
+		// ends the message if it has not been ended
+		~CompressedWriter();
+
+		// member accessors
+		size_t GetBlockSize() const { return m_block_size; }
+		void SetIntegerEncoding(OctetStream::IntegerEncoding encoding) { m_block.SetIntegerEncoding(encoding); }
+		// totals over all messages: bytes inserted and bytes appended to the output, headers included
+		uint64_t GetRawSize() const { return m_raw_size; }
+		uint64_t GetCompressedSize() const { return m_compressed_size; }
+
+		// insertion
+		template <typename T> CompressedWriter& operator << (const T &value)
+		{
+			m_is_open = true;
+			m_block << value;
+			if (m_block.GetSize() >= m_block_size) {
+				FlushBlocks();
+			}
+			return *this;
+		}
+		// raw bytes; full blocks of large data are compressed in place, without buffering
+		CompressedWriter& Write(const void *data, size_t n);
+
+		// compress the pending bytes as the last block of the message
+		void End();
+
+	private:
+		void FlushBlocks();
+		void WriteBlock(const void *data, size_t n, bool is_end);
+
+		// forbid copy
+		CompressedWriter(const CompressedWriter&);
+		CompressedWriter& operator = (const CompressedWriter&);
+
+	private:
+		OctetStream *m_output;
+		OctetStream m_block;
+		size_t m_block_size;
+		uint64_t m_raw_size;
+		uint64_t m_compressed_size;
+		bool m_is_open;
+	}; // class CompressedWriter
+
+	// Incremental decoder of compressed messages. Received chunks of any size are accumulated
+	// and the blocks of a message are decompressed as soon as they are complete.
+	class CompressedReader
+	{
+	public:
+		static const size_t DEFAULT_MAX_MESSAGE_SIZE;
+
+	public:
+		explicit CompressedReader(size_t max_message_size = DEFAULT_MAX_MESSAGE_SIZE);
+
+		// member accessors
+		size_t GetMaxMessageSize() const { return m_max_message_size; }
+		size_t GetBufferedSize() const { return m_input.GetSize(); }
+		void SetIntegerEncoding(OctetStream::IntegerEncoding encoding) { m_integer_encoding = encoding; }
+
+		// append a received chunk
+		void Feed(const void *data, size_t n);
+		// receive directly into the reader: PrepareFeed() returns room for at least n bytes,
+		// CommitFeed() accounts for the bytes actually received there
+		void* PrepareFeed(size_t n);
+		void CommitFeed(size_t n) { m_input.CommitWrite(n); }
+
+		// Take the next complete message. The view refers to the internal buffer and is valid until
+		// the next NextMessage(), Decode() or Clear(). Returns false if the message is not complete
+		// yet, keeping the blocks decompressed so far. Throws std::length_error if the message
+		// exceeds the maximum size and std::invalid_argument if a block is corrupt; the reader
+		// must be cleared after either.
+		bool NextMessage(OctetsView &message) throw (std::length_error, std::invalid_argument);
+		// Decode the next complete message into value, see NextMessage() and FrameDecoder::Decode()
+		template <typename T> bool Decode(T &value);
+
+		void Clear();
+
+	private:
+		// forbid copy
+		CompressedReader(const CompressedReader&);
+		CompressedReader& operator = (const CompressedReader&);
+
+	private:
+		OctetStream m_input;
+		OctetStream m_output;
+		size_t m_message_size;  // size of the message last returned, at the front of m_output
+		size_t m_max_message_size;
+		OctetStream::IntegerEncoding m_integer_encoding;
+	}; // class CompressedReader
+
+	template <typename T>
+	bool CompressedReader::Decode(T &value)
+	{
+		OctetsView message;
+		if (!NextMessage(message)) {
+			return false;
+		}
+		OctetStream stream(message.GetData(), message.GetSize(), true);
+		stream.SetIntegerEncoding(m_integer_encoding);
+		stream >> value;
+		return true;
+	}
+
+} // namespace zbase
+#endif // ZBASE__COMPRESSEDSTREAM_H
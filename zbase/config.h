@@ -29,6 +29,19 @@
 #	define ZBASE_WORD_SIZE 32
 #endif
 
+// Byte order
+#if defined(ZBASE_LITTLE_ENDIAN) || defined(ZBASE_BIG_ENDIAN)
+	// specified externally
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_BIG_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+#	define ZBASE_BIG_ENDIAN
+#elif defined(__BYTE_ORDER__) && defined(__ORDER_LITTLE_ENDIAN__) && (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+#	define ZBASE_LITTLE_ENDIAN
+#elif defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64) || defined(_M_ARM) || defined(_WIN32)
+#	define ZBASE_LITTLE_ENDIAN
+#else
+#	error unknown byte order; define ZBASE_LITTLE_ENDIAN or ZBASE_BIG_ENDIAN
+#endif
+
 // SMP
 #ifndef ZBASE_ARCH_SMP
 //#	define ZBASE_ARCH_SMP
@@ -37,11 +50,29 @@
 // Thread-safe
 #define ZBASE_MULTITHREADS
 
+// Thread local storage of POD variables
+#if defined(_MSC_VER)
+#	define ZBASE_THREAD_LOCAL __declspec(thread)
+#else
+#	define ZBASE_THREAD_LOCAL __thread
+#endif
+
 // Support C99
 #define ZBASE_C99
 // Support C++11
 #define ZBASE_CPP11
 
+#if defined(ZBASE_CPP11) && __cplusplus >= 201103L
+#	define ZBASE_HAS_RVALUE_REFERENCES
+#	define ZBASE_HAS_STD_HASH
+#	define ZBASE_HAS_VARIADIC_TEMPLATES
+#	define ZBASE_HAS_UNORDERED_CONTAINERS
+#	define ZBASE_HAS_STD_ARRAY
+#	define ZBASE_CONSTEXPR constexpr
+#else
+#	define ZBASE_CONSTEXPR inline
+#endif
+
 #define ZBASE_HAS_OCTETSTREAM_H
 
 #endif // ZBASE__CONFIG_H
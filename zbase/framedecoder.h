@@ -0,0 +1,68 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Incremental decoder of length-prefixed frames for stream transports
+//
+#ifndef ZBASE__FRAMEDECODER_H
+#define ZBASE__FRAMEDECODER_H
+
+#include <stdexcept>
+
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+
+namespace zbase
+{
+	// A frame is a 32-bit little-endian length followed by that many payload bytes, i.e. what
+	// OctetStream::operator << (const OctetStream&) writes on an ENCODING_FIXED stream.
+	// Received chunks of any size are accumulated and complete frames are handed out without copying.
+	class FrameDecoder
+	{
+	public:
+		static const size_t DEFAULT_MAX_FRAME_SIZE;
+
+	public:
+		explicit FrameDecoder(size_t max_frame_size = DEFAULT_MAX_FRAME_SIZE);
+
+		// member accessors
+		size_t GetMaxFrameSize() const { return m_max_frame_size; }
+		size_t GetBufferedSize() const { return m_buffer.GetSize(); }
+
+		// append a received chunk
+		void Feed(const void *data, size_t n);
+		// receive directly into the decoder: PrepareFeed() returns room for at least n bytes,
+		// CommitFeed() accounts for the bytes actually received there
+		void* PrepareFeed(size_t n);
+		void CommitFeed(size_t n) { m_buffer.CommitWrite(n); }
+
+		// Take the next complete frame. The view refers to the internal buffer and is valid until
+		// the next Feed(), PrepareFeed(), Compact() or Clear(). Returns false, consuming nothing,
+		// if the frame is not complete yet; throws std::length_error if it exceeds the maximum size.
+		bool NextFrame(OctetsView &frame) throw (std::length_error);
+		// Decode the next complete frame into value. Returns false, consuming nothing, if the frame
+		// is not complete yet. A complete but malformed frame is consumed and the exception thrown
+		// by the extraction operator is propagated.
+		template <typename T> bool Decode(T &value);
+
+		// discard consumed bytes
+		void Compact() { m_buffer.Compact(); }
+		void Clear();
+
+	private:
+		OctetStream m_buffer;
+		size_t m_max_frame_size;
+	}; // class FrameDecoder
+
+	template <typename T>
+	bool FrameDecoder::Decode(T &value)
+	{
+		OctetsView frame;
+		if (!NextFrame(frame)) {
+			return false;
+		}
+		OctetStream stream(frame.GetData(), frame.GetSize(), true);
+		stream >> value;
+		return true;
+	}
+
+} // namespace zbase
+#endif // ZBASE__FRAMEDECODER_H
@@ -0,0 +1,31 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Fast non-cryptographic hashing of byte strings
+//
+#ifndef ZBASE__HASH_H
+#define ZBASE__HASH_H
+
+#include <cstddef>
+
+#include <zbase/config.h>
+#include <zbase/inttypes.h>
+
+namespace zbase
+{
+	namespace hash
+	{
+		// 64-bit hash of n bytes built on 64x64->128 bit multiply-and-fold mixing (wyhash family):
+		// inputs up to 16 bytes take two multiplications, longer ones are consumed 48 bytes per
+		// round in three independent lanes. The result does not depend on the host byte order.
+		// Not suitable against hash flooding unless the seed is secret.
+		uint64_t Hash64(const void *data, size_t n, uint64_t seed = 0);
+
+		// Hash64() folded to the width of size_t, e.g. for std::hash
+		inline size_t Hash(const void *data, size_t n)
+		{
+			uint64_t h = Hash64(data, n);
+			return static_cast<size_t>(sizeof(size_t) < sizeof(uint64_t) ? h ^ (h >> 32) : h);
+		}
+	} // namespace hash
+} // namespace zbase
+#endif // ZBASE__HASH_H
@@ -0,0 +1,35 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Hex encoding and decoding of byte strings
+//
+#ifndef ZBASE__HEX_H
+#define ZBASE__HEX_H
+
+#include <cstddef>
+#include <string>
+
+#include <zbase/config.h>
+
+namespace zbase
+{
+	namespace hex
+	{
+		// Invalid result of Decode()
+		static const size_t npos = static_cast<size_t>(-1);
+
+		// Encode n bytes into 2 * n upper case hex digits at dst, without a terminating '\0'
+		void Encode(char *dst, const void *src, size_t n);
+
+		// Size of the output of Format()
+		size_t GetFormattedSize(size_t n, size_t separator_size, size_t bytes_per_line);
+		// Hex dump with the separator between bytes of a line and a '\n' after every
+		// bytes_per_line bytes but the last ones; bytes_per_line 0 puts everything in one line.
+		std::string Format(const void *src, size_t n, const char *separator = " ", size_t bytes_per_line = 0);
+
+		// Decode hex digits of either case into dst, which must hold at least len / 2 bytes.
+		// Whitespace, ':' and '-' between bytes are skipped, so the output of Format() can be
+		// read back. Return the number of bytes decoded, or npos if the input is malformed.
+		size_t Decode(void *dst, const char *src, size_t len);
+	} // namespace hex
+} // namespace zbase
+#endif // ZBASE__HEX_H
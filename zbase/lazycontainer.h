@@ -0,0 +1,526 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Lazily decoded views of serialized STL containers
+//
+#ifndef ZBASE__LAZYCONTAINER_H
+#define ZBASE__LAZYCONTAINER_H
+
+#include <cstddef>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+#include <list>
+#include <deque>
+#include <set>
+#include <map>
+#include <string>
+#include <utility>
+
+#include <zbase/config.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+
+namespace zbase
+{
+	//
+	// Skipping of a serialized value without materializing it, mirroring its extraction operator.
+	// Types without a specialization are extracted into a temporary.
+	//
+	template <typename T>
+	struct SkipTraits
+	{
+		static void Skip(OctetStream &stream) { T value; stream >> value; }
+		// encoded size shared by every value of T in the encoding, 0 if it varies
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	namespace detail
+	{
+		inline void SkipBytes(OctetStream &stream, size_t n) throw (std::length_error)
+		{
+			if (stream.GetSize() < n) {
+				throw std::length_error("SkipTraits::Skip");
+			}
+			stream.Ignore(n);
+		}
+
+		// skip a container written by STLContainer1_Serializer, return the number of elements skipped
+		template <typename T>
+		uint32_t SkipElements(OctetStream &stream)
+		{
+			uint32_t count = stream.PeekLength();
+			if (0 == count) {
+				return 0;
+			}
+			stream.PopLength();
+			uint32_t i = 0;
+			for (; i < count && !stream.IsEmpty(); ++i) {
+				SkipTraits<T>::Skip(stream);
+			}
+			return i;
+		}
+	} // namespace detail
+
+#define ZBASE_SKIP_TRAITS_RAW(T, N) \
+	template <> struct SkipTraits<T> \
+	{ \
+		static void Skip(OctetStream &stream) { detail::SkipBytes(stream, N); } \
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return N; } \
+	};
+
+#define ZBASE_SKIP_TRAITS_INTEGER(T) \
+	template <> struct SkipTraits<T> \
+	{ \
+		static void Skip(OctetStream &stream) { stream.PopEncodedInteger<T>(); } \
+		static size_t GetFixedSize(OctetStream::IntegerEncoding encoding) { return OctetStream::ENCODING_FIXED == encoding ? sizeof(T) : 0; } \
+	};
+
+#define ZBASE_SKIP_TRAITS_BYTES(T) \
+	template <> struct SkipTraits<T> \
+	{ \
+		static void Skip(OctetStream &stream) { detail::SkipBytes(stream, stream.PopLength()); } \
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; } \
+	};
+
+	ZBASE_SKIP_TRAITS_RAW(bool, sizeof(char))
+	ZBASE_SKIP_TRAITS_RAW(int8_t, sizeof(int8_t))
+	ZBASE_SKIP_TRAITS_RAW(uint8_t, sizeof(uint8_t))
+	ZBASE_SKIP_TRAITS_RAW(float, sizeof(float))
+	ZBASE_SKIP_TRAITS_RAW(double, sizeof(double))
+	ZBASE_SKIP_TRAITS_RAW(long double, sizeof(long double))
+	ZBASE_SKIP_TRAITS_INTEGER(int16_t)
+	ZBASE_SKIP_TRAITS_INTEGER(uint16_t)
+	ZBASE_SKIP_TRAITS_INTEGER(int32_t)
+	ZBASE_SKIP_TRAITS_INTEGER(uint32_t)
+	ZBASE_SKIP_TRAITS_INTEGER(int64_t)
+	ZBASE_SKIP_TRAITS_INTEGER(uint64_t)
+	ZBASE_SKIP_TRAITS_BYTES(std::string)
+	ZBASE_SKIP_TRAITS_BYTES(Octets)
+	ZBASE_SKIP_TRAITS_BYTES(OctetsView)
+	ZBASE_SKIP_TRAITS_BYTES(OctetStream)
+#undef ZBASE_SKIP_TRAITS_RAW
+#undef ZBASE_SKIP_TRAITS_INTEGER
+#undef ZBASE_SKIP_TRAITS_BYTES
+
+	template <typename T1, typename T2>
+	struct SkipTraits<std::pair<T1, T2> >
+	{
+		static void Skip(OctetStream &stream)
+		{
+			SkipTraits<T1>::Skip(stream);
+			SkipTraits<T2>::Skip(stream);
+		}
+		static size_t GetFixedSize(OctetStream::IntegerEncoding encoding)
+		{
+			size_t first = SkipTraits<T1>::GetFixedSize(encoding);
+			size_t second = SkipTraits<T2>::GetFixedSize(encoding);
+			return first > 0 && second > 0 ? first + second : 0;
+		}
+	};
+
+	template <typename T>
+	struct SkipTraits<std::vector<T> >
+	{
+		static void Skip(OctetStream &stream)
+		{
+			// bulk-copied vectors, see OctetStream::PopVector()
+			size_t size = PackTraits<T>::kMode == PACK_ELEMENTWISE ? 0 : SkipTraits<T>::GetFixedSize(stream.GetIntegerEncoding());
+			if (0 == size) {
+				detail::SkipElements<T>(stream);
+				return;
+			}
+			uint32_t count = stream.PeekLength();
+			if (count > 0) {
+				OctetStream::Transaction transaction(stream);
+				stream.PopLength();
+				detail::SkipBytes(stream, static_cast<size_t>(count) * size);
+				transaction.Commit();
+			}
+		}
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+#define ZBASE_SKIP_TRAITS_CONTAINER(C, E) \
+	template <typename T> struct SkipTraits<C<T> > \
+	{ \
+		static void Skip(OctetStream &stream) { detail::SkipElements<E>(stream); } \
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; } \
+	};
+
+	ZBASE_SKIP_TRAITS_CONTAINER(std::list, T)
+	ZBASE_SKIP_TRAITS_CONTAINER(std::deque, T)
+	ZBASE_SKIP_TRAITS_CONTAINER(std::set, T)
+	ZBASE_SKIP_TRAITS_CONTAINER(std::multiset, T)
+#undef ZBASE_SKIP_TRAITS_CONTAINER
+
+	template <typename KeyType, typename ValueType>
+	struct SkipTraits<std::map<KeyType, ValueType> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<std::pair<KeyType, ValueType> >(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename KeyType, typename ValueType>
+	struct SkipTraits<std::multimap<KeyType, ValueType> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<std::pair<KeyType, ValueType> >(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename T, size_t N>
+	struct SkipTraits<T[N]>
+	{
+		static void Skip(OctetStream &stream)
+		{
+			size_t size = GetFixedSize(stream.GetIntegerEncoding());
+			if (size > 0) {
+				detail::SkipBytes(stream, size);
+				return;
+			}
+			for (size_t i = 0; i < N; ++i) {
+				SkipTraits<T>::Skip(stream);
+			}
+		}
+		static size_t GetFixedSize(OctetStream::IntegerEncoding encoding) { return N * SkipTraits<T>::GetFixedSize(encoding); }
+	};
+
+#ifdef ZBASE_HAS_STD_ARRAY
+	template <typename T, size_t N>
+	struct SkipTraits<std::array<T, N> > : public SkipTraits<T[N]> {};
+
+	// raw bytes whatever the integer encoding, see ArrayPackTraits
+	template <size_t N>
+	struct SkipTraits<std::array<char, N> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipBytes(stream, N); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return N; }
+	};
+#endif
+
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+	template <typename T, typename Hash, typename Pred>
+	struct SkipTraits<std::unordered_set<T, Hash, Pred> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<T>(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename T, typename Hash, typename Pred>
+	struct SkipTraits<std::unordered_multiset<T, Hash, Pred> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<T>(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename KeyType, typename ValueType, typename Hash, typename Pred>
+	struct SkipTraits<std::unordered_map<KeyType, ValueType, Hash, Pred> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<std::pair<KeyType, ValueType> >(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename KeyType, typename ValueType, typename Hash, typename Pred>
+	struct SkipTraits<std::unordered_multimap<KeyType, ValueType, Hash, Pred> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<std::pair<KeyType, ValueType> >(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+#endif
+
+	//
+	// View of a serialized vector, list, deque or set of T, ordered or not, which decodes elements on access.
+	// Extracting it from a stream only walks over the elements with SkipTraits, nothing is
+	// decoded or allocated. Iteration decodes one element at a time; random access with At()
+	// builds an index of element offsets on first use, unless the elements have a fixed size.
+	//
+	//   LazyContainer<std::string> names;
+	//   stream >> names;
+	//   std::string last = names.At(names.GetCount() - 1);
+	//
+	// Like OctetsView, the view points into the buffer of the stream it was extracted from,
+	// which must outlive it unmodified. Const member functions may build the index, so a view
+	// shared by several threads must have BuildIndex() called first.
+	// Unlike the container extraction operators, a stream which ends before the element count
+	// throws std::length_error and is left unchanged.
+	//
+	template <typename T>
+	class LazyContainer : public ISerialize
+	{
+	public:
+		typedef T value_type;
+
+		class const_iterator
+		{
+		public:
+			typedef std::forward_iterator_tag iterator_category;
+			typedef T value_type;
+			typedef std::ptrdiff_t difference_type;
+			typedef const T* pointer;
+			typedef const T& reference;
+
+			const_iterator() : m_owner(NULL), m_index(0), m_offset(0), m_next(0), m_is_decoded(false) {}
+
+			reference operator * () const
+			{
+				if (!m_is_decoded) {
+					m_value = T();
+					m_next = m_owner->DecodeAt(m_offset, m_value);
+					m_is_decoded = true;
+				}
+				return m_value;
+			}
+			pointer operator -> () const { return &**this; }
+
+			const_iterator& operator ++ ()
+			{
+				m_offset = m_is_decoded ? m_next : m_owner->SkipAt(m_offset);
+				m_is_decoded = false;
+				++m_index;
+				return *this;
+			}
+			const_iterator operator ++ (int)
+			{
+				const_iterator tmp(*this);
+				++*this;
+				return tmp;
+			}
+
+			bool operator == (const const_iterator& rhs) const { return m_index == rhs.m_index; }
+			bool operator != (const const_iterator& rhs) const { return m_index != rhs.m_index; }
+
+		private:
+			friend class LazyContainer;
+			const_iterator(const LazyContainer *owner, size_t index, size_t offset)
+				: m_owner(owner), m_index(index), m_offset(offset), m_next(0), m_is_decoded(false) {}
+
+		private:
+			const LazyContainer *m_owner;
+			size_t m_index;
+			size_t m_offset;
+			mutable size_t m_next;
+			mutable T m_value;
+			mutable bool m_is_decoded;
+		};
+
+	public:
+		LazyContainer() : m_data(NULL), m_size(0), m_count(0), m_fixed_size(0), m_encoding(OctetStream::ENCODING_FIXED) {}
+
+		size_t GetCount() const { return m_count; }
+		bool IsEmpty() const { return 0 == m_count; }
+		// encoded elements, without the count prefix
+		OctetsView GetBytes() const { return OctetsView(m_data, m_size); }
+
+		const_iterator begin() const { return const_iterator(this, 0, 0); }
+		const_iterator end() const { return const_iterator(this, m_count, m_size); }
+
+		// decode the element at index
+		T At(size_t index) const throw (std::out_of_range)
+		{
+			T value;
+			DecodeAt(GetOffset(index), value);
+			return value;
+		}
+
+		// decode all elements into a container
+		template <typename Container> void CopyTo(Container &container) const
+		{
+			for (const_iterator it = begin(); it != end(); ++it) {
+				container.insert(container.end(), *it);
+			}
+		}
+
+		// build the offset index now rather than on the first random access
+		void BuildIndex() const
+		{
+			if (m_fixed_size > 0 || m_offsets.size() == m_count) {
+				return;
+			}
+			std::vector<uint32_t> offsets;
+			offsets.reserve(m_count);
+			OctetStream stream(m_data, m_size, true);
+			stream.SetIntegerEncoding(m_encoding);
+			for (size_t i = 0; i < m_count; ++i) {
+				offsets.push_back(static_cast<uint32_t>(m_size - stream.GetSize()));
+				SkipTraits<T>::Skip(stream);
+			}
+			m_offsets.swap(offsets);
+		}
+
+		// elements are written back as they were read if the stream has the same integer encoding
+		virtual OctetStream* Serialize(OctetStream *stream) const
+		{
+			if (m_count > 0) {
+				stream->PushLength(m_count);
+				if (stream->GetIntegerEncoding() == m_encoding) {
+					stream->Write(m_data, m_size);
+				} else {
+					for (const_iterator it = begin(); it != end(); ++it) {
+						*stream << *it;
+					}
+				}
+			}
+			return stream;
+		}
+
+		virtual OctetStream* Deserialize(OctetStream *stream)
+		{
+			OctetStream::IntegerEncoding encoding = stream->GetIntegerEncoding();
+			size_t fixed_size = SkipTraits<T>::GetFixedSize(encoding);
+			uint32_t count = stream->PeekLength();
+			const OctetStream::byte_t *data = NULL;
+			size_t size = 0;
+			if (count > 0) {
+				OctetStream::Transaction transaction(*stream);
+				stream->PopLength();
+				data = static_cast<const OctetStream::byte_t*>(stream->GetData());
+				if (fixed_size > 0) {
+					detail::SkipBytes(*stream, static_cast<size_t>(count) * fixed_size);
+				} else {
+					for (uint32_t i = 0; i < count; ++i) {
+						if (stream->IsEmpty()) {
+							throw std::length_error("LazyContainer::Deserialize");
+						}
+						SkipTraits<T>::Skip(*stream);
+					}
+				}
+				size = static_cast<const OctetStream::byte_t*>(stream->GetData()) - data;
+				transaction.Commit();
+			}
+			m_data = data;
+			m_size = size;
+			m_count = count;
+			m_fixed_size = fixed_size;
+			m_encoding = encoding;
+			m_offsets.clear();
+			return stream;
+		}
+
+		virtual size_t GetPackSize() const
+		{
+			if (OctetStream::ENCODING_FIXED != m_encoding) {
+				return ISerialize::GetPackSize();
+			}
+			return m_count > 0 ? sizeof(uint32_t) + m_size : 0;
+		}
+
+	protected:
+		size_t GetOffset(size_t index) const throw (std::out_of_range)
+		{
+			if (index >= m_count) {
+				throw std::out_of_range("LazyContainer::GetOffset");
+			}
+			if (m_fixed_size > 0) {
+				return index * m_fixed_size;
+			}
+			BuildIndex();
+			return m_offsets[index];
+		}
+
+		// decode the element at offset into value, return the offset of the next element
+		template <typename U> size_t DecodeAt(size_t offset, U &value) const
+		{
+			OctetStream stream(m_data + offset, m_size - offset, true);
+			stream.SetIntegerEncoding(m_encoding);
+			stream >> value;
+			return m_size - stream.GetSize();
+		}
+
+		size_t SkipAt(size_t offset) const
+		{
+			if (m_fixed_size > 0) {
+				return offset + m_fixed_size;
+			}
+			OctetStream stream(m_data + offset, m_size - offset, true);
+			stream.SetIntegerEncoding(m_encoding);
+			SkipTraits<T>::Skip(stream);
+			return m_size - stream.GetSize();
+		}
+
+	private:
+		const OctetStream::byte_t *m_data;
+		size_t m_size;
+		size_t m_count;
+		size_t m_fixed_size;
+		OctetStream::IntegerEncoding m_encoding;
+		mutable std::vector<uint32_t> m_offsets;
+	};
+
+	//
+	// View of a serialized std::map or std::multimap with lookup by key. The entries of a map
+	// are serialized in ascending key order, so Find() binary searches the offset index and
+	// decodes only O(log n) keys and the value found. Unordered maps and maps with a comparator
+	// other than std::less<KeyType> must be walked with iterators instead.
+	//
+	//   LazyMap<uint32_t, std::vector<std::string> > index;
+	//   stream >> index;
+	//   std::vector<std::string> names;
+	//   if (index.Find(42, names)) { ... }
+	//
+	template <typename KeyType, typename ValueType>
+	class LazyMap : public LazyContainer<std::pair<KeyType, ValueType> >
+	{
+	public:
+		bool Contains(const KeyType &key) const
+		{
+			size_t index = LowerBound(key);
+			return index < this->GetCount() && !(key < GetKey(index));
+		}
+
+		// decode the value of the first entry with the key, false if there is none
+		bool Find(const KeyType &key, ValueType &value) const
+		{
+			size_t index = LowerBound(key);
+			if (index == this->GetCount()) {
+				return false;
+			}
+			KeyType found;
+			size_t offset = this->DecodeAt(this->GetOffset(index), found);
+			if (key < found) {
+				return false;
+			}
+			// extraction appends to containers and strings
+			value = ValueType();
+			this->DecodeAt(offset, value);
+			return true;
+		}
+
+	private:
+		KeyType GetKey(size_t index) const
+		{
+			KeyType key;
+			this->DecodeAt(this->GetOffset(index), key);
+			return key;
+		}
+
+		size_t LowerBound(const KeyType &key) const
+		{
+			size_t first = 0;
+			size_t count = this->GetCount();
+			while (count > 0) {
+				size_t step = count / 2;
+				if (GetKey(first + step) < key) {
+					first += step + 1;
+					count -= step + 1;
+				} else {
+					count = step;
+				}
+			}
+			return first;
+		}
+	};
+
+	template <typename T>
+	struct SkipTraits<LazyContainer<T> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<T>(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+
+	template <typename KeyType, typename ValueType>
+	struct SkipTraits<LazyMap<KeyType, ValueType> >
+	{
+		static void Skip(OctetStream &stream) { detail::SkipElements<std::pair<KeyType, ValueType> >(stream); }
+		static size_t GetFixedSize(OctetStream::IntegerEncoding) { return 0; }
+	};
+} // namespace zbase
+#endif // ZBASE__LAZYCONTAINER_H
@@ -0,0 +1,34 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Fast LZ77 compression in the LZ4 block format
+//
+#ifndef ZBASE__LZ4_H
+#define ZBASE__LZ4_H
+
+#include <cstddef>
+
+#include <zbase/config.h>
+
+namespace zbase
+{
+	namespace lz4
+	{
+		// Invalid result of Decompress()
+		static const size_t npos = static_cast<size_t>(-1);
+
+		// Output capacity which Compress() never runs out of for n bytes of input
+		inline size_t GetMaxCompressedSize(size_t n) { return n + n / 255 + 16; }
+
+		// Compress n bytes, less than 4 GB, into a block of at most capacity bytes at dst.
+		// Matches are found greedily through a 4096-entry hash table of 4-byte sequences,
+		// and the scan speeds up over incompressible data. Return the compressed size, or 0
+		// if the block does not fit; the output can be read by any LZ4 block decoder.
+		size_t Compress(void *dst, size_t capacity, const void *src, size_t n);
+
+		// Decompress a block of n bytes into dst, which has room for capacity bytes. Every
+		// length and offset is checked, so corrupt or hostile input cannot write out of bounds.
+		// Return the decompressed size, or npos if the block is malformed or does not fit.
+		size_t Decompress(void *dst, size_t capacity, const void *src, size_t n);
+	} // namespace lz4
+} // namespace zbase
+#endif // ZBASE__LZ4_H
@@ -0,0 +1,73 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Segmented output stream for scatter/gather I/O
+//
+#ifndef ZBASE__OCTETCHAIN_H
+#define ZBASE__OCTETCHAIN_H
+
+#include <vector>
+
+#include <zbase/config.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+
+#ifndef ZBASE_WINDOWS
+#	include <sys/uio.h>
+#endif
+
+namespace zbase
+{
+	// Output with the same layout as an OctetStream, but Octets payloads at or above the
+	// reference threshold are not copied: the chain keeps a reference of their shared Rep
+	// and exports them as separate segments, e.g. as an iovec array for writev()/sendmsg().
+	// Everything else is encoded into an internal OctetStream.
+	class OctetChain
+	{
+	public:
+		static const size_t DEFAULT_REFERENCE_THRESHOLD;
+
+	public:
+		explicit OctetChain(size_t reference_threshold = DEFAULT_REFERENCE_THRESHOLD);
+
+		// member accessors
+		size_t GetReferenceThreshold() const { return m_reference_threshold; }
+		size_t GetSize() const { return m_stream.GetSize() + m_referenced_size; }
+		bool IsEmpty() const { return GetSize() == 0; }
+		size_t GetSegmentCount() const;
+
+		// insertion
+		OctetChain& operator << (const Octets& value);
+		template <typename T> OctetChain& operator << (const T& value) { m_stream << value; return *this; }
+
+		// member modifier
+		void Clear();
+
+		// conversions
+		void CopyTo(OctetStream *stream) const;
+#ifndef ZBASE_WINDOWS
+		// Fill at most n iovec entries and return the number used. The entries refer to the
+		// chain's memory and are valid until the chain is modified or destroyed.
+		size_t GetIovec(struct iovec *iov, size_t n) const;
+#endif
+
+	private:
+		// a range of the internal stream if data is empty, a referenced payload otherwise
+		struct Segment
+		{
+			size_t offset;
+			size_t size;
+			Octets data;
+		};
+
+		const char* GetSegmentData(const Segment &segment) const;
+
+	private:
+		OctetStream m_stream;
+		std::vector<Segment> m_segments;
+		size_t m_stream_flushed;    // end of the stream range covered by m_segments
+		size_t m_referenced_size;
+		size_t m_reference_threshold;
+	}; // class OctetChain
+
+} // namespace zbase
+#endif // ZBASE__OCTETCHAIN_H
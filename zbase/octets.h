@@ -12,15 +12,25 @@
 
 #include <zbase/config.h>
 #include <zbase/atomic.h>
+#include <zbase/allocator.h>
+#include <zbase/hash.h>
+
+#ifdef ZBASE_HAS_STD_HASH
+#	include <functional>
+#endif
 
 /**
  * @namespace zbase
  */
 namespace zbase
 {
+	class OctetsSlice;
+
 	/**
 	 * @class Octets
 	 * @brief Byte string container
+	 * @details Payloads up to SMALL_CAPACITY bytes are stored inline without any heap allocation
+	 *          or reference counting. Larger payloads are held by a shared copy-on-write Rep.
 	 */
 	class Octets
 	{
@@ -29,6 +39,10 @@ namespace zbase
 		 * @brief Invalid position
 		 */
 		static const size_t npos = static_cast<size_t>(-1);
+		/**
+		 * @brief Maximum size of the inline small buffer
+		 */
+		static const size_t SMALL_CAPACITY = 23;
 
 	private:
 		/**
@@ -39,56 +53,99 @@ namespace zbase
 		 *      This is how copy-on-write(COW) works.
 		 *   2. All method parameters must be checked outside before invoking any method
 		 *   3. Proxy design pattern is used to implement Copy-On-Write strategy. (Octets is a virtual proxy of Rep)
+		 *   4. The header and the data are co-located in a single allocation, the data follows the header.
+		 *      Reserve() may therefore move the Rep.
+		 *   5. The block comes from the current Allocator of the thread creating the Rep and is returned to it.
+		 *   6. A read-only Rep, e.g. one of MapFile(), is never modified in place even if it is not shared.
 		 */
 		class Rep
 		{
 		public:
 			/**
-			 * @brief Constructor
+			 * @brief Create a Rep holding a copy of data (uninitialized if data is NULL)
+			 */
+			static Rep* Create(const void* data, size_t size, size_t capacity);
+			/**
+			 * @brief Construct a Rep in a block of sizeof(Rep) + capacity bytes already holding the data
 			 */
-			Rep(const void* data, size_t size);
+			static Rep* Adopt(void* block, size_t size, size_t capacity, Allocator *allocator);
 			/**
-			 * @brief Clone
+			 * @brief Clone with at least the specified capacity
 			 */
-			Rep* Clone() { return new Rep(m_data, m_size); }
+			Rep* Clone(size_t capacity) const { return Create(GetData(), m_size, capacity); }
 
 			/**
 			 * @brief Get internal data buffer
 			 */
-			const void* GetData() const { return m_data; }
+			const void* GetData() const { return this + 1; }
 			/**
 			 * @brief Get internal data buffer
 			 */
-			void* GetData() { return m_data; }
+			void* GetData() { return this + 1; }
 			/**
 			 * @brief Get size of the internal data buffer
 			 */
 			size_t GetCapacity() const { return m_capacity; }
 			/**
 			 * @brief Set data size
+			 * @details Called after every in-place modification, which invalidates the cached hash
 			 */
-			void SetSize(size_t size) { m_size = size; }
+			void SetSize(size_t size) { m_size = size; m_hash = 0; }
 			/**
 			 * @brief Get data size
 			 */
 			size_t GetSize() const { return m_size; }
+			/**
+			 * @brief Get hash of the data, computed on first use
+			 * @details The cache is accessed atomically since a shared Rep may be hashed by several
+			 *          threads at once; concurrent first calls store the same value
+			 */
+			size_t GetHash() const
+			{
+				size_t h = atomic::Load(&m_hash);
+				if (0 == h) {
+					h = hash::Hash(GetData(), m_size);
+					atomic::Store(&m_hash, h);
+				}
+				return h;
+			}
 			/**
 			 * @brief Check if the object memory is leaked
 			 */
 			bool IsLeaked() const { return m_refno < 0; }
 			/**
 			 * @brief Check if this object is shared
+			 * @details The reference number may be changed by other threads meanwhile
+			 */
+			bool IsShared() const
+			{
+#ifdef ZBASE_MULTITHREADS
+				return atomic::Load(&m_refno) > 0;
+#else
+				return m_refno > 0;
+#endif
+			}
+			/**
+			 * @brief Mark the data as read-only
 			 */
-			bool IsShared() const { return m_refno > 0; }
+			void SetReadOnly() { m_readonly = true; }
 			/**
-			 * @brief Get string description in hex format
+			 * @brief Check if the data is read-only
 			 */
-			std::string Hex();
-
+			bool IsReadOnly() const { return m_readonly; }
+			/**
+			 * @brief Get the allocator the block was allocated from
+			 */
+			Allocator* GetAllocator() const { return m_allocator; }
+			/**
+			 * @brief Check if the data may be modified in place
+			 */
+			bool IsWritable() const { return m_refno == 0 && !m_readonly; }
 			/**
 			 * @brief Reserve the internal buffer to at least specified size
+			 * @return The Rep itself or its new location if it had to be moved. Only for writable Reps.
 			 */
-			void Reserve(size_t size);
+			Rep* Reserve(size_t size);
 			/**
 			 * @brief Increase reference number
 			 */
@@ -108,22 +165,31 @@ namespace zbase
 			{
 #ifdef ZBASE_MULTITHREADS
 				if (atomic::DecAndFetch(&m_refno) < 0) {
-					delete this;
+					Destroy();
 				}
 #else
 				if ((--m_refno) < 0) {
-					delete this;
+					Destroy();
 				}
 #endif
 			}
 
-		// forbid using destructor, copy constructor and assignment operator externally
+		// forbid using constructor, destructor, copy constructor and assignment operator externally
 		private:
+			/**
+			 * @brief Constructor
+			 * @details Forbid external use, see Create()
+			 */
+			Rep(size_t size, size_t capacity, Allocator *allocator) : m_capacity(capacity), m_size(size), m_refno(0), m_readonly(false), m_allocator(allocator), m_hash(0) {}
 			/**
 			 * @brief Destructor
-			 * @details Forbid external use
+			 * @details Forbid external use, see Release()
+			 */
+			~Rep() {}
+			/**
+			 * @brief Free the memory block of this Rep
 			 */
-			~Rep();
+			void Destroy();
 			/**
 			 * @brief Copy constructor
 			 * @details Forbid external use
@@ -136,10 +202,6 @@ namespace zbase
 			Rep& operator = (const Rep& rhs) { return *this; }
 
 		private:
-			/**
-			 * @brief Internal data buffer
-			 */
-			void  *m_data;
 			/**
 			 * @brief Size of the internal data buffer
 			 */
@@ -152,9 +214,32 @@ namespace zbase
 			 * @brief Reference number
 			 */
 			int    m_refno;
+			/**
+			 * @brief Whether the data is read-only
+			 */
+			bool   m_readonly;
+			/**
+			 * @brief Allocator of the memory block
+			 */
+			Allocator *m_allocator;
+			/**
+			 * @brief Cached hash of the data, 0 if not computed yet
+			 */
+			mutable size_t m_hash;
 		};
 
 	public:
+		/**
+		 * @brief Access pattern hints of MapFile(), which may be combined
+		 */
+		enum AccessHint
+		{
+			ACCESS_NORMAL     = 0,  ///< no hint
+			ACCESS_SEQUENTIAL = 1,  ///< read ahead aggressively and drop pages behind
+			ACCESS_RANDOM     = 2,  ///< no read ahead
+			ACCESS_WILLNEED   = 4   ///< start paging in the whole file right away
+		};
+
 		/**
 		 * @brief Constructor
 		 */
@@ -180,6 +265,47 @@ namespace zbase
 		 * @brief Assignment operator
 		 */
 		Octets& operator = (const Octets& rhs);
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+		/**
+		 * @brief Move constructor
+		 */
+		Octets(Octets&& other);
+		/**
+		 * @brief Move assignment operator
+		 */
+		Octets& operator = (Octets&& rhs);
+#endif
+
+		/**
+		 * @brief Size of the Rep header preceding the data in a buffer passed to AdoptBuffer()
+		 */
+		static size_t GetRepHeaderSize() { return sizeof(Rep); }
+		/**
+		 * @brief Take ownership of an allocated block without copying the data
+		 * @param [in] block: Memory block of GetRepHeaderSize() + capacity bytes, the data starts at GetRepHeaderSize()
+		 * @param [in] size: Data size
+		 * @param [in] capacity: Data capacity of the block
+		 * @param [in] allocator: Allocator of the block, the default one if NULL
+		 */
+		static Octets AdoptBuffer(void *block, size_t size, size_t capacity, Allocator *allocator = NULL);
+		/**
+		 * @brief Decode a string in hex format, e.g. the output of Hex()
+		 * @details Whitespace, ':' and '-' between bytes are ignored
+		 * @exception std::invalid_argument if hex is malformed
+		 */
+		static Octets FromHex(const std::string& hex);
+		/**
+		 * @brief Map a file into memory read-only, without copying it
+		 * @details Pages are read lazily on first access. The mapping is shared by copies and slices
+		 *          of the result and unmapped when the last of them is destroyed. Modifying the result
+		 *          copies the data first. Files up to SMALL_CAPACITY bytes are simply read.
+		 *          ATTENTION: Truncating the file while it is mapped makes accesses beyond the new end
+		 *          raise SIGBUS.
+		 * @param [in] path: File path
+		 * @param [in] hints: Combination of AccessHint values passed to madvise()
+		 * @exception std::runtime_error if the file cannot be opened or mapped
+		 */
+		static Octets MapFile(const std::string& path, int hints = ACCESS_SEQUENTIAL);
 
 		/**
 		 * @adddtogroup Member accessors
@@ -191,21 +317,50 @@ namespace zbase
 		 * @details ATTENTION: The following accessors are for readonly access. 
 		 *          External change through these accessors will violate reference count of Rep and is forbidden.
 		 */
-		const void* GetData() const { return NULL == m_rep ? NULL : m_rep->GetData(); } 
+		const void* GetData() const { return NULL != m_rep ? m_rep->GetData() : (m_small_size > 0 ? m_small : NULL); }
 		/**
 		 * @brief Get data size
 		 */
-		size_t GetSize() const { return NULL == m_rep ? 0 : m_rep->GetSize(); }
+		size_t GetSize() const { return NULL != m_rep ? m_rep->GetSize() : m_small_size; }
 		/**
 		 * @brief Check if it is empty
 		 */
-		bool IsEmpty() const { return NULL == m_rep || m_rep->GetSize() == 0; }
+		bool IsEmpty() const { return GetSize() == 0; }
+		/**
+		 * @brief Check if the data is stored in the inline small buffer
+		 */
+		bool IsSmall() const { return NULL == m_rep; }
+		/**
+		 * @brief Check if the data is shared with other Octets objects
+		 */
+		bool IsShared() const { return NULL != m_rep && m_rep->IsShared(); }
+		/**
+		 * @brief Check if the data is read-only, e.g. a file mapping, and will be copied on modification
+		 */
+		bool IsReadOnly() const { return NULL != m_rep && m_rep->IsReadOnly(); }
+		/**
+		 * @brief Check if this object shares the same Rep with another one, which implies equal data
+		 */
+		bool SharesDataWith(const Octets& rhs) const { return NULL != m_rep && m_rep == rhs.m_rep; }
 		/**
 		 * @brief Compare with another Octets object
 		 * @param [in] rhs: Another Octets object to compare
 		 * @return -1 for less; 0 for equal; 1 for greater
 		 */
 		int Compare(const Octets& rhs) const;
+		/**
+		 * @brief Get hash of the data
+		 * @details Equal data has equal hash, whether it is held by Octets, OctetsSlice or OctetsView.
+		 *          The hash of a large payload is cached in its Rep, which is immutable while shared.
+		 */
+		size_t Hash() const { return NULL != m_rep ? m_rep->GetHash() : hash::Hash(m_small, m_small_size); }
+		/**
+		 * @brief Get a slice sharing the data of this object
+		 * @param [in] pos: Offset of the first byte of the slice
+		 * @param [in] len: Slice length, clipped to the end of the data
+		 * @exception std::out_of_range if pos is greater than the data size
+		 */
+		OctetsSlice Slice(size_t pos = 0, size_t len = npos) const;
 
 		/** @} */
 
@@ -226,6 +381,12 @@ namespace zbase
 		 * @brief Append to the existing data
 		 */
 		Octets& Append(const Octets& o);
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+		/**
+		 * @brief Append to the existing data, taking over the data of o if this object is empty
+		 */
+		Octets& Append(Octets&& o);
+#endif
 		/**
 		 * @brief Swap data of two Octets ojbects
 		 */
@@ -236,8 +397,10 @@ namespace zbase
 		void Clear();
 		/**
 		 * @brief Get string description in hex format
+		 * @param [in] separator: Separator between bytes
+		 * @param [in] bytes_per_line: Number of bytes per line, 0 for a single line
 		 */
-		std::string Hex() { return NULL == m_rep ? "" : m_rep->Hex(); }
+		std::string Hex(const char *separator = " ", size_t bytes_per_line = 0) const;
 
 		/** @} */
 
@@ -246,33 +409,270 @@ namespace zbase
 		 * {@
 		 */
 		/** @brief Operator += */
-		Octets& operator += (const Octets& rhs) { return Append(rhs.GetData(), rhs.GetSize()); }
+		Octets& operator += (const Octets& rhs) { return Append(rhs); }
 		/** @brief Operator == */
-		bool operator == (const Octets& rhs) { return GetSize() == rhs.GetSize() && Compare(rhs) == 0; }
+		bool operator == (const Octets& rhs) const { return SharesDataWith(rhs) || (GetSize() == rhs.GetSize() && Compare(rhs) == 0); }
 		/** @brief Operator != */
-		bool operator != (const Octets& rhs) { return GetSize() != rhs.GetSize() || Compare(rhs) != 0; }
+		bool operator != (const Octets& rhs) const { return GetSize() != rhs.GetSize() || Compare(rhs) != 0; }
 		/** @brief Operator > */
-		bool operator > (const Octets& rhs) { return Compare(rhs) > 0; }
+		bool operator > (const Octets& rhs) const { return Compare(rhs) > 0; }
 		/** @brief Operator >= */
-		bool operator >= (const Octets& rhs) { return Compare(rhs) >= 0; }
+		bool operator >= (const Octets& rhs) const { return Compare(rhs) >= 0; }
 		/** @brief Operator < */
-		bool operator < (const Octets& rhs) { return Compare(rhs) < 0; }
+		bool operator < (const Octets& rhs) const { return Compare(rhs) < 0; }
 		/** @brief Operator <= */
-		bool operator <= (const Octets& rhs) { return Compare(rhs) <= 0; }
+		bool operator <= (const Octets& rhs) const { return Compare(rhs) <= 0; }
 
 		/** @} */
 
+	private:
+		friend class OctetsPool;
+
+		/**
+		 * @brief Constructor taking over a Rep
+		 */
+		explicit Octets(Rep *rep) : m_rep(rep), m_small_size(0) {}
+		/**
+		 * @brief Copy data into the inline small buffer, releasing the Rep if any
+		 */
+		void AssignSmall(const void *data, size_t size);
+
 	private:
 		/**
-		 * @brief Internal data holder
+		 * @brief Internal data holder of large payloads, NULL if the small buffer is used
 		 */
 		Rep *m_rep;
+		/**
+		 * @brief Data size in the small buffer, always 0 while m_rep is set
+		 */
+		unsigned char m_small_size;
+		/**
+		 * @brief Inline small buffer
+		 */
+		char m_small[SMALL_CAPACITY];
+	};
+
+	/**
+	 * @class OctetsSlice
+	 * @brief Reference counted sub-range of an Octets object
+	 * @details The slice keeps the underlying Rep alive, so any number of slices of one buffer
+	 *          cost no allocation. The data is copied only when a slice is modified.
+	 */
+	class OctetsSlice
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 */
+		OctetsSlice() : m_offset(0), m_size(0) {}
+		/**
+		 * @brief Constructor
+		 * @details Assume that the range has been checked against the size of base
+		 */
+		OctetsSlice(const Octets& base, size_t offset, size_t size) : m_base(base), m_offset(offset), m_size(size) {}
+		/**
+		 * @brief Constructor, refer to the whole data of base
+		 */
+		OctetsSlice(const Octets& base) : m_base(base), m_offset(0), m_size(base.GetSize()) {}
+
+		/**
+		 * @adddtogroup Member accessors
+		 * {@
+		 */
+
+		/**
+		 * @brief Get the data of the slice
+		 */
+		const void* GetData() const { return m_size > 0 ? static_cast<const char*>(m_base.GetData()) + m_offset : NULL; }
+		/**
+		 * @brief Get slice size
+		 */
+		size_t GetSize() const { return m_size; }
+		/**
+		 * @brief Check if it is empty
+		 */
+		bool IsEmpty() const { return 0 == m_size; }
+		/**
+		 * @brief Get the Octets object the slice refers to
+		 */
+		const Octets& GetBase() const { return m_base; }
+		/**
+		 * @brief Get offset of the slice in the base object
+		 */
+		size_t GetOffset() const { return m_offset; }
+		/**
+		 * @brief Get a sub-slice of this slice, sharing the same base object
+		 * @exception std::out_of_range if pos is greater than the slice size
+		 */
+		OctetsSlice Slice(size_t pos = 0, size_t len = Octets::npos) const;
+		/**
+		 * @brief Get the data as an Octets object, shared without copying if the slice covers the whole base
+		 */
+		Octets ToOctets() const;
+		/**
+		 * @brief Copy the data into a new std::string object
+		 */
+		std::string ToString() const { return 0 == m_size ? std::string() : std::string(static_cast<const char*>(GetData()), m_size); }
+		/**
+		 * @brief Compare with another slice
+		 * @return -1 for less; 0 for equal; 1 for greater
+		 */
+		int Compare(const OctetsSlice& rhs) const;
+		/**
+		 * @brief Get hash of the data, equal to the hash of an Octets object with the same data
+		 */
+		size_t Hash() const { return hash::Hash(GetData(), m_size); }
+		/**
+		 * @brief Get string description in hex format
+		 * @param [in] separator: Separator between bytes
+		 * @param [in] bytes_per_line: Number of bytes per line, 0 for a single line
+		 */
+		std::string Hex(const char *separator = " ", size_t bytes_per_line = 0) const;
+
+		/** @} */
+
+		/**
+		 * @addtogroup Member modifiers
+		 * {@
+		 */
+
+		/**
+		 * @brief Assign content, the slice detaches from the base object
+		 */
+		OctetsSlice& Assign(const void *data, size_t size);
+		/**
+		 * @brief Append to the existing data, the slice detaches from the base object unless it covers all of it
+		 */
+		OctetsSlice& Append(const void *data, size_t size);
+		/**
+		 * @brief Clear the slice to be empty, releasing the base object
+		 */
+		void Clear();
+
+		/** @} */
+
+		/**
+		 * @addtogroup Operators
+		 * {@
+		 */
+		/** @brief Operator == */
+		bool operator == (const OctetsSlice& rhs) const { return m_size == rhs.m_size && Compare(rhs) == 0; }
+		/** @brief Operator != */
+		bool operator != (const OctetsSlice& rhs) const { return !(*this == rhs); }
+		/** @brief Operator > */
+		bool operator > (const OctetsSlice& rhs) const { return Compare(rhs) > 0; }
+		/** @brief Operator >= */
+		bool operator >= (const OctetsSlice& rhs) const { return Compare(rhs) >= 0; }
+		/** @brief Operator < */
+		bool operator < (const OctetsSlice& rhs) const { return Compare(rhs) < 0; }
+		/** @brief Operator <= */
+		bool operator <= (const OctetsSlice& rhs) const { return Compare(rhs) <= 0; }
+
+		/** @} */
+
+	private:
+		/**
+		 * @brief Copy the slice data into an Octets object of its own unless it covers the whole base
+		 */
+		void Detach();
+
+	private:
+		/**
+		 * @brief Shared data holder
+		 */
+		Octets m_base;
+		/**
+		 * @brief Offset of the slice in m_base
+		 */
+		size_t m_offset;
+		/**
+		 * @brief Size of the slice
+		 */
+		size_t m_size;
+	};
+
+	/**
+	 * @class OctetsView
+	 * @brief Non-owning reference to a byte range
+	 * @details ATTENTION: The referenced memory is neither copied nor reference counted.
+	 *          It must stay valid and unmodified for the whole life period of the view.
+	 */
+	class OctetsView
+	{
+	public:
+		/**
+		 * @brief Constructor
+		 */
+		OctetsView() : m_data(NULL), m_size(0) {}
+		/**
+		 * @brief Constructor
+		 */
+		OctetsView(const void *data, size_t size) : m_data(data), m_size(size) {}
+		/**
+		 * @brief Constructor
+		 */
+		OctetsView(const Octets& o) : m_data(o.GetData()), m_size(o.GetSize()) {}
+		/**
+		 * @brief Constructor
+		 */
+		OctetsView(const OctetsSlice& s) : m_data(s.GetData()), m_size(s.GetSize()) {}
+
+		/**
+		 * @brief Get referenced data
+		 */
+		const void* GetData() const { return m_data; }
+		/**
+		 * @brief Get data size
+		 */
+		size_t GetSize() const { return m_size; }
+		/**
+		 * @brief Check if it is empty
+		 */
+		bool IsEmpty() const { return 0 == m_size; }
+		/**
+		 * @brief Copy the referenced data into a new Octets object
+		 */
+		Octets ToOctets() const { return 0 == m_size ? Octets() : Octets(m_data, m_size); }
+		/**
+		 * @brief Copy the referenced data into a new std::string object
+		 */
+		std::string ToString() const { return 0 == m_size ? std::string() : std::string(static_cast<const char*>(m_data), m_size); }
+		/**
+		 * @brief Compare with another view
+		 * @return -1 for less; 0 for equal; 1 for greater
+		 */
+		int Compare(const OctetsView& rhs) const;
+		/**
+		 * @brief Get hash of the data, equal to the hash of an Octets object with the same data
+		 */
+		size_t Hash() const { return hash::Hash(m_data, m_size); }
+
+		/** @brief Operator == */
+		bool operator == (const OctetsView& rhs) const { return m_size == rhs.m_size && Compare(rhs) == 0; }
+		/** @brief Operator != */
+		bool operator != (const OctetsView& rhs) const { return !(*this == rhs); }
+
+	private:
+		/**
+		 * @brief Referenced data
+		 */
+		const void *m_data;
+		/**
+		 * @brief Size of the referenced data
+		 */
+		size_t m_size;
 	};
 
 	/**
 	 * @brief Operator +
 	 */
 	Octets operator + (const Octets& a, const Octets& b);
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+	/**
+	 * @brief Operator +, appending to the temporary a
+	 */
+	Octets operator + (Octets&& a, const Octets& b);
+#endif
 
 	/**
 	 * @brief Output a Octets object to a ostringstream object
@@ -282,7 +682,39 @@ namespace zbase
 	 * @brief Output a Octets object to a ostream object
 	 */
 	std::ostream& operator << (std::ostream& oss, const Octets& data);
+	/**
+	 * @brief Output a OctetsSlice object to a ostream object
+	 */
+	std::ostream& operator << (std::ostream& oss, const OctetsSlice& data);
 
 } // namespace zbase
+
+#ifdef ZBASE_HAS_STD_HASH
+namespace std
+{
+	/**
+	 * @brief Hash of Octets for unordered containers
+	 */
+	template <> struct hash<zbase::Octets>
+	{
+		size_t operator () (const zbase::Octets& o) const { return o.Hash(); }
+	};
+	/**
+	 * @brief Hash of OctetsSlice for unordered containers
+	 */
+	template <> struct hash<zbase::OctetsSlice>
+	{
+		size_t operator () (const zbase::OctetsSlice& o) const { return o.Hash(); }
+	};
+	/**
+	 * @brief Hash of OctetsView for unordered containers
+	 */
+	template <> struct hash<zbase::OctetsView>
+	{
+		size_t operator () (const zbase::OctetsView& o) const { return o.Hash(); }
+	};
+} // namespace std
+#endif
+
 #endif // ZBASE__OCTETS_H
 
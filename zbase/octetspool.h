@@ -0,0 +1,68 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Interning pool of Octets
+//
+#ifndef ZBASE__OCTETSPOOL_H
+#define ZBASE__OCTETSPOOL_H
+
+#include <cstddef>
+
+#include <zbase/config.h>
+#include <zbase/octets.h>
+
+namespace zbase
+{
+	struct OctetsPoolStats
+	{
+		size_t entries;
+		size_t bytes_stored;    // payload bytes held by the pool
+		size_t lookups;
+		size_t hits;
+		size_t bytes_saved;     // estimated heap bytes not allocated thanks to hits
+	};
+
+	// Canonicalizes Octets by content: every interned value with the same data shares one Rep,
+	// so interned values compare equal by Octets::SharesDataWith() and copy without allocation.
+	// Small values are interned into a Rep too, which gives up the inline buffer in exchange
+	// for identity comparison. Interned values are always held in Reps of the default
+	// allocator, so arenas may be reset and file mappings unmapped while the pool lives on.
+	// The table is split into shards, each guarded by its own lock, so that many threads can
+	// intern concurrently.
+	class OctetsPool
+	{
+	public:
+		static const size_t DEFAULT_SHARD_COUNT;
+
+	public:
+		explicit OctetsPool(size_t shard_count = DEFAULT_SHARD_COUNT);
+		~OctetsPool();
+
+		// get the canonical value with the same data, inserting o if there is none yet
+		Octets Intern(const Octets& o);
+		Octets Intern(const void *data, size_t size);
+		// get the canonical value without inserting, return false if there is none
+		bool Find(const OctetsView& key, Octets *result) const;
+
+		// remove the values no longer referenced outside the pool, return the number removed
+		size_t Purge();
+		void Clear();
+
+		size_t GetSize() const;
+		OctetsPoolStats GetStats() const;
+
+	private:
+		struct Shard;
+
+		Shard& GetShard(size_t hash) const;
+		Octets Intern(const OctetsView& key, const Octets *o);
+
+		// forbid copy
+		OctetsPool(const OctetsPool&);
+		OctetsPool& operator = (const OctetsPool&);
+
+	private:
+		Shard *m_shards;
+		size_t m_shard_count;
+	};
+} // namespace zbase
+#endif // ZBASE__OCTETSPOOL_H
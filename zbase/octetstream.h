@@ -16,11 +16,22 @@
 #include <set>
 #include <map>
 #include <cstring>
+#include <algorithm>
+#include <utility>
 
 #include <zbase/inttypes.h>
+#include <zbase/allocator.h>
 #include <zbase/octets.h>
 #include <zbase/byteorder.h>
 
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+#	include <unordered_map>
+#	include <unordered_set>
+#endif
+#ifdef ZBASE_HAS_STD_ARRAY
+#	include <array>
+#endif
+
 namespace zbase
 {
 	class OctetStream;
@@ -30,29 +41,102 @@ namespace zbase
 	public:
 		virtual OctetStream* Serialize(OctetStream *stream) const = 0;
 		virtual OctetStream* Deserialize(OctetStream *stream) = 0;
+		// Exact serialized size in bytes. The default implementation serializes into a
+		// scratch stream; override it to avoid that cost.
+		virtual size_t GetPackSize() const;
+	};
+
+	//
+	// Wire layout of STL container elements
+	//   PACK_ELEMENTWISE: serialized one by one through the insertion/extraction operators
+	//   PACK_RAW:         the in-memory bytes are the wire bytes on every host
+	//   PACK_INTEGER:     little-endian integers, the in-memory bytes are the wire bytes on little-endian hosts
+	//
+	enum PackMode
+	{
+		PACK_ELEMENTWISE,
+		PACK_RAW,
+		PACK_INTEGER
 	};
 
+	template <int Mode> struct PackModeTag {};
+
+	template <typename T> struct PackTraits { static const PackMode kMode = PACK_ELEMENTWISE; };
+
+#define ZBASE_PACK_TRAITS(T, M) \
+	template <> struct PackTraits<T> { static const PackMode kMode = M; };
+
+	ZBASE_PACK_TRAITS(int8_t, PACK_RAW)
+	ZBASE_PACK_TRAITS(uint8_t, PACK_RAW)
+	ZBASE_PACK_TRAITS(int16_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(uint16_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(int32_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(uint32_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(int64_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(uint64_t, PACK_INTEGER)
+	ZBASE_PACK_TRAITS(float, PACK_RAW)
+	ZBASE_PACK_TRAITS(double, PACK_RAW)
+	ZBASE_PACK_TRAITS(long double, PACK_RAW)
+#undef ZBASE_PACK_TRAITS
+
+	// elements of fixed-size arrays, where std::array<char, N> is a byte buffer
+	template <typename T> struct ArrayPackTraits { static const PackMode kMode = PackTraits<T>::kMode; };
+	template <> struct ArrayPackTraits<char> { static const PackMode kMode = PACK_RAW; };
+	// Elements of built-in arrays. char arrays are left undefined, since a string literal would
+	// be written as raw bytes with its NUL and no length prefix: insert a std::string instead,
+	// or use Write() and Read() for byte buffers.
+	template <typename T> struct BuiltinArrayPackTraits : public ArrayPackTraits<T> {};
+	template <> struct BuiltinArrayPackTraits<char>;
+
 	class OctetStream
 	{
 	public:
 		typedef unsigned char byte_t;
 		static const size_t PAGE_SIZE;
+		static const size_t LARGE_PAGE_SIZE;
+
+		// Buffer growth strategy applied when a write runs out of capacity
+		enum GrowthPolicy
+		{
+			GROWTH_GEOMETRIC, // double the capacity; page-aligned once the buffer gets large (default)
+			GROWTH_PAGED,     // grow by PAGE_SIZE steps only
+			GROWTH_EXACT      // grow to exactly the required size, for callers which know the final size
+		};
+
+		// Wire encoding of 16/32/64-bit integers and length prefixes written by the operators
+		enum IntegerEncoding
+		{
+			ENCODING_FIXED,  // little-endian, full width (default)
+			ENCODING_VARINT  // LEB128 varint, zigzag for signed types
+		};
 
 	public:
 		// constructor and destructor
 		OctetStream();
 		OctetStream(const void *data, size_t n, bool is_attach = false);
-		OctetStream(Octets& data, bool is_attach = false);
+		// attaching to data keeps a reference to it, e.g. to a file mapped by Octets::MapFile()
+		OctetStream(const Octets& data, bool is_attach = false);
 		virtual ~OctetStream();
 
 		// copy constructor
 		OctetStream(const OctetStream& rhs);
 		// assignment operator
 		OctetStream& operator = (const OctetStream& rhs);
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+		// move constructor and move assignment operator
+		OctetStream(OctetStream&& rhs);
+		OctetStream& operator = (OctetStream&& rhs);
+#endif
 
 		// member accessors
 		bool IsAttachMode() const { return m_is_attach_mode; }
+		GrowthPolicy GetGrowthPolicy() const { return m_growth_policy; }
+		void SetGrowthPolicy(GrowthPolicy policy) { m_growth_policy = policy; }
+		IntegerEncoding GetIntegerEncoding() const { return m_integer_encoding; }
+		void SetIntegerEncoding(IntegerEncoding encoding) { m_integer_encoding = encoding; }
 		size_t GetCapacity() const { return m_capacity; }
+		// allocator of the owned buffer, NULL if none has been allocated
+		Allocator* GetAllocator() const { return m_is_attach_mode || NULL == m_buffer ? NULL : m_allocator; }
 		size_t GetSize() const { return m_write_pos - m_read_pos; }
 		bool IsEmpty() const { return GetSize() == 0; }
 		const void* GetData() const { return m_buffer + m_read_pos; }
@@ -62,16 +146,31 @@ namespace zbase
 		int GetWriteBufferSize() const { return m_capacity - m_write_pos; }
 
 		// conversions
-		operator Octets() { return Octets(m_buffer + m_read_pos, GetSize()); }
+		operator Octets() { return IsEmpty() ? Octets() : Octets(m_buffer + m_read_pos, GetSize()); }
+		// move the unread data out into an Octets object, without copying unless it is small or attached
+		Octets TakeOctets();
 		std::string ToString() const { return std::string((char*)(m_buffer + m_read_pos), GetSize()); }
-		std::string Hex() const;
+		// hex dump with the separator between bytes and a line break every bytes_per_line bytes (0: single line)
+		std::string Hex(const char *separator = " ", size_t bytes_per_line = 0) const;
 
 		// member modifier
 		OctetStream& Attach(const void *data, size_t n);
+		// attach to the data of an Octets object, which is kept alive until detached
+		OctetStream& Attach(const Octets& data) throw (std::length_error);
 		void Swap(OctetStream& rhs);
 		void Reserve(size_t n);
-		void Shrink();
+		// capacity hint: make sure the next n bytes can be written without reallocation;
+		// the capacity is rounded up to PAGE_SIZE unless the growth policy is GROWTH_EXACT
+		void ReserveForWrite(size_t n) { Reserve(m_write_pos + n); }
+		// reduce the buffer to the larger of capacity and the end of the data
+		void Shrink(size_t capacity = 0);
 		void Clear();
+		// discard consumed bytes by moving the unread data to the front of the buffer
+		void Compact();
+		// direct write, e.g. recv() into the stream: PrepareWrite() returns room for at least n bytes,
+		// CommitWrite() appends the n bytes actually written there
+		void* PrepareWrite(size_t n) { if (static_cast<size_t>(m_capacity - m_write_pos) < n) Grow(m_write_pos + n); return m_buffer + m_write_pos; }
+		void CommitWrite(size_t n) { assert(static_cast<size_t>(m_capacity - m_write_pos) >= n); m_write_pos += n; }
 		OctetStream& Insert(size_t pos, const void *data, size_t n);
 		template<typename IntT> OctetStream& InsertInteger(size_t pos, IntT value)
 		{
@@ -80,13 +179,80 @@ namespace zbase
 			value = byteorder::HToLE(value);
 			return Insert(pos, &value, sizeof(value));
 		}
+		// overwrite n bytes at pos of the unread data, e.g. a length prefix reserved before the data was written
+		OctetStream& Overwrite(size_t pos, const void *data, size_t n) throw (std::out_of_range);
+		template<typename IntT> OctetStream& OverwriteInteger(size_t pos, IntT value) throw (std::out_of_range)
+		{
+			value = byteorder::HToLE(value);
+			return Overwrite(pos, &value, sizeof(value));
+		}
 		OctetStream& Write(const void *data, size_t n) { PushByte(data, n); return *this; }
 		OctetStream& Read(void *data, size_t n) { PopByte(data, n); return *this; }
+		// bulk read/write of n elements whose PackTraits mode is PACK_RAW or PACK_INTEGER
+		template <typename T> OctetStream& WriteArray(const T *data, size_t n)
+		{
+			PushArray(data, n, PackModeTag<PackTraits<T>::kMode>());
+			return *this;
+		}
+		template <typename T> OctetStream& ReadArray(T *data, size_t n)
+		{
+			PopArray(data, n, PackModeTag<PackTraits<T>::kMode>());
+			return *this;
+		}
 		OctetStream& Ignore(size_t n);
 		OctetStream& Unget(size_t n);
 
-		// get pack size
-		template<typename IntT> static size_t GetPackSize(IntT value) { return sizeof(value); }
+		//
+		// pack size: the exact number of bytes the matching insertion operator writes,
+		// so that a whole message can be reserved up front with ReserveForWrite()
+		// ATTENTION: sizes are for ENCODING_FIXED streams
+		//
+		static size_t GetPackSize(bool)             { return sizeof(char); }
+		static size_t GetPackSize(int8_t)           { return sizeof(int8_t); }
+		static size_t GetPackSize(uint8_t)          { return sizeof(uint8_t); }
+		static size_t GetPackSize(int16_t)          { return sizeof(int16_t); }
+		static size_t GetPackSize(uint16_t)         { return sizeof(uint16_t); }
+		static size_t GetPackSize(int32_t)          { return sizeof(int32_t); }
+		static size_t GetPackSize(uint32_t)         { return sizeof(uint32_t); }
+		static size_t GetPackSize(int64_t)          { return sizeof(int64_t); }
+		static size_t GetPackSize(uint64_t)         { return sizeof(uint64_t); }
+		static size_t GetPackSize(float)            { return sizeof(float); }
+		static size_t GetPackSize(double)           { return sizeof(double); }
+		static size_t GetPackSize(long double)      { return sizeof(long double); }
+		static size_t GetPackSize(const ISerialize &data) { return data.GetPackSize(); }
+		static size_t GetPackSize(const Octets& value)      { return sizeof(uint32_t) + value.GetSize(); }
+		static size_t GetPackSize(const OctetsView& value)  { return sizeof(uint32_t) + value.GetSize(); }
+		static size_t GetPackSize(const OctetsSlice& value) { return sizeof(uint32_t) + value.GetSize(); }
+		static size_t GetPackSize(const OctetStream& value) { return sizeof(uint32_t) + value.GetSize(); }
+		static size_t GetPackSize(const std::string& data)  { return sizeof(uint32_t) + data.size(); }
+		template <typename T> static size_t GetPackSize(const std::vector<T> &data);
+		template <typename T> static size_t GetPackSize(const std::list<T> &data);
+		template <typename T> static size_t GetPackSize(const std::deque<T> &data);
+		template <typename T> static size_t GetPackSize(const std::set<T> &data);
+		template <typename T> static size_t GetPackSize(const std::multiset<T> &data);
+		template <typename T1, typename T2> static size_t GetPackSize(const std::pair<T1, T2> &data);
+		template <typename KeyType, typename ValueType> static size_t GetPackSize(const std::map<KeyType, ValueType> &data);
+		template <typename KeyType, typename ValueType> static size_t GetPackSize(const std::multimap<KeyType, ValueType> &data);
+		template <typename T, size_t N> static size_t GetPackSize(const T (&data)[N]);
+#ifdef ZBASE_HAS_STD_ARRAY
+		template <typename T, size_t N> static size_t GetPackSize(const std::array<T, N> &data);
+#endif
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+		template <typename T, typename Hash, typename Pred> static size_t GetPackSize(const std::unordered_set<T, Hash, Pred> &data);
+		template <typename T, typename Hash, typename Pred> static size_t GetPackSize(const std::unordered_multiset<T, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> static size_t GetPackSize(const std::unordered_map<KeyType, ValueType, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> static size_t GetPackSize(const std::unordered_multimap<KeyType, ValueType, Hash, Pred> &data);
+#endif
+		template <typename IntT> static size_t GetVarintPackSize(IntT value)
+		{
+			uint64_t v = ZigZagEncode(value);
+			size_t n = 1;
+			while (v >= 0x80) {
+				v >>= 7;
+				++n;
+			}
+			return n;
+		}
 
 		template<typename IntT> IntT PeekInteger()
 		{
@@ -97,34 +263,195 @@ namespace zbase
 		template<typename IntT> IntT PopInteger() throw (std::length_error)
 		{
 			IntT value = 0;
-			PopByte(&value, sizeof(IntT));
-			return byteorder::LEToH(value);
+			if (!TryPopInteger(value)) {
+				throw std::length_error("OctetStream::PopInteger");
+			}
+			return value;
 		}
 		template<typename IntT> void PushInteger(IntT value)
 		{
 			assert(!m_is_attach_mode);
 
 			value = byteorder::HToLE(value);
-			PushByte(&value, sizeof(value));
+			if (static_cast<size_t>(m_capacity - m_write_pos) >= sizeof(value)) {
+				// inline fast path, no function call when the capacity is sufficient
+				memcpy(m_buffer + m_write_pos, &value, sizeof(value));
+				m_write_pos += sizeof(value);
+			} else {
+				PushByte(&value, sizeof(value));
+			}
 		}
 
+		//
+		// exception-free extraction: false and nothing consumed on underflow
+		//
+		bool TryRead(void *data, size_t n)
+		{
+			if (!PeekByte(data, n)) {
+				return false;
+			}
+			m_read_pos += n;
+			return true;
+		}
+		template<typename IntT> bool TryPopInteger(IntT &value)
+		{
+			if (static_cast<size_t>(m_write_pos - m_read_pos) < sizeof(IntT)) {
+				return false;
+			}
+			memcpy(&value, m_buffer + m_read_pos, sizeof(IntT));
+			m_read_pos += sizeof(IntT);
+			value = byteorder::LEToH(value);
+			return true;
+		}
+		template<typename IntT> bool TryPopVarint(IntT &value)
+		{
+			uint64_t v = 0;
+			size_t n = 0;
+			if (!DecodeVarint64(&v, &n)) {
+				return false;
+			}
+			m_read_pos += n;
+			value = ZigZagDecode<IntT>(v);
+			return true;
+		}
+
+		//
+		// Fixed-layout decoding with a single bounds check: the constructor claims n bytes
+		// from the stream if they are available, the reads inside the region are unchecked
+		// (debug assertions only).
+		//
+		//   OctetStream::CheckedRegion region(stream, 12);
+		//   if (!region.IsValid()) { ... }
+		//   uint32_t id = region.ReadInteger<uint32_t>();
+		//
+		class CheckedRegion
+		{
+		public:
+			CheckedRegion(OctetStream &stream, size_t n) : m_pos(NULL), m_end(NULL)
+			{
+				if (static_cast<size_t>(stream.m_write_pos - stream.m_read_pos) >= n) {
+					m_pos = stream.m_buffer + stream.m_read_pos;
+					m_end = m_pos + n;
+					stream.m_read_pos += n;
+				}
+			}
+
+			bool IsValid() const { return NULL != m_pos; }
+			size_t GetSize() const { return m_end - m_pos; }
+
+			void Read(void *data, size_t n)
+			{
+				assert(static_cast<size_t>(m_end - m_pos) >= n);
+				memcpy(data, m_pos, n);
+				m_pos += n;
+			}
+			template<typename IntT> IntT ReadInteger()
+			{
+				IntT value;
+				Read(&value, sizeof(value));
+				return byteorder::LEToH(value);
+			}
+			template<typename T> T ReadRaw()
+			{
+				T value;
+				Read(&value, sizeof(value));
+				return value;
+			}
+			void Skip(size_t n)
+			{
+				assert(static_cast<size_t>(m_end - m_pos) >= n);
+				m_pos += n;
+			}
+
+		private:
+			const byte_t *m_pos;
+			const byte_t *m_end;
+		};
+
+		//
+		// Transactional extraction: the read position is restored on destruction unless
+		// Commit() was called, so a decode interrupted by a short read can be retried later.
+		// Compact() must not be called while a transaction is active.
+		//
+		class Transaction
+		{
+		public:
+			explicit Transaction(OctetStream &stream) : m_stream(stream), m_read_pos(stream.m_read_pos), m_is_committed(false) {}
+			~Transaction() { if (!m_is_committed) Rollback(); }
+
+			void Commit() { m_is_committed = true; }
+			void Rollback() { m_stream.Unget(m_stream.m_read_pos - m_read_pos); }
+
+		private:
+			OctetStream &m_stream;
+			int m_read_pos;
+			bool m_is_committed;
+		};
+
+		// LEB128 varint of any integer type, zigzag encoded if the type is signed
+		template<typename IntT> void PushVarint(IntT value)
+		{
+			assert(!m_is_attach_mode);
+
+			uint64_t v = ZigZagEncode(value);
+			if (v < 0x80 && m_capacity > m_write_pos) {
+				m_buffer[m_write_pos++] = static_cast<byte_t>(v);
+			} else {
+				PushVarint64(v);
+			}
+		}
+		template<typename IntT> IntT PeekVarint()
+		{
+			uint64_t v = 0;
+			size_t n = 0;
+			DecodeVarint64(&v, &n);
+			return ZigZagDecode<IntT>(v);
+		}
+		template<typename IntT> IntT PopVarint() throw (std::length_error)
+		{
+			IntT value = 0;
+			if (!TryPopVarint(value)) {
+				throw std::length_error("OctetStream::PopVarint");
+			}
+			return value;
+		}
+
+		// integers and length prefixes in the encoding selected by SetIntegerEncoding()
+		template<typename IntT> void PushEncodedInteger(IntT value)
+		{
+			if (ENCODING_VARINT == m_integer_encoding) {
+				PushVarint(value);
+			} else {
+				PushInteger(value);
+			}
+		}
+		template<typename IntT> IntT PopEncodedInteger() throw (std::length_error)
+		{
+			return ENCODING_VARINT == m_integer_encoding ? PopVarint<IntT>() : PopInteger<IntT>();
+		}
+		void PushLength(uint32_t len) { PushEncodedInteger(len); }
+		uint32_t PeekLength() { return ENCODING_VARINT == m_integer_encoding ? PeekVarint<uint32_t>() : PeekInteger<uint32_t>(); }
+		uint32_t PopLength() throw (std::length_error) { return PopEncodedInteger<uint32_t>(); }
+
 		//
 		// insertion operator
 		//
 		OctetStream& operator << (bool value)             { char tmp = (value ? 1 : 0); PushByte(&tmp, sizeof(tmp)); return *this; }
 		OctetStream& operator << (int8_t value)           { PushByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator << (uint8_t value)          { PushByte(&value, sizeof(value)); return *this; }
-		OctetStream& operator << (int16_t value)          { PushInteger<int16_t>(value); return *this; }
-		OctetStream& operator << (uint16_t value)         { PushInteger<uint16_t>(value); return *this; }
-		OctetStream& operator << (int32_t value)          { PushInteger<int32_t>(value); return *this; }
-		OctetStream& operator << (uint32_t value)         { PushInteger<uint32_t>(value); return *this; }
-		OctetStream& operator << (int64_t value)          { PushInteger<int64_t>(value); return *this; }
-		OctetStream& operator << (uint64_t value)         { PushInteger<uint64_t>(value); return *this; }
+		OctetStream& operator << (int16_t value)          { PushEncodedInteger<int16_t>(value); return *this; }
+		OctetStream& operator << (uint16_t value)         { PushEncodedInteger<uint16_t>(value); return *this; }
+		OctetStream& operator << (int32_t value)          { PushEncodedInteger<int32_t>(value); return *this; }
+		OctetStream& operator << (uint32_t value)         { PushEncodedInteger<uint32_t>(value); return *this; }
+		OctetStream& operator << (int64_t value)          { PushEncodedInteger<int64_t>(value); return *this; }
+		OctetStream& operator << (uint64_t value)         { PushEncodedInteger<uint64_t>(value); return *this; }
 		OctetStream& operator << (float value)            { PushByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator << (double value)           { PushByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator << (long double value)      { PushByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator << (const ISerialize &data) { assert(!m_is_attach_mode); return *data.Serialize(const_cast<OctetStream*>(this)); }
 		OctetStream& operator << (const Octets& value);
+		OctetStream& operator << (const OctetsView& value);
+		OctetStream& operator << (const OctetsSlice& value) { return *this << OctetsView(value); }
 		OctetStream& operator << (const OctetStream& value);
 		OctetStream& operator << (const std::string& data);
 		template <typename T> OctetStream& operator << (const std::vector<T> &data);
@@ -136,6 +463,19 @@ namespace zbase
 		template <typename T1, typename T2> OctetStream& operator << (const std::pair<const T1, T2> &data);
 		template <typename KeyType, typename ValueType> OctetStream& operator << (const std::map<KeyType, ValueType> &data);
 		template <typename KeyType, typename ValueType> OctetStream& operator << (const std::multimap<KeyType, ValueType> &data);
+		// fixed-size arrays have no length prefix; std::array<char, N> is written as raw bytes, while
+		// built-in char arrays, string literals included, do not compile, see BuiltinArrayPackTraits
+		template <typename T, size_t N> OctetStream& operator << (const T (&data)[N]);
+#ifdef ZBASE_HAS_STD_ARRAY
+		template <typename T, size_t N> OctetStream& operator << (const std::array<T, N> &data);
+#endif
+		// unordered containers have the same wire layout as the ordered ones
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+		template <typename T, typename Hash, typename Pred> OctetStream& operator << (const std::unordered_set<T, Hash, Pred> &data);
+		template <typename T, typename Hash, typename Pred> OctetStream& operator << (const std::unordered_multiset<T, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> OctetStream& operator << (const std::unordered_map<KeyType, ValueType, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> OctetStream& operator << (const std::unordered_multimap<KeyType, ValueType, Hash, Pred> &data);
+#endif
 
 		//
 		// extraction operator
@@ -143,17 +483,19 @@ namespace zbase
 		OctetStream& operator >> (bool &value)        { char tmp; PopByte(&tmp, sizeof(tmp)); value = tmp ? true : false; return *this; }
 		OctetStream& operator >> (int8_t& value)      { PopByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator >> (uint8_t& value)     { PopByte(&value, sizeof(value)); return *this; }
-		OctetStream& operator >> (int16_t& value)     { value = PopInteger<int16_t>(); return *this; }
-		OctetStream& operator >> (uint16_t& value)    { value = PopInteger<uint16_t>(); return *this; }
-		OctetStream& operator >> (int32_t& value)     { value = PopInteger<int32_t>(); return *this; }
-		OctetStream& operator >> (uint32_t& value)    { value = PopInteger<uint32_t>(); return *this; }
-		OctetStream& operator >> (int64_t& value)     { value = PopInteger<int64_t>(); return *this; }
-		OctetStream& operator >> (uint64_t& value)    { value = PopInteger<uint64_t>(); return *this; }
+		OctetStream& operator >> (int16_t& value)     { value = PopEncodedInteger<int16_t>(); return *this; }
+		OctetStream& operator >> (uint16_t& value)    { value = PopEncodedInteger<uint16_t>(); return *this; }
+		OctetStream& operator >> (int32_t& value)     { value = PopEncodedInteger<int32_t>(); return *this; }
+		OctetStream& operator >> (uint32_t& value)    { value = PopEncodedInteger<uint32_t>(); return *this; }
+		OctetStream& operator >> (int64_t& value)     { value = PopEncodedInteger<int64_t>(); return *this; }
+		OctetStream& operator >> (uint64_t& value)    { value = PopEncodedInteger<uint64_t>(); return *this; }
 		OctetStream& operator >> (float& value)       { PopByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator >> (double& value)      { PopByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator >> (long double& value) { PopByte(&value, sizeof(value)); return *this; }
 		OctetStream& operator >> (ISerialize &data)   { return *data.Deserialize(this); }
 		OctetStream& operator >> (Octets& value);
+		// zero-copy: the view refers to the stream buffer and is valid until the buffer is released or reallocated
+		OctetStream& operator >> (OctetsView& value);
 		OctetStream& operator >> (OctetStream& value);
 		OctetStream& operator >> (std::string& data);
 		template <typename T> OctetStream& operator >> (std::vector<T> &data);
@@ -165,16 +507,93 @@ namespace zbase
 		template <typename T1, typename T2> OctetStream& operator >> (std::pair<const T1, T2> &data);
 		template <typename KeyType, typename ValueType> OctetStream& operator >> (std::map<KeyType, ValueType> &data);
 		template <typename KeyType, typename ValueType> OctetStream& operator >> (std::multimap<KeyType, ValueType> &data);
+		// the elements of an array are overwritten
+		template <typename T, size_t N> OctetStream& operator >> (T (&data)[N]);
+#ifdef ZBASE_HAS_STD_ARRAY
+		template <typename T, size_t N> OctetStream& operator >> (std::array<T, N> &data);
+#endif
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+		template <typename T, typename Hash, typename Pred> OctetStream& operator >> (std::unordered_set<T, Hash, Pred> &data);
+		template <typename T, typename Hash, typename Pred> OctetStream& operator >> (std::unordered_multiset<T, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> OctetStream& operator >> (std::unordered_map<KeyType, ValueType, Hash, Pred> &data);
+		template <typename KeyType, typename ValueType, typename Hash, typename Pred> OctetStream& operator >> (std::unordered_multimap<KeyType, ValueType, Hash, Pred> &data);
+#endif
 
 	protected:
 		void Release();
 
 		bool PeekByte(void* data, size_t n);
 		void PopByte(void* data, size_t n) throw (std::length_error);
+		const byte_t* PopBytePtr(size_t n) throw (std::length_error);
+
+		template <typename IntT> static uint64_t ZigZagEncode(IntT value)
+		{
+			if (static_cast<IntT>(-1) < static_cast<IntT>(0)) {
+				int64_t v = static_cast<int64_t>(value);
+				return v < 0 ? ~(static_cast<uint64_t>(v) << 1) : (static_cast<uint64_t>(v) << 1);
+			}
+			return static_cast<uint64_t>(value);
+		}
+		template <typename IntT> static IntT ZigZagDecode(uint64_t value)
+		{
+			if (static_cast<IntT>(-1) < static_cast<IntT>(0)) {
+				return static_cast<IntT>(static_cast<int64_t>((value >> 1) ^ (~(value & 1) + 1)));
+			}
+			return static_cast<IntT>(value);
+		}
+		void PushVarint64(uint64_t value);
+		// decode a varint at the read position without consuming it; false if incomplete or malformed
+		bool DecodeVarint64(uint64_t *value, size_t *n) const
+		{
+			const byte_t *p = m_buffer + m_read_pos;
+			size_t avail = m_write_pos - m_read_pos;
+			// 1 and 2 byte values are the common case, decode them without looping
+			if (avail >= 1 && p[0] < 0x80) {
+				*value = p[0];
+				*n = 1;
+				return true;
+			}
+			if (avail >= 2 && p[1] < 0x80) {
+				*value = (p[0] & 0x7F) | (static_cast<uint64_t>(p[1]) << 7);
+				*n = 2;
+				return true;
+			}
+			return DecodeVarint64Slow(value, n);
+		}
+		bool DecodeVarint64Slow(uint64_t *value, size_t *n) const;
 		void PushByte(const void* data, size_t n);
 
+	private:
+		void Grow(size_t n);
+		void Reallocate(size_t capacity);
+
+		template <typename T> void PushArray(const T *data, size_t n, PackModeTag<PACK_RAW>);
+		template <typename T> void PushArray(const T *data, size_t n, PackModeTag<PACK_INTEGER>);
+		template <typename T> void PopArray(T *data, size_t n, PackModeTag<PACK_RAW>);
+		template <typename T> void PopArray(T *data, size_t n, PackModeTag<PACK_INTEGER>);
+
+		template <typename T> static size_t GetVectorPackSize(const std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T, int Mode> static size_t GetVectorPackSize(const std::vector<T> &data, PackModeTag<Mode>);
+		template <typename T> void PushVector(const std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T, int Mode> void PushVector(const std::vector<T> &data, PackModeTag<Mode>);
+		template <typename T> void PopVector(std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T, int Mode> void PopVector(std::vector<T> &data, PackModeTag<Mode>);
+
+		template <typename T> static size_t GetFixedArrayPackSize(const T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T, int Mode> static size_t GetFixedArrayPackSize(const T*, size_t n, PackModeTag<Mode>) { return n * sizeof(T); }
+		template <typename T> void PushFixedArray(const T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T> void PushFixedArray(const T *data, size_t n, PackModeTag<PACK_RAW>);
+		template <typename T> void PushFixedArray(const T *data, size_t n, PackModeTag<PACK_INTEGER>);
+		template <typename T> void PopFixedArray(T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>);
+		template <typename T> void PopFixedArray(T *data, size_t n, PackModeTag<PACK_RAW>);
+		template <typename T> void PopFixedArray(T *data, size_t n, PackModeTag<PACK_INTEGER>);
+		// extraction appends to strings and containers, array elements are reset first
+		template <typename T> void PopArrayElement(T &value) { value = T(); *this >> value; }
+		template <typename T, size_t N> void PopArrayElement(T (&value)[N]) { *this >> value; }
+
 	private:
 		byte_t *m_buffer;   // begin of the buffer
+		Allocator *m_allocator;  // allocator of the owned buffer
 		int m_capacity;
 		int m_read_pos;
 		int m_write_pos;
@@ -183,11 +602,67 @@ namespace zbase
 		// to avoid memory duplication. In attach mode, the memory must be guaranteed to be available 
 		// in the life period of the OctetStream object and released externally when appropriate.
 		bool m_is_attach_mode;
+		// reference to the attached Octets object if any
+		Octets m_attached;
+
+		GrowthPolicy m_growth_policy;
+		IntegerEncoding m_integer_encoding;
 	}; // class OctetStream
 
 	std::ostringstream& operator << (std::ostringstream& oss, const OctetStream& ipStream);
 	std::ostream& operator << (std::ostream& oss, const OctetStream& ipStream);
 
+	//
+	// Pack size of container elements and pair members, specialized for types that have no
+	// OctetStream::GetPackSize() overload, see schema.h
+	//
+	template <typename T, typename Enable = void>
+	struct PackSizeTraits
+	{
+		static size_t Get(const T &value) { return OctetStream::GetPackSize(value); }
+	};
+
+	//
+	// Preallocation for the elements about to be extracted into a container
+	//
+	template <typename Container>
+	struct ReserveTraits
+	{
+		static void Reserve(Container&, size_t) {}
+	};
+
+	template <typename T>
+	struct ReserveTraits<std::vector<T> >
+	{
+		static void Reserve(std::vector<T> &container, size_t n) { container.reserve(n); }
+	};
+
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+	template <typename T, typename Hash, typename Pred>
+	struct ReserveTraits<std::unordered_set<T, Hash, Pred> >
+	{
+		static void Reserve(std::unordered_set<T, Hash, Pred> &container, size_t n) { container.reserve(n); }
+	};
+
+	template <typename T, typename Hash, typename Pred>
+	struct ReserveTraits<std::unordered_multiset<T, Hash, Pred> >
+	{
+		static void Reserve(std::unordered_multiset<T, Hash, Pred> &container, size_t n) { container.reserve(n); }
+	};
+
+	template <typename KeyType, typename ValueType, typename Hash, typename Pred>
+	struct ReserveTraits<std::unordered_map<KeyType, ValueType, Hash, Pred> >
+	{
+		static void Reserve(std::unordered_map<KeyType, ValueType, Hash, Pred> &container, size_t n) { container.reserve(n); }
+	};
+
+	template <typename KeyType, typename ValueType, typename Hash, typename Pred>
+	struct ReserveTraits<std::unordered_multimap<KeyType, ValueType, Hash, Pred> >
+	{
+		static void Reserve(std::unordered_multimap<KeyType, ValueType, Hash, Pred> &container, size_t n) { container.reserve(n); }
+	};
+#endif
+
 	//
 	// STL Container Serialize/Deserialize implementation
 	//
@@ -200,7 +675,7 @@ namespace zbase
 		virtual OctetStream* Serialize(OctetStream *stream) const
 		{
 			if (m_container.size() > 0) {
-				*stream << (uint32_t)m_container.size();
+				stream->PushLength(m_container.size());
 				for (typename Container::const_iterator it = m_container.begin(); it != m_container.end(); ++it) {
 					*stream << *it;
 				}
@@ -210,27 +685,146 @@ namespace zbase
 
 		virtual OctetStream* Deserialize(OctetStream *stream)
 		{
-			uint32_t count = stream->PeekInteger<uint32_t>();
+			uint32_t count = stream->PeekLength();
 			if (count > 0) {
-				stream->PopInteger<uint32_t>();
+				stream->PopLength();
+				// the count comes from the wire: reserve no more than one element per byte left
+				ReserveTraits<Container>::Reserve(m_container, m_container.size() + std::min<size_t>(count, stream->GetSize()));
 				for (size_t i = 0; i < count && !stream->IsEmpty(); ++i) {
 					typename Container::value_type value;
 					*stream >> value;
+#ifdef ZBASE_HAS_RVALUE_REFERENCES
+					m_container.insert(m_container.end(), std::move(value));
+#else
 					m_container.insert(m_container.end(), value);
+#endif
 				}
 			}
 			return stream;
 		}
 
+		virtual size_t GetPackSize() const
+		{
+			// nothing is written for an empty container, see Serialize()
+			if (m_container.size() == 0) {
+				return 0;
+			}
+			size_t size = sizeof(uint32_t);
+			for (typename Container::const_iterator it = m_container.begin(); it != m_container.end(); ++it) {
+				size += PackSizeTraits<typename Container::value_type>::Get(*it);
+			}
+			return size;
+		}
+
 	private:
 		Container &m_container;
 	};
 
+	//
+	// Bulk copy of arrays and vectors
+	//
+	template <typename T>
+	void OctetStream::PushArray(const T *data, size_t n, PackModeTag<PACK_RAW>)
+	{
+		PushByte(data, n * sizeof(T));
+	}
+
+	template <typename T>
+	void OctetStream::PushArray(const T *data, size_t n, PackModeTag<PACK_INTEGER>)
+	{
+		assert(!m_is_attach_mode);
+		if (static_cast<size_t>(m_capacity - m_write_pos) < n * sizeof(T)) {
+			Grow(m_write_pos + n * sizeof(T));
+		}
+		byteorder::HToLEArray(reinterpret_cast<T*>(m_buffer + m_write_pos), data, n);
+		m_write_pos += n * sizeof(T);
+	}
+
+	template <typename T>
+	void OctetStream::PopArray(T *data, size_t n, PackModeTag<PACK_RAW>)
+	{
+		memcpy(data, PopBytePtr(n * sizeof(T)), n * sizeof(T));
+	}
+
+	template <typename T>
+	void OctetStream::PopArray(T *data, size_t n, PackModeTag<PACK_INTEGER>)
+	{
+		byteorder::LEToHArray(data, reinterpret_cast<const T*>(PopBytePtr(n * sizeof(T))), n);
+	}
+
+	template <typename T>
+	size_t OctetStream::GetVectorPackSize(const std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		return STLContainer1_Serializer<std::vector<T> >(&data).GetPackSize();
+	}
+
+	template <typename T, int Mode>
+	size_t OctetStream::GetVectorPackSize(const std::vector<T> &data, PackModeTag<Mode>)
+	{
+		return data.empty() ? 0 : sizeof(uint32_t) + data.size() * sizeof(T);
+	}
+
+	template <typename T>
+	void OctetStream::PushVector(const std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		*this << STLContainer1_Serializer<std::vector<T> >(&data);
+	}
+
+	template <typename T, int Mode>
+	void OctetStream::PushVector(const std::vector<T> &data, PackModeTag<Mode> tag)
+	{
+		if (PACK_INTEGER == Mode && ENCODING_VARINT == m_integer_encoding) {
+			PushVector(data, PackModeTag<PACK_ELEMENTWISE>());
+			return;
+		}
+		// same layout as STLContainer1_Serializer: nothing is written for an empty vector
+		if (!data.empty()) {
+			ReserveForWrite(sizeof(uint64_t) + data.size() * sizeof(T));
+			PushLength(data.size());
+			PushArray(&data[0], data.size(), tag);
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PopVector(std::vector<T> &data, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		STLContainer1_Serializer<std::vector<T> > holder(&data);
+		*this >> holder;
+	}
+
+	template <typename T, int Mode>
+	void OctetStream::PopVector(std::vector<T> &data, PackModeTag<Mode> tag)
+	{
+		if (PACK_INTEGER == Mode && ENCODING_VARINT == m_integer_encoding) {
+			PopVector(data, PackModeTag<PACK_ELEMENTWISE>());
+			return;
+		}
+		uint32_t count = PeekLength();
+		if (count > 0) {
+			int read_pos = m_read_pos;
+			PopLength();
+			if (static_cast<size_t>(m_write_pos - m_read_pos) < static_cast<size_t>(count) * sizeof(T)) {
+				m_read_pos = read_pos;
+				throw std::length_error("OctetStream::PopVector");
+			}
+			size_t offset = data.size();
+			data.resize(offset + count);
+			PopArray(&data[offset], count, tag);
+		}
+	}
+
+	template <typename T>
+	size_t OctetStream::GetPackSize(const std::vector<T> &data)
+	{
+		return GetVectorPackSize(data, PackModeTag<PackTraits<T>::kMode>());
+	}
+
 	template <typename T>
 	OctetStream& OctetStream::operator << (const std::vector<T> &data)
 	{
 		assert(!m_is_attach_mode);
-		return *this << STLContainer1_Serializer<std::vector<T> >(&data);
+		PushVector(data, PackModeTag<PackTraits<T>::kMode>());
+		return *this;
 	}
 
 	template <typename T>
@@ -289,12 +883,54 @@ namespace zbase
 		return *this << STLContainer1_Serializer<std::multimap<KeyType, T> >(&data);
 	}
 
+	template <typename T>
+	size_t OctetStream::GetPackSize(const std::list<T> &data)
+	{
+		return STLContainer1_Serializer<std::list<T> >(&data).GetPackSize();
+	}
+
+	template <typename T>
+	size_t OctetStream::GetPackSize(const std::deque<T> &data)
+	{
+		return STLContainer1_Serializer<std::deque<T> >(&data).GetPackSize();
+	}
+
+	template <typename T>
+	size_t OctetStream::GetPackSize(const std::set<T> &data)
+	{
+		return STLContainer1_Serializer<std::set<T> >(&data).GetPackSize();
+	}
+
+	template <typename T>
+	size_t OctetStream::GetPackSize(const std::multiset<T> &data)
+	{
+		return STLContainer1_Serializer<std::multiset<T> >(&data).GetPackSize();
+	}
+
+	template <typename T1, typename T2>
+	size_t OctetStream::GetPackSize(const std::pair<T1, T2> &data)
+	{
+		return PackSizeTraits<T1>::Get(data.first) + PackSizeTraits<T2>::Get(data.second);
+	}
+
+	template <typename KeyType, typename T>
+	size_t OctetStream::GetPackSize(const std::map<KeyType, T> &data)
+	{
+		return STLContainer1_Serializer<std::map<KeyType, T> >(&data).GetPackSize();
+	}
+
+	template <typename KeyType, typename T>
+	size_t OctetStream::GetPackSize(const std::multimap<KeyType, T> &data)
+	{
+		return STLContainer1_Serializer<std::multimap<KeyType, T> >(&data).GetPackSize();
+	}
+
 
 	template <typename T>
 	OctetStream& OctetStream::operator >> (std::vector<T> &data)
 	{
-		STLContainer1_Serializer<std::vector<T> > holder(&data);
-		return *this >> holder;
+		PopVector(data, PackModeTag<PackTraits<T>::kMode>());
+		return *this;
 	}
 
 	template <typename T> 
@@ -352,6 +988,200 @@ namespace zbase
 		return *this >> holder;
 	}
 
+	//
+	// Fixed-size arrays
+	//
+	template <typename T>
+	size_t OctetStream::GetFixedArrayPackSize(const T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		size_t size = 0;
+		for (size_t i = 0; i < n; ++i) {
+			size += PackSizeTraits<T>::Get(data[i]);
+		}
+		return size;
+	}
+
+	template <typename T>
+	void OctetStream::PushFixedArray(const T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		for (size_t i = 0; i < n; ++i) {
+			*this << data[i];
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PushFixedArray(const T *data, size_t n, PackModeTag<PACK_RAW> tag)
+	{
+		if (n > 0) {
+			PushArray(data, n, tag);
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PushFixedArray(const T *data, size_t n, PackModeTag<PACK_INTEGER> tag)
+	{
+		if (ENCODING_VARINT == m_integer_encoding) {
+			PushFixedArray(data, n, PackModeTag<PACK_ELEMENTWISE>());
+		} else if (n > 0) {
+			PushArray(data, n, tag);
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PopFixedArray(T *data, size_t n, PackModeTag<PACK_ELEMENTWISE>)
+	{
+		for (size_t i = 0; i < n; ++i) {
+			PopArrayElement(data[i]);
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PopFixedArray(T *data, size_t n, PackModeTag<PACK_RAW> tag)
+	{
+		if (n > 0) {
+			PopArray(data, n, tag);
+		}
+	}
+
+	template <typename T>
+	void OctetStream::PopFixedArray(T *data, size_t n, PackModeTag<PACK_INTEGER> tag)
+	{
+		if (ENCODING_VARINT == m_integer_encoding) {
+			PopFixedArray(data, n, PackModeTag<PACK_ELEMENTWISE>());
+		} else if (n > 0) {
+			PopArray(data, n, tag);
+		}
+	}
+
+	template <typename T, size_t N>
+	size_t OctetStream::GetPackSize(const T (&data)[N])
+	{
+		return GetFixedArrayPackSize(data, N, PackModeTag<BuiltinArrayPackTraits<T>::kMode>());
+	}
+
+	template <typename T, size_t N>
+	OctetStream& OctetStream::operator << (const T (&data)[N])
+	{
+		assert(!m_is_attach_mode);
+		PushFixedArray(data, N, PackModeTag<BuiltinArrayPackTraits<T>::kMode>());
+		return *this;
+	}
+
+	template <typename T, size_t N>
+	OctetStream& OctetStream::operator >> (T (&data)[N])
+	{
+		PopFixedArray(data, N, PackModeTag<BuiltinArrayPackTraits<T>::kMode>());
+		return *this;
+	}
+
+#ifdef ZBASE_HAS_STD_ARRAY
+	template <typename T, size_t N>
+	size_t OctetStream::GetPackSize(const std::array<T, N> &data)
+	{
+		return GetFixedArrayPackSize(data.data(), N, PackModeTag<ArrayPackTraits<T>::kMode>());
+	}
+
+	template <typename T, size_t N>
+	OctetStream& OctetStream::operator << (const std::array<T, N> &data)
+	{
+		assert(!m_is_attach_mode);
+		PushFixedArray(data.data(), N, PackModeTag<ArrayPackTraits<T>::kMode>());
+		return *this;
+	}
+
+	template <typename T, size_t N>
+	OctetStream& OctetStream::operator >> (std::array<T, N> &data)
+	{
+		PopFixedArray(data.data(), N, PackModeTag<ArrayPackTraits<T>::kMode>());
+		return *this;
+	}
+#endif // ZBASE_HAS_STD_ARRAY
+
+#ifdef ZBASE_HAS_UNORDERED_CONTAINERS
+	//
+	// Unordered containers
+	//
+	template <typename T, typename Hash, typename Pred>
+	size_t OctetStream::GetPackSize(const std::unordered_set<T, Hash, Pred> &data)
+	{
+		return STLContainer1_Serializer<std::unordered_set<T, Hash, Pred> >(&data).GetPackSize();
+	}
+
+	template <typename T, typename Hash, typename Pred>
+	size_t OctetStream::GetPackSize(const std::unordered_multiset<T, Hash, Pred> &data)
+	{
+		return STLContainer1_Serializer<std::unordered_multiset<T, Hash, Pred> >(&data).GetPackSize();
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	size_t OctetStream::GetPackSize(const std::unordered_map<KeyType, T, Hash, Pred> &data)
+	{
+		return STLContainer1_Serializer<std::unordered_map<KeyType, T, Hash, Pred> >(&data).GetPackSize();
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	size_t OctetStream::GetPackSize(const std::unordered_multimap<KeyType, T, Hash, Pred> &data)
+	{
+		return STLContainer1_Serializer<std::unordered_multimap<KeyType, T, Hash, Pred> >(&data).GetPackSize();
+	}
+
+	template <typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator << (const std::unordered_set<T, Hash, Pred> &data)
+	{
+		assert(!m_is_attach_mode);
+		return *this << STLContainer1_Serializer<std::unordered_set<T, Hash, Pred> >(&data);
+	}
+
+	template <typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator << (const std::unordered_multiset<T, Hash, Pred> &data)
+	{
+		assert(!m_is_attach_mode);
+		return *this << STLContainer1_Serializer<std::unordered_multiset<T, Hash, Pred> >(&data);
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator << (const std::unordered_map<KeyType, T, Hash, Pred> &data)
+	{
+		assert(!m_is_attach_mode);
+		return *this << STLContainer1_Serializer<std::unordered_map<KeyType, T, Hash, Pred> >(&data);
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator << (const std::unordered_multimap<KeyType, T, Hash, Pred> &data)
+	{
+		assert(!m_is_attach_mode);
+		return *this << STLContainer1_Serializer<std::unordered_multimap<KeyType, T, Hash, Pred> >(&data);
+	}
+
+	template <typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator >> (std::unordered_set<T, Hash, Pred> &data)
+	{
+		STLContainer1_Serializer<std::unordered_set<T, Hash, Pred> > holder(&data);
+		return *this >> holder;
+	}
+
+	template <typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator >> (std::unordered_multiset<T, Hash, Pred> &data)
+	{
+		STLContainer1_Serializer<std::unordered_multiset<T, Hash, Pred> > holder(&data);
+		return *this >> holder;
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator >> (std::unordered_map<KeyType, T, Hash, Pred> &data)
+	{
+		STLContainer1_Serializer<std::unordered_map<KeyType, T, Hash, Pred> > holder(&data);
+		return *this >> holder;
+	}
+
+	template <typename KeyType, typename T, typename Hash, typename Pred>
+	OctetStream& OctetStream::operator >> (std::unordered_multimap<KeyType, T, Hash, Pred> &data)
+	{
+		STLContainer1_Serializer<std::unordered_multimap<KeyType, T, Hash, Pred> > holder(&data);
+		return *this >> holder;
+	}
+#endif // ZBASE_HAS_UNORDERED_CONTAINERS
+
 } // namespace zbase
 #endif // ZBASE__OCTETSTREAM_H
 
@@ -0,0 +1,92 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Pool of reusable OctetStream buffers
+//
+#ifndef ZBASE__OCTETSTREAMPOOL_H
+#define ZBASE__OCTETSTREAMPOOL_H
+
+#include <cstddef>
+
+#include <zbase/config.h>
+#include <zbase/octetstream.h>
+
+namespace zbase
+{
+	struct OctetStreamPoolStats
+	{
+		size_t acquires;
+		size_t hits;            // acquires served by a pooled stream
+		size_t releases;
+		size_t discards;        // released streams freed because their class was full or they had no buffer
+		size_t shrinks;         // released streams trimmed down to the maximum capacity
+		size_t pooled_streams;
+		size_t pooled_bytes;    // buffer capacity of the pooled streams
+	};
+
+	// Keeps released OctetStream objects with their buffers for reuse, so that steady-state
+	// encoding allocates nothing. Streams are bucketed by capacity into power-of-two size
+	// classes from MIN_CAPACITY up to the maximum capacity, each guarded by its own lock.
+	// Acquire() returns a cleared stream of the smallest class holding the requested capacity.
+	// A stream grown beyond the maximum capacity is shrunk to it when released, so that one
+	// large message does not pin its buffer in the pool. Buffers are always allocated from
+	// the default allocator, whatever ScopedAllocator is active.
+	class OctetStreamPool
+	{
+	public:
+		static const size_t MIN_CAPACITY;
+		static const size_t DEFAULT_MAX_CAPACITY;
+		static const size_t DEFAULT_MAX_STREAMS_PER_CLASS;
+
+	public:
+		explicit OctetStreamPool(size_t max_capacity = DEFAULT_MAX_CAPACITY, size_t max_streams_per_class = DEFAULT_MAX_STREAMS_PER_CLASS);
+		~OctetStreamPool();
+
+		// get an empty stream which can hold at least capacity bytes without reallocation
+		OctetStream* Acquire(size_t capacity = 0);
+		// clear a stream got from Acquire() and keep it for reuse
+		void Release(OctetStream *stream);
+
+		// free all pooled streams
+		void Trim();
+
+		size_t GetMaxCapacity() const { return m_max_capacity; }
+		OctetStreamPoolStats GetStats() const;
+
+	private:
+		struct SizeClass;
+
+		size_t GetClassCapacity(size_t index) const { return MIN_CAPACITY << index; }
+
+		// forbid copy
+		OctetStreamPool(const OctetStreamPool&);
+		OctetStreamPool& operator = (const OctetStreamPool&);
+
+	private:
+		SizeClass *m_classes;
+		size_t m_class_count;
+		size_t m_max_capacity;
+		size_t m_max_streams_per_class;
+	};
+
+	// Stream acquired from a pool for the lifetime of the object
+	class PooledOctetStream
+	{
+	public:
+		explicit PooledOctetStream(OctetStreamPool& pool, size_t capacity = 0) : m_pool(pool), m_stream(pool.Acquire(capacity)) {}
+		~PooledOctetStream() { m_pool.Release(m_stream); }
+
+		OctetStream* Get() const { return m_stream; }
+		OctetStream& operator * () const { return *m_stream; }
+		OctetStream* operator -> () const { return m_stream; }
+
+	private:
+		// forbid copy
+		PooledOctetStream(const PooledOctetStream&);
+		PooledOctetStream& operator = (const PooledOctetStream&);
+
+	private:
+		OctetStreamPool& m_pool;
+		OctetStream *m_stream;
+	};
+} // namespace zbase
+#endif // ZBASE__OCTETSTREAMPOOL_H
@@ -0,0 +1,413 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Compile-time serialization schema of plain structs
+//
+// A schema declared next to a struct lists the data members in wire order:
+//
+//   struct Quote
+//   {
+//       uint32_t id;
+//       int64_t price;
+//       double volume;
+//       std::string symbol;
+//   };
+//   ZBASE_SCHEMA(Quote, id, price, volume, symbol)
+//
+//   stream << quote;  stream >> quote;  size_t n = schema::GetPackSize(quote);
+//
+// The encoder and decoder are generated by templates, without any virtual call, and are fully
+// inlined. Runs of consecutive fixed-size fields (bool, integers, floating point) are fused:
+// such a run is written into space reserved once and read from one CheckedRegion, so it costs
+// a single bounds check. The wire format is the same as streaming the fields one by one with
+// the insertion operators, in either integer encoding; with ENCODING_VARINT, runs holding
+// multi-byte integers fall back to per-field operators. Fields of other types go through the
+// operators of OctetStream, so strings, Octets, containers and nested schema structs are
+// supported too. ZBASE_SCHEMA must be used at namespace scope, in the namespace of the struct,
+// and the fields must be accessible there.
+//
+#ifndef ZBASE__SCHEMA_H
+#define ZBASE__SCHEMA_H
+
+#include <zbase/config.h>
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+
+#include <cstddef>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include <zbase/inttypes.h>
+#include <zbase/byteorder.h>
+#include <zbase/octetstream.h>
+
+namespace zbase
+{
+	namespace schema
+	{
+		// Data member of class C
+		template <typename C, typename T, T C::*Member>
+		struct Field
+		{
+			typedef T value_type;
+			static const T& Get(const C &object) { return object.*Member; }
+			static T& Get(C &object) { return object.*Member; }
+		};
+
+		// Fields in wire order
+		template <typename... Fields> struct FieldList {};
+
+		// Whether ZBASE_SCHEMA has been declared for T
+		template <typename T>
+		struct HasSchema
+		{
+		private:
+			template <typename U> static char Test(decltype(ZBaseSchemaOf(static_cast<const U*>(0)))*);
+			template <typename U> static long Test(...);
+
+		public:
+			static const bool value = sizeof(Test<T>(0)) == sizeof(char);
+		};
+
+		template <typename T> const bool HasSchema<T>::value;
+
+		template <typename T> struct SchemaOf { typedef decltype(ZBaseSchemaOf(static_cast<const T*>(0))) type; };
+
+		template <typename T> void Serialize(OctetStream &stream, const T &value);
+		// ATTENTION: throws std::length_error on underflow with the fields before the failure
+		// already decoded and consumed; use an OctetStream::Transaction to retry later
+		template <typename T> void Deserialize(OctetStream &stream, T &value);
+		// exact size for ENCODING_FIXED streams, see OctetStream::GetPackSize()
+		template <typename T> size_t GetPackSize(const T &value);
+
+		namespace detail
+		{
+			//
+			// Fields written with a fixed number of bytes
+			//
+			template <typename T> struct FixedField { static const size_t kSize = 0; };
+
+			template <> struct FixedField<bool>
+			{
+				static const size_t kSize = 1;
+				static const bool kIsEncodedInteger = false;
+				static void Store(unsigned char *p, bool value) { *p = value ? 1 : 0; }
+				static bool Load(OctetStream::CheckedRegion &region) { return region.ReadRaw<char>() != 0; }
+			};
+
+			// bytes and floating point values, the in-memory bytes are the wire bytes
+			template <typename T>
+			struct RawField
+			{
+				static const size_t kSize = sizeof(T);
+				static const bool kIsEncodedInteger = false;
+				static void Store(unsigned char *p, T value) { memcpy(p, &value, sizeof(value)); }
+				static T Load(OctetStream::CheckedRegion &region) { return region.ReadRaw<T>(); }
+			};
+
+			// little-endian integers, unless the stream uses ENCODING_VARINT
+			template <typename T>
+			struct IntegerField
+			{
+				static const size_t kSize = sizeof(T);
+				static const bool kIsEncodedInteger = true;
+				static void Store(unsigned char *p, T value) { value = byteorder::HToLE(value); memcpy(p, &value, sizeof(value)); }
+				static T Load(OctetStream::CheckedRegion &region) { return region.ReadInteger<T>(); }
+			};
+
+			template <> struct FixedField<int8_t> : RawField<int8_t> {};
+			template <> struct FixedField<uint8_t> : RawField<uint8_t> {};
+			template <> struct FixedField<int16_t> : IntegerField<int16_t> {};
+			template <> struct FixedField<uint16_t> : IntegerField<uint16_t> {};
+			template <> struct FixedField<int32_t> : IntegerField<int32_t> {};
+			template <> struct FixedField<uint32_t> : IntegerField<uint32_t> {};
+			template <> struct FixedField<int64_t> : IntegerField<int64_t> {};
+			template <> struct FixedField<uint64_t> : IntegerField<uint64_t> {};
+			template <> struct FixedField<float> : RawField<float> {};
+			template <> struct FixedField<double> : RawField<double> {};
+			template <> struct FixedField<long double> : RawField<long double> {};
+
+			template <typename F> struct IsFixed { static const bool value = FixedField<typename F::value_type>::kSize > 0; };
+
+			//
+			// Run of consecutive fixed-size fields
+			//
+			template <typename C, typename... Fields> struct FixedRun;
+
+			template <typename C>
+			struct FixedRun<C>
+			{
+				static const size_t kSize = 0;
+				static const bool kHasEncodedInteger = false;
+				static void Store(unsigned char *, const C &) {}
+				static void Load(OctetStream::CheckedRegion &, C &) {}
+				static void SerializeEach(OctetStream &, const C &) {}
+				static void DeserializeEach(OctetStream &, C &) {}
+			};
+
+			template <typename C, typename F, typename... Rest>
+			struct FixedRun<C, F, Rest...>
+			{
+				typedef FixedField<typename F::value_type> Traits;
+				typedef FixedRun<C, Rest...> Next;
+
+				static const size_t kSize = Traits::kSize + Next::kSize;
+				static const bool kHasEncodedInteger = Traits::kIsEncodedInteger || Next::kHasEncodedInteger;
+
+				static void Store(unsigned char *p, const C &object)
+				{
+					Traits::Store(p, F::Get(object));
+					Next::Store(p + Traits::kSize, object);
+				}
+				static void Load(OctetStream::CheckedRegion &region, C &object)
+				{
+					F::Get(object) = Traits::Load(region);
+					Next::Load(region, object);
+				}
+				static void SerializeEach(OctetStream &stream, const C &object)
+				{
+					stream << F::Get(object);
+					Next::SerializeEach(stream, object);
+				}
+				static void DeserializeEach(OctetStream &stream, C &object)
+				{
+					stream >> F::Get(object);
+					Next::DeserializeEach(stream, object);
+				}
+			};
+
+			template <typename C, typename List> struct MakeRun;
+			template <typename C, typename... Fields> struct MakeRun<C, FieldList<Fields...> > { typedef FixedRun<C, Fields...> type; };
+
+			//
+			// Split a field list into its leading run of fixed-size fields and the rest
+			//
+			template <typename Run, typename Rest>
+			struct SplitDone
+			{
+				typedef Run Head;
+				typedef Rest Tail;
+			};
+
+			template <typename Run, typename Rest> struct SplitRun;
+
+			template <typename... Run>
+			struct SplitRun<FieldList<Run...>, FieldList<> > : SplitDone<FieldList<Run...>, FieldList<> > {};
+
+			template <typename... Run, typename F, typename... Rest>
+			struct SplitRun<FieldList<Run...>, FieldList<F, Rest...> >
+				: std::conditional<IsFixed<F>::value,
+				                   SplitRun<FieldList<Run..., F>, FieldList<Rest...> >,
+				                   SplitDone<FieldList<Run...>, FieldList<F, Rest...> > >::type
+			{
+			};
+
+			//
+			// Codec of a field list, one fused run or one other field at a time
+			//
+			template <typename C, typename List> struct Codec;
+			template <typename C, typename List, bool kIsFixed> struct CodecStep;
+
+			template <typename C>
+			struct Codec<C, FieldList<> >
+			{
+				static void Serialize(OctetStream &, const C &) {}
+				static void Deserialize(OctetStream &, C &) {}
+				static size_t GetPackSize(const C &) { return 0; }
+			};
+
+			template <typename C, typename F, typename... Rest>
+			struct Codec<C, FieldList<F, Rest...> > : CodecStep<C, FieldList<F, Rest...>, IsFixed<F>::value> {};
+
+			template <typename C, typename F, typename... Rest>
+			struct CodecStep<C, FieldList<F, Rest...>, true>
+			{
+				typedef SplitRun<FieldList<>, FieldList<F, Rest...> > Split;
+				typedef typename MakeRun<C, typename Split::Head>::type Run;
+				typedef Codec<C, typename Split::Tail> Next;
+
+				static void Serialize(OctetStream &stream, const C &object)
+				{
+					if (Run::kHasEncodedInteger && OctetStream::ENCODING_VARINT == stream.GetIntegerEncoding()) {
+						Run::SerializeEach(stream, object);
+					} else {
+						Run::Store(static_cast<unsigned char*>(stream.PrepareWrite(Run::kSize)), object);
+						stream.CommitWrite(Run::kSize);
+					}
+					Next::Serialize(stream, object);
+				}
+				static void Deserialize(OctetStream &stream, C &object)
+				{
+					if (Run::kHasEncodedInteger && OctetStream::ENCODING_VARINT == stream.GetIntegerEncoding()) {
+						Run::DeserializeEach(stream, object);
+					} else {
+						OctetStream::CheckedRegion region(stream, Run::kSize);
+						if (!region.IsValid()) {
+							throw std::length_error("schema::Deserialize");
+						}
+						Run::Load(region, object);
+					}
+					Next::Deserialize(stream, object);
+				}
+				static size_t GetPackSize(const C &object) { return Run::kSize + Next::GetPackSize(object); }
+			};
+
+			template <typename C, typename F, typename... Rest>
+			struct CodecStep<C, FieldList<F, Rest...>, false>
+			{
+				typedef Codec<C, FieldList<Rest...> > Next;
+
+				static void Serialize(OctetStream &stream, const C &object)
+				{
+					stream << F::Get(object);
+					Next::Serialize(stream, object);
+				}
+				static void Deserialize(OctetStream &stream, C &object)
+				{
+					stream >> F::Get(object);
+					Next::Deserialize(stream, object);
+				}
+				static size_t GetPackSize(const C &object) { return PackSizeTraits<typename F::value_type>::Get(F::Get(object)) + Next::GetPackSize(object); }
+			};
+		} // namespace detail
+
+		template <typename T>
+		inline void Serialize(OctetStream &stream, const T &value)
+		{
+			detail::Codec<T, typename SchemaOf<T>::type>::Serialize(stream, value);
+		}
+
+		template <typename T>
+		inline void Deserialize(OctetStream &stream, T &value)
+		{
+			detail::Codec<T, typename SchemaOf<T>::type>::Deserialize(stream, value);
+		}
+
+		template <typename T>
+		inline size_t GetPackSize(const T &value)
+		{
+			return detail::Codec<T, typename SchemaOf<T>::type>::GetPackSize(value);
+		}
+
+		// ISerialize implementation by the schema of Derived, for classes which have to stay
+		// usable through the virtual interface. The stream operators still take the inlined path.
+		template <typename Derived>
+		class SchemaSerialize : public ISerialize
+		{
+		public:
+			virtual OctetStream* Serialize(OctetStream *stream) const
+			{
+				schema::Serialize(*stream, static_cast<const Derived&>(*this));
+				return stream;
+			}
+			virtual OctetStream* Deserialize(OctetStream *stream)
+			{
+				schema::Deserialize(*stream, static_cast<Derived&>(*this));
+				return stream;
+			}
+			virtual size_t GetPackSize() const { return schema::GetPackSize(static_cast<const Derived&>(*this)); }
+		};
+	} // namespace schema
+
+	template <typename T>
+	struct PackSizeTraits<T, typename std::enable_if<schema::HasSchema<T>::value>::type>
+	{
+		static size_t Get(const T &value) { return schema::GetPackSize(value); }
+	};
+
+	template <typename T>
+	inline typename std::enable_if<schema::HasSchema<T>::value, OctetStream&>::type operator << (OctetStream &stream, const T &value)
+	{
+		schema::Serialize(stream, value);
+		return stream;
+	}
+
+	template <typename T>
+	inline typename std::enable_if<schema::HasSchema<T>::value, OctetStream&>::type operator >> (OctetStream &stream, T &value)
+	{
+		schema::Deserialize(stream, value);
+		return stream;
+	}
+} // namespace zbase
+
+#define ZBASE_SCHEMA_EXPAND(x) x
+#define ZBASE_SCHEMA_FIELD(C, m) ::zbase::schema::Field<C, decltype(C::m), &C::m>
+#define ZBASE_SCHEMA_COUNT(...) ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_COUNT_(__VA_ARGS__, 64, 63, 62, 61, 60, 59, 58, 57, 56, 55, 54, 53, 52, 51, 50, 49, 48, 47, 46, 45, 44, 43, 42, 41, 40, 39, 38, 37, 36, 35, 34, 33, 32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17, 16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1))
+#define ZBASE_SCHEMA_COUNT_(_1, _2, _3, _4, _5, _6, _7, _8, _9, _10, _11, _12, _13, _14, _15, _16, _17, _18, _19, _20, _21, _22, _23, _24, _25, _26, _27, _28, _29, _30, _31, _32, _33, _34, _35, _36, _37, _38, _39, _40, _41, _42, _43, _44, _45, _46, _47, _48, _49, _50, _51, _52, _53, _54, _55, _56, _57, _58, _59, _60, _61, _62, _63, _64, N, ...) N
+#define ZBASE_SCHEMA_CAT(a, b) ZBASE_SCHEMA_CAT_(a, b)
+#define ZBASE_SCHEMA_CAT_(a, b) a##b
+#define ZBASE_SCHEMA_FIELDS_1(M, C, m) M(C, m)
+#define ZBASE_SCHEMA_FIELDS_2(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_1(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_3(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_2(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_4(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_3(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_5(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_4(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_6(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_5(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_7(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_6(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_8(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_7(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_9(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_8(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_10(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_9(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_11(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_10(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_12(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_11(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_13(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_12(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_14(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_13(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_15(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_14(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_16(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_15(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_17(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_16(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_18(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_17(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_19(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_18(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_20(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_19(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_21(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_20(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_22(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_21(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_23(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_22(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_24(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_23(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_25(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_24(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_26(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_25(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_27(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_26(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_28(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_27(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_29(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_28(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_30(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_29(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_31(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_30(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_32(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_31(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_33(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_32(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_34(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_33(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_35(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_34(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_36(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_35(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_37(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_36(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_38(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_37(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_39(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_38(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_40(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_39(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_41(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_40(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_42(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_41(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_43(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_42(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_44(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_43(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_45(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_44(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_46(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_45(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_47(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_46(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_48(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_47(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_49(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_48(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_50(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_49(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_51(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_50(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_52(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_51(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_53(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_52(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_54(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_53(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_55(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_54(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_56(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_55(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_57(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_56(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_58(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_57(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_59(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_58(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_60(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_59(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_61(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_60(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_62(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_61(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_63(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_62(M, C, __VA_ARGS__))
+#define ZBASE_SCHEMA_FIELDS_64(M, C, m, ...) M(C, m), ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_FIELDS_63(M, C, __VA_ARGS__))
+// M(C, m) for every m, separated by commas
+#define ZBASE_SCHEMA_FIELDS(M, C, ...) ZBASE_SCHEMA_EXPAND(ZBASE_SCHEMA_CAT(ZBASE_SCHEMA_FIELDS_, ZBASE_SCHEMA_COUNT(__VA_ARGS__))(M, C, __VA_ARGS__))
+
+// Declare the schema of class C as the list of its data members in wire order, up to 64 of them.
+// The generated function is found by argument-dependent lookup and only its return type is used;
+// it is defined inline so that classes in an unnamed namespace do not warn of a missing definition.
+#define ZBASE_SCHEMA(C, ...) \
+	inline ::zbase::schema::FieldList<ZBASE_SCHEMA_FIELDS(ZBASE_SCHEMA_FIELD, C, __VA_ARGS__)> ZBaseSchemaOf(const C*) { return {}; }
+
+#endif // ZBASE_HAS_VARIADIC_TEMPLATES
+#endif // ZBASE__SCHEMA_H
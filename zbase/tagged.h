@@ -0,0 +1,453 @@
+// Copyright (c) 2012 Junheng Zang. All Rights Reserved.
+//
+// Tagged encoding of messages for schema evolution
+//
+// A tagged message is a uint32 length followed by fields, each made of a varint key
+// (field id << 3 | wire type) and a value:
+//   WIRE_VARINT:  bool and integers as varints, zigzag encoded if signed
+//   WIRE_FIXED64: double, 8 bytes
+//   WIRE_BYTES:   uint32 length and bytes: strings, Octets, nested tagged messages (whose own
+//                 length is the field length) and any other type in the positional encoding
+//   WIRE_FIXED32: float, 4 bytes
+// Lengths and fixed-size values are little-endian whatever the integer encoding of the stream.
+// A reader skips the fields it does not know or want in O(1), except for varints, which are at
+// most 10 bytes, so fields can be added and removed as long as their ids are not reused, and an
+// integer field can change to another integer type.
+//
+//   struct Quote { uint32_t id; int64_t price; std::string symbol; };
+//   ZBASE_TAGGED_SCHEMA(Quote, (1, id), (2, price), (5, symbol))
+//
+//   stream << quote;  stream >> quote;
+//
+// Fields missing from the message keep their values. A struct must not have both a positional
+// and a tagged schema.
+//
+#ifndef ZBASE__TAGGED_H
+#define ZBASE__TAGGED_H
+
+#include <cstddef>
+#include <string>
+#include <stdexcept>
+
+#include <zbase/config.h>
+#include <zbase/inttypes.h>
+#include <zbase/octets.h>
+#include <zbase/octetstream.h>
+#include <zbase/schema.h>
+
+namespace zbase
+{
+	namespace tagged
+	{
+		enum WireType
+		{
+			WIRE_VARINT = 0,
+			WIRE_FIXED64 = 1,
+			WIRE_BYTES = 2,
+			WIRE_FIXED32 = 5
+		};
+
+		static const uint32_t MAX_FIELD_ID = (1U << 29) - 1;
+
+		//
+		// Encoding of a value of type T: wire type, writing, reading and size of the value
+		//
+		template <typename T, typename Enable = void>
+		struct Wire
+		{
+			// positional encoding in a length-delimited field
+			static const WireType kType = WIRE_BYTES;
+			static void Write(OctetStream &stream, const T &value)
+			{
+				size_t pos = stream.GetSize();
+				stream.PushInteger<uint32_t>(0);
+				stream << value;
+				stream.OverwriteInteger<uint32_t>(pos, static_cast<uint32_t>(stream.GetSize() - pos - sizeof(uint32_t)));
+			}
+			static void Read(OctetStream &stream, T &value)
+			{
+				uint32_t len = stream.PopInteger<uint32_t>();
+				if (len > stream.GetSize()) {
+					throw std::length_error("tagged::Wire::Read");
+				}
+				// the value must not read beyond the field
+				OctetStream field(stream.GetData(), len, true);
+				field.SetIntegerEncoding(stream.GetIntegerEncoding());
+				field >> value;
+				stream.Ignore(len);
+			}
+			static size_t GetSize(const T &value) { return sizeof(uint32_t) + PackSizeTraits<T>::Get(value); }
+		};
+
+		template <typename IntT>
+		struct VarintWire
+		{
+			static const WireType kType = WIRE_VARINT;
+			static void Write(OctetStream &stream, IntT value) { stream.PushVarint(value); }
+			static void Read(OctetStream &stream, IntT &value) { value = stream.PopVarint<IntT>(); }
+			static size_t GetSize(IntT value) { return OctetStream::GetVarintPackSize(value); }
+		};
+
+		template <typename T>
+		struct FixedWire
+		{
+			static const WireType kType = (sizeof(T) == 4 ? WIRE_FIXED32 : WIRE_FIXED64);
+			static void Write(OctetStream &stream, T value) { stream.Write(&value, sizeof(value)); }
+			static void Read(OctetStream &stream, T &value) { stream.Read(&value, sizeof(value)); }
+			static size_t GetSize(T) { return sizeof(T); }
+		};
+
+		template <> struct Wire<int8_t> : VarintWire<int8_t> {};
+		template <> struct Wire<uint8_t> : VarintWire<uint8_t> {};
+		template <> struct Wire<int16_t> : VarintWire<int16_t> {};
+		template <> struct Wire<uint16_t> : VarintWire<uint16_t> {};
+		template <> struct Wire<int32_t> : VarintWire<int32_t> {};
+		template <> struct Wire<uint32_t> : VarintWire<uint32_t> {};
+		template <> struct Wire<int64_t> : VarintWire<int64_t> {};
+		template <> struct Wire<uint64_t> : VarintWire<uint64_t> {};
+		template <> struct Wire<float> : FixedWire<float> {};
+		template <> struct Wire<double> : FixedWire<double> {};
+
+		template <>
+		struct Wire<bool>
+		{
+			static const WireType kType = WIRE_VARINT;
+			static void Write(OctetStream &stream, bool value) { stream.PushVarint<uint8_t>(value ? 1 : 0); }
+			static void Read(OctetStream &stream, bool &value) { value = stream.PopVarint<uint64_t>() != 0; }
+			static size_t GetSize(bool) { return 1; }
+		};
+
+		template <>
+		struct Wire<std::string>
+		{
+			static const WireType kType = WIRE_BYTES;
+			static void Write(OctetStream &stream, const std::string &value)
+			{
+				stream.PushInteger<uint32_t>(static_cast<uint32_t>(value.size()));
+				stream.Write(value.data(), value.size());
+			}
+			static void Read(OctetStream &stream, std::string &value)
+			{
+				uint32_t len = stream.PopInteger<uint32_t>();
+				if (len > stream.GetSize()) {
+					throw std::length_error("tagged::Wire::Read");
+				}
+				value.assign(static_cast<const char*>(stream.GetData()), len);
+				stream.Ignore(len);
+			}
+			static size_t GetSize(const std::string &value) { return sizeof(uint32_t) + value.size(); }
+		};
+
+		template <>
+		struct Wire<Octets>
+		{
+			static const WireType kType = WIRE_BYTES;
+			static void Write(OctetStream &stream, const Octets &value)
+			{
+				stream.PushInteger<uint32_t>(static_cast<uint32_t>(value.GetSize()));
+				stream.Write(value.GetData(), value.GetSize());
+			}
+			static void Read(OctetStream &stream, Octets &value)
+			{
+				uint32_t len = stream.PopInteger<uint32_t>();
+				if (len > stream.GetSize()) {
+					throw std::length_error("tagged::Wire::Read");
+				}
+				value = (len > 0 ? Octets(stream.GetData(), len) : Octets());
+				stream.Ignore(len);
+			}
+			static size_t GetSize(const Octets &value) { return sizeof(uint32_t) + value.GetSize(); }
+		};
+
+		//
+		// Writer of one message, the length is filled in by End() or the destructor
+		//
+		class Writer
+		{
+		public:
+			explicit Writer(OctetStream &stream) : m_stream(stream), m_pos(stream.GetSize()), m_is_ended(false)
+			{
+				m_stream.PushInteger<uint32_t>(0);
+			}
+			~Writer()
+			{
+				// unless the stream was cleared or read meanwhile
+				if (!m_is_ended && m_pos + sizeof(uint32_t) <= m_stream.GetSize()) {
+					End();
+				}
+			}
+
+			static uint32_t MakeKey(uint32_t id, WireType type) { return (id << 3) | type; }
+
+			template <typename T> Writer& Write(uint32_t id, const T &value)
+			{
+				assert(id > 0 && id <= MAX_FIELD_ID);
+				m_stream.PushVarint(MakeKey(id, Wire<T>::kType));
+				Wire<T>::Write(m_stream, value);
+				return *this;
+			}
+			// string literals are written as strings
+			Writer& Write(uint32_t id, const char *value) { return Write(id, std::string(value)); }
+
+			void End()
+			{
+				m_stream.OverwriteInteger<uint32_t>(m_pos, static_cast<uint32_t>(m_stream.GetSize() - m_pos - sizeof(uint32_t)));
+				m_is_ended = true;
+			}
+
+			template <typename T> static size_t GetFieldSize(uint32_t id, const T &value)
+			{
+				return OctetStream::GetVarintPackSize(MakeKey(id, Wire<T>::kType)) + Wire<T>::GetSize(value);
+			}
+
+		private:
+			// forbid copy
+			Writer(const Writer&);
+			Writer& operator = (const Writer&);
+
+		private:
+			OctetStream &m_stream;
+			size_t m_pos;  // of the length, relative to the read position
+			bool m_is_ended;
+		};
+
+		//
+		// Reader of one message: Next() moves to the next field, which is then either read
+		// or skipped. The destructor skips whatever is left of the message.
+		// Reads throw std::length_error if the message is truncated and std::invalid_argument
+		// if it is malformed.
+		//
+		//   tagged::Reader reader(stream);
+		//   while (reader.Next()) {
+		//       switch (reader.GetId()) {
+		//       case 1: reader.Read(id); break;
+		//       default: reader.Skip(); break;
+		//       }
+		//   }
+		//
+		class Reader
+		{
+		public:
+			explicit Reader(OctetStream &stream) : m_stream(stream), m_end(0), m_id(0), m_type(WIRE_VARINT)
+			{
+				uint32_t len = m_stream.PopInteger<uint32_t>();
+				if (len > m_stream.GetSize()) {
+					throw std::length_error("tagged::Reader");
+				}
+				m_end = m_stream.GetSize() - len;
+			}
+			~Reader() { m_stream.Ignore(GetRemainingSize()); }
+
+			// false at the end of the message
+			bool Next()
+			{
+				if (GetRemainingSize() == 0) {
+					return false;
+				}
+				uint32_t key = m_stream.PopVarint<uint32_t>();
+				m_id = key >> 3;
+				m_type = static_cast<WireType>(key & 7);
+				return true;
+			}
+			uint32_t GetId() const { return m_id; }
+			WireType GetType() const { return m_type; }
+			size_t GetRemainingSize() const { return m_stream.GetSize() > m_end ? m_stream.GetSize() - m_end : 0; }
+
+			// read the current field, whose wire type must match T
+			template <typename T> Reader& Read(T &value)
+			{
+				if (Wire<T>::kType != m_type) {
+					throw std::invalid_argument("tagged::Reader::Read");
+				}
+				Wire<T>::Read(m_stream, value);
+				if (m_stream.GetSize() < m_end) {
+					throw std::invalid_argument("tagged::Reader::Read");
+				}
+				return *this;
+			}
+			// skip the current field in constant time
+			void Skip()
+			{
+				size_t n = 0;
+				switch (m_type) {
+				case WIRE_VARINT:
+					m_stream.PopVarint<uint64_t>();
+					if (m_stream.GetSize() < m_end) {
+						throw std::invalid_argument("tagged::Reader::Skip");
+					}
+					break;
+				case WIRE_FIXED64:
+					n = 8;
+					break;
+				case WIRE_FIXED32:
+					n = 4;
+					break;
+				case WIRE_BYTES:
+					n = m_stream.PopInteger<uint32_t>();
+					break;
+				default:
+					throw std::invalid_argument("tagged::Reader::Skip");
+				}
+				if (n > m_stream.GetSize()) {
+					throw std::length_error("tagged::Reader::Skip");
+				}
+				if (n > GetRemainingSize()) {
+					throw std::invalid_argument("tagged::Reader::Skip");
+				}
+				m_stream.Ignore(n);
+			}
+
+		private:
+			// forbid copy
+			Reader(const Reader&);
+			Reader& operator = (const Reader&);
+
+		private:
+			OctetStream &m_stream;
+			size_t m_end;  // unread size of the stream at the end of the message
+			uint32_t m_id;
+			WireType m_type;
+		};
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+		// Data member of class C with its field id
+		template <uint32_t Id, typename C, typename T, T C::*Member>
+		struct TaggedField : schema::Field<C, T, Member>
+		{
+			static const uint32_t kId = Id;
+		};
+
+		// Whether ZBASE_TAGGED_SCHEMA has been declared for T
+		template <typename T>
+		struct HasSchema
+		{
+		private:
+			template <typename U> static char Test(decltype(ZBaseTaggedSchemaOf(static_cast<const U*>(0)))*);
+			template <typename U> static long Test(...);
+
+		public:
+			static const bool value = sizeof(Test<T>(0)) == sizeof(char);
+		};
+
+		template <typename T> const bool HasSchema<T>::value;
+
+		template <typename T> struct SchemaOf { typedef decltype(ZBaseTaggedSchemaOf(static_cast<const T*>(0))) type; };
+
+		template <typename T> void Serialize(OctetStream &stream, const T &value);
+		template <typename T> void Deserialize(OctetStream &stream, T &value);
+		template <typename T> size_t GetPackSize(const T &value);
+
+		// nested tagged messages: the message length is the field length
+		template <typename T>
+		struct Wire<T, typename std::enable_if<HasSchema<T>::value>::type>
+		{
+			static const WireType kType = WIRE_BYTES;
+			static void Write(OctetStream &stream, const T &value) { tagged::Serialize(stream, value); }
+			static void Read(OctetStream &stream, T &value) { tagged::Deserialize(stream, value); }
+			static size_t GetSize(const T &value) { return tagged::GetPackSize(value); }
+		};
+
+		namespace detail
+		{
+			template <typename C, typename List> struct Codec;
+
+			template <typename C>
+			struct Codec<C, schema::FieldList<> >
+			{
+				static void Serialize(Writer &, const C &) {}
+				static bool Deserialize(Reader &, C &) { return false; }
+				static size_t GetPackSize(const C &) { return 0; }
+			};
+
+			template <typename C, typename F, typename... Rest>
+			struct Codec<C, schema::FieldList<F, Rest...> >
+			{
+				typedef typename F::value_type T;
+				typedef Codec<C, schema::FieldList<Rest...> > Next;
+
+				static void Serialize(Writer &writer, const C &object)
+				{
+					writer.Write(F::kId, F::Get(object));
+					Next::Serialize(writer, object);
+				}
+				// read the current field if it is known with the same wire type
+				static bool Deserialize(Reader &reader, C &object)
+				{
+					if (F::kId == reader.GetId()) {
+						if (Wire<T>::kType != reader.GetType()) {
+							return false;
+						}
+						reader.Read(F::Get(object));
+						return true;
+					}
+					return Next::Deserialize(reader, object);
+				}
+				static size_t GetPackSize(const C &object)
+				{
+					return Writer::GetFieldSize(F::kId, F::Get(object)) + Next::GetPackSize(object);
+				}
+			};
+		} // namespace detail
+
+		template <typename T>
+		inline void Serialize(OctetStream &stream, const T &value)
+		{
+			Writer writer(stream);
+			detail::Codec<T, typename SchemaOf<T>::type>::Serialize(writer, value);
+		}
+
+		// unknown fields and fields whose wire type changed are skipped
+		template <typename T>
+		inline void Deserialize(OctetStream &stream, T &value)
+		{
+			Reader reader(stream);
+			while (reader.Next()) {
+				if (!detail::Codec<T, typename SchemaOf<T>::type>::Deserialize(reader, value)) {
+					reader.Skip();
+				}
+			}
+		}
+
+		template <typename T>
+		inline size_t GetPackSize(const T &value)
+		{
+			return sizeof(uint32_t) + detail::Codec<T, typename SchemaOf<T>::type>::GetPackSize(value);
+		}
+#endif // ZBASE_HAS_VARIADIC_TEMPLATES
+	} // namespace tagged
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+	template <typename T>
+	struct PackSizeTraits<T, typename std::enable_if<tagged::HasSchema<T>::value>::type>
+	{
+		static size_t Get(const T &value) { return tagged::GetPackSize(value); }
+	};
+
+	template <typename T>
+	inline typename std::enable_if<tagged::HasSchema<T>::value, OctetStream&>::type operator << (OctetStream &stream, const T &value)
+	{
+		tagged::Serialize(stream, value);
+		return stream;
+	}
+
+	template <typename T>
+	inline typename std::enable_if<tagged::HasSchema<T>::value, OctetStream&>::type operator >> (OctetStream &stream, T &value)
+	{
+		tagged::Deserialize(stream, value);
+		return stream;
+	}
+#endif // ZBASE_HAS_VARIADIC_TEMPLATES
+} // namespace zbase
+
+#ifdef ZBASE_HAS_VARIADIC_TEMPLATES
+#define ZBASE_TAGGED_FIELD(C, id_member) ZBASE_TAGGED_FIELD_I(C, ZBASE_TAGGED_UNWRAP id_member)
+#define ZBASE_TAGGED_FIELD_I(C, id_member) ZBASE_SCHEMA_EXPAND(ZBASE_TAGGED_FIELD_II(C, id_member))
+#define ZBASE_TAGGED_FIELD_II(C, id, m) ::zbase::tagged::TaggedField<id, C, decltype(C::m), &C::m>
+#define ZBASE_TAGGED_UNWRAP(id, m) id, m
+
+// Declare the tagged schema of class C as (field id, data member) pairs, see ZBASE_SCHEMA
+#define ZBASE_TAGGED_SCHEMA(C, ...) \
+	inline ::zbase::schema::FieldList<ZBASE_SCHEMA_FIELDS(ZBASE_TAGGED_FIELD, C, __VA_ARGS__)> ZBaseTaggedSchemaOf(const C*) { return {}; }
+#endif // ZBASE_HAS_VARIADIC_TEMPLATES
+
+#endif // ZBASE__TAGGED_H